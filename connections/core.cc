@@ -25,8 +25,10 @@
 #include "connections/advertising_options.h"
 #include "connections/connection_options.h"
 #include "connections/discovery_options.h"
+#include "connections/implementation/analytics/latency_stats.h"
 #include "connections/implementation/service_controller_router.h"
 #include "connections/implementation/service_id_constants.h"
+#include "connections/latency_summary.h"
 #include "connections/listeners.h"
 #include "connections/medium_selector.h"
 #include "connections/out_of_band_connection_metadata.h"
@@ -209,6 +211,37 @@ void Core::SetCustomSavePath(absl::string_view path, ResultCallback callback) {
 
 std::string Core::Dump() { return client_.Dump(); }
 
+std::vector<LatencySummary> Core::GetLatencyStats() {
+  std::vector<LatencySummary> latency_stats;
+  for (const ::nearby::analytics::LatencyStats::StageSummary& summary :
+       ::nearby::analytics::LatencyStats::GetInstance().GetSummaries()) {
+    LatencySummary::Stage stage;
+    switch (summary.stage) {
+      case ::nearby::analytics::LatencyStats::Stage::kFileIo:
+        stage = LatencySummary::Stage::kFileIo;
+        break;
+      case ::nearby::analytics::LatencyStats::Stage::kEncryption:
+        stage = LatencySummary::Stage::kEncryption;
+        break;
+      case ::nearby::analytics::LatencyStats::Stage::kSocketIo:
+        stage = LatencySummary::Stage::kSocketIo;
+        break;
+    }
+    latency_stats.push_back({
+        .medium = summary.medium,
+        .direction = summary.direction,
+        .stage = stage,
+        .count = summary.latency.count,
+        .mean = summary.latency.mean,
+        .p50 = summary.latency.p50,
+        .p90 = summary.latency.p90,
+        .p99 = summary.latency.p99,
+        .max = summary.latency.max,
+    });
+  }
+  return latency_stats;
+}
+
 // V3
 void Core::StartAdvertisingV3(absl::string_view service_id,
                               const v3::AdvertisingOptions& advertising_options,
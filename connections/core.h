@@ -28,6 +28,7 @@
 #include "connections/discovery_options.h"
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/service_controller_router.h"
+#include "connections/latency_summary.h"
 #include "connections/listeners.h"
 #include "connections/medium_selector.h"
 #include "connections/out_of_band_connection_metadata.h"
@@ -260,6 +261,11 @@ class Core {
 
   std::string Dump();
 
+  // Gets the latency percentiles of the file I/O, encryption and socket I/O
+  // of the payload frames, per medium and direction. The latencies are
+  // gathered across all the Core instances of the process.
+  std::vector<LatencySummary> GetLatencyStats();
+
   //******************************* V3 *******************************
   // NOTE: Do NOT mix with the V1 APIs above, this might result in undefined
   // behavior!
@@ -21,13 +21,17 @@
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "connections/advertising_options.h"
 #include "connections/discovery_options.h"
+#include "connections/implementation/analytics/latency_stats.h"
 #include "connections/implementation/mock_service_controller_router.h"
+#include "connections/latency_summary.h"
 #include "connections/listeners.h"
 #include "connections/medium_selector.h"
 #include "connections/params.h"
 #include "connections/payload.h"
+#include "connections/payload_type.h"
 #include "connections/power_level.h"
 #include "connections/status.h"
 #include "connections/strategy.h"
@@ -84,6 +88,30 @@ TEST(CoreTest, DestructorReportsFatalFailure) {
       "Unable to shutdown");
 }
 
+TEST(CoreTest, GetLatencyStatsReturnsRecordedLatencies) {
+  MockServiceControllerRouter mock_controller;
+  // Called when Core is destroyed.
+  EXPECT_CALL(mock_controller, StopAllEndpoints)
+      .WillOnce([&](ClientProxy* client, ResultCallback callback) {
+        callback({Status::kSuccess});
+      });
+  Core core{&mock_controller};
+  analytics::LatencyStats::GetInstance().Reset();
+  analytics::LatencyStats::GetInstance().Record(
+      Medium::WIFI_LAN, PayloadDirection::INCOMING_PAYLOAD,
+      analytics::LatencyStats::Stage::kEncryption, absl::Microseconds(5));
+
+  std::vector<LatencySummary> latency_stats = core.GetLatencyStats();
+
+  ASSERT_EQ(latency_stats.size(), 1);
+  EXPECT_EQ(latency_stats[0].medium, Medium::WIFI_LAN);
+  EXPECT_EQ(latency_stats[0].direction, PayloadDirection::INCOMING_PAYLOAD);
+  EXPECT_EQ(latency_stats[0].stage, LatencySummary::Stage::kEncryption);
+  EXPECT_EQ(latency_stats[0].count, 1);
+  EXPECT_EQ(latency_stats[0].max, absl::Microseconds(5));
+  analytics::LatencyStats::GetInstance().Reset();
+}
+
 TEST(CoreTest, RequestConnectionCallsScRouter) {
   MockServiceControllerRouter mock_controller;
   // Called when Core is destroyed.
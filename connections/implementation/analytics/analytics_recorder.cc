@@ -15,6 +15,7 @@
 #include "connections/implementation/analytics/analytics_recorder.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <iterator>
 #include <memory>
@@ -24,6 +25,8 @@
 
 #include "absl/algorithm/container.h"
 #include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "connections/implementation/analytics/advertising_metadata_params.h"
@@ -683,6 +686,8 @@ void AnalyticsRecorder::OnConnectionClosed(const std::string &endpoint_id,
         RepeatedFieldBackInserter(
             current_strategy_session_->mutable_established_connection()));
   }
+  // The pending payloads of a removed connection are gone by now.
+  chunk_counters_.RemoveExpired();
 }
 
 void AnalyticsRecorder::OnIncomingPayloadStarted(
@@ -699,21 +704,20 @@ void AnalyticsRecorder::OnIncomingPayloadStarted(
   const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
   logical_connection->IncomingPayloadStarted(
       payload_id, PayloadTypeToProtoPayloadType(type), total_size_bytes);
+  chunk_counters_.Add(endpoint_id, payload_id, /*incoming=*/true,
+                      logical_connection->GetIncomingChunkCounter(payload_id));
 }
 
 void AnalyticsRecorder::OnPayloadChunkReceived(const std::string &endpoint_id,
                                                std::int64_t payload_id,
                                                std::int64_t chunk_size_bytes) {
-  MutexLock lock(&mutex_);
-  if (!CanRecordAnalyticsLocked("OnPayloadChunkReceived")) {
-    return;
-  }
-  auto it = active_connections_.find(endpoint_id);
-  if (it == active_connections_.end()) {
-    return;
+  // This is called for every chunk, so it doesn't take mutex_. The counter
+  // is only found while the payload is pending on an active connection.
+  std::shared_ptr<ChunkCounter> chunk_counter =
+      chunk_counters_.Find(endpoint_id, payload_id, /*incoming=*/true);
+  if (chunk_counter != nullptr) {
+    chunk_counter->Add(chunk_size_bytes);
   }
-  const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
-  logical_connection->ChunkReceived(payload_id, chunk_size_bytes);
 }
 
 void AnalyticsRecorder::OnIncomingPayloadDone(
@@ -730,6 +734,9 @@ void AnalyticsRecorder::OnIncomingPayloadDone(
   const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
   logical_connection->IncomingPayloadDone(payload_id, status,
                                           operation_result_code);
+  if (logical_connection->GetIncomingChunkCounter(payload_id) == nullptr) {
+    chunk_counters_.Remove(endpoint_id, payload_id, /*incoming=*/true);
+  }
 }
 
 void AnalyticsRecorder::OnOutgoingPayloadStarted(
@@ -747,22 +754,22 @@ void AnalyticsRecorder::OnOutgoingPayloadStarted(
     const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
     logical_connection->OutgoingPayloadStarted(
         payload_id, PayloadTypeToProtoPayloadType(type), total_size_bytes);
+    chunk_counters_.Add(
+        endpoint_id, payload_id, /*incoming=*/false,
+        logical_connection->GetOutgoingChunkCounter(payload_id));
   }
 }
 
 void AnalyticsRecorder::OnPayloadChunkSent(const std::string &endpoint_id,
                                            std::int64_t payload_id,
                                            std::int64_t chunk_size_bytes) {
-  MutexLock lock(&mutex_);
-  if (!CanRecordAnalyticsLocked("OnPayloadChunkSent")) {
-    return;
-  }
-  auto it = active_connections_.find(endpoint_id);
-  if (it == active_connections_.end()) {
-    return;
+  // This is called for every chunk, so it doesn't take mutex_. The counter
+  // is only found while the payload is pending on an active connection.
+  std::shared_ptr<ChunkCounter> chunk_counter =
+      chunk_counters_.Find(endpoint_id, payload_id, /*incoming=*/false);
+  if (chunk_counter != nullptr) {
+    chunk_counter->Add(chunk_size_bytes);
   }
-  const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
-  logical_connection->ChunkSent(payload_id, chunk_size_bytes);
 }
 
 void AnalyticsRecorder::OnOutgoingPayloadDone(
@@ -780,6 +787,9 @@ void AnalyticsRecorder::OnOutgoingPayloadDone(
   const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
   logical_connection->OutgoingPayloadDone(payload_id, status,
                                           operation_result_code);
+  if (logical_connection->GetOutgoingChunkCounter(payload_id) == nullptr) {
+    chunk_counters_.Remove(endpoint_id, payload_id, /*incoming=*/false);
+  }
 }
 
 void AnalyticsRecorder::OnBandwidthUpgradeStarted(
@@ -1368,6 +1378,7 @@ void AnalyticsRecorder::FinishStrategySessionLocked() {
               current_strategy_session_->mutable_established_connection()));
     }
     active_connections_.clear();
+    chunk_counters_.RemoveExpired();
 
     // Finish any pending upgrade attempts.
     for (const auto &item : bandwidth_upgrade_attempts_) {
@@ -1423,10 +1434,53 @@ PayloadType AnalyticsRecorder::PayloadTypeToProtoPayloadType(
   }
 }
 
-void AnalyticsRecorder::PendingPayload::AddChunk(
-    std::int64_t chunk_size_bytes) {
-  num_bytes_transferred_ += chunk_size_bytes;
-  num_chunks_++;
+void AnalyticsRecorder::ChunkCounterIndex::Add(
+    const std::string &endpoint_id, std::int64_t payload_id, bool incoming,
+    std::weak_ptr<ChunkCounter> chunk_counter) {
+  Key key(endpoint_id, payload_id, incoming);
+  Shard &shard = GetShard(key);
+  MutexLock lock(&shard.mutex);
+  shard.chunk_counters[std::move(key)] = std::move(chunk_counter);
+}
+
+std::shared_ptr<AnalyticsRecorder::ChunkCounter>
+AnalyticsRecorder::ChunkCounterIndex::Find(const std::string &endpoint_id,
+                                           std::int64_t payload_id,
+                                           bool incoming) const {
+  Key key(endpoint_id, payload_id, incoming);
+  const Shard &shard = GetShard(key);
+  MutexLock lock(&shard.mutex);
+  auto it = shard.chunk_counters.find(key);
+  if (it == shard.chunk_counters.end()) {
+    return nullptr;
+  }
+  return it->second.lock();
+}
+
+void AnalyticsRecorder::ChunkCounterIndex::Remove(
+    const std::string &endpoint_id, std::int64_t payload_id, bool incoming) {
+  Key key(endpoint_id, payload_id, incoming);
+  Shard &shard = GetShard(key);
+  MutexLock lock(&shard.mutex);
+  shard.chunk_counters.erase(key);
+}
+
+void AnalyticsRecorder::ChunkCounterIndex::RemoveExpired() {
+  for (Shard &shard : shards_) {
+    MutexLock lock(&shard.mutex);
+    absl::erase_if(shard.chunk_counters,
+                   [](const auto &item) { return item.second.expired(); });
+  }
+}
+
+const AnalyticsRecorder::ChunkCounterIndex::Shard &
+AnalyticsRecorder::ChunkCounterIndex::GetShard(const Key &key) const {
+  return shards_[absl::Hash<Key>{}(key) % kNumShards];
+}
+
+AnalyticsRecorder::ChunkCounterIndex::Shard &
+AnalyticsRecorder::ChunkCounterIndex::GetShard(const Key &key) {
+  return shards_[absl::Hash<Key>{}(key) % kNumShards];
 }
 
 ConnectionsLog::Payload AnalyticsRecorder::PendingPayload::GetProtoPayload(
@@ -1438,8 +1492,10 @@ ConnectionsLog::Payload AnalyticsRecorder::PendingPayload::GetProtoPayload(
   }
   payload.set_type(type_);
   payload.set_total_size_bytes(total_size_bytes_);
-  payload.set_num_bytes_transferred(num_bytes_transferred_);
-  payload.set_num_chunks(num_chunks_);
+  payload.set_num_bytes_transferred(
+      chunk_counter_->num_bytes_transferred.load(std::memory_order_relaxed));
+  payload.set_num_chunks(
+      chunk_counter_->num_chunks.load(std::memory_order_relaxed));
   payload.set_status(status);
 
   auto operation_result_proto =
@@ -1567,14 +1623,14 @@ void AnalyticsRecorder::LogicalConnection::IncomingPayloadStarted(
                                                     no_record_time_millis_)});
 }
 
-void AnalyticsRecorder::LogicalConnection::ChunkReceived(
-    std::int64_t payload_id, std::int64_t size_bytes) {
+std::shared_ptr<AnalyticsRecorder::ChunkCounter>
+AnalyticsRecorder::LogicalConnection::GetIncomingChunkCounter(
+    std::int64_t payload_id) const {
   auto it = incoming_payloads_.find(payload_id);
   if (it == incoming_payloads_.end()) {
-    return;
+    return nullptr;
   }
-  PendingPayload *pending_payload = it->second.get();
-  pending_payload->AddChunk(size_bytes);
+  return it->second->chunk_counter();
 }
 
 void AnalyticsRecorder::LogicalConnection::IncomingPayloadDone(
@@ -1606,14 +1662,14 @@ void AnalyticsRecorder::LogicalConnection::OutgoingPayloadStarted(
                                                     no_record_time_millis_)});
 }
 
-void AnalyticsRecorder::LogicalConnection::ChunkSent(std::int64_t payload_id,
-                                                     std::int64_t size_bytes) {
+std::shared_ptr<AnalyticsRecorder::ChunkCounter>
+AnalyticsRecorder::LogicalConnection::GetOutgoingChunkCounter(
+    std::int64_t payload_id) const {
   auto it = outgoing_payloads_.find(payload_id);
   if (it == outgoing_payloads_.end()) {
-    return;
+    return nullptr;
   }
-  PendingPayload *payload = it->second.get();
-  payload->AddChunk(size_bytes);
+  return it->second->chunk_counter();
 }
 
 void AnalyticsRecorder::LogicalConnection::OutgoingPayloadDone(
@@ -1682,11 +1738,16 @@ AnalyticsRecorder::LogicalConnection::ResolvePendingPayloads(
         pending_payload->GetProtoPayload(status);
     completed_payloads.push_back(proto_payload);
     if (reason == UPGRADED) {
+      // The new PendingPayload keeps the counter, which the chunk callbacks
+      // may still be updating, minus the chunks logged for the old medium.
+      pending_payload->chunk_counter()->Remove(
+          proto_payload.num_bytes_transferred(), proto_payload.num_chunks());
       upgraded_payloads.insert(
           {item.first,
            std::make_unique<PendingPayload>(
                pending_payload->type(), pending_payload->total_size_bytes(),
-               no_record_time_millis_, operation_result_code)});
+               no_record_time_millis_, operation_result_code,
+               pending_payload->chunk_counter())});
     }
   }
   pending_payloads.clear();
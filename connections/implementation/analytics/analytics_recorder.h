@@ -15,14 +15,18 @@
 #ifndef ANALYTICS_ANALYTICS_RECORDER_H_
 #define ANALYTICS_ANALYTICS_RECORDER_H_
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "connections/implementation/analytics/advertising_metadata_params.h"
@@ -234,6 +238,56 @@ class AnalyticsRecorder {
   void Sync();
 
  private:
+  // Chunk counts of a pending payload. They are updated from the chunk
+  // callbacks without holding mutex_, and read when the payload is logged.
+  struct ChunkCounter {
+    void Add(std::int64_t chunk_size_bytes) {
+      num_bytes_transferred.fetch_add(chunk_size_bytes,
+                                      std::memory_order_relaxed);
+      num_chunks.fetch_add(1, std::memory_order_relaxed);
+    }
+    void Remove(std::int64_t bytes, int chunks) {
+      num_bytes_transferred.fetch_sub(bytes, std::memory_order_relaxed);
+      num_chunks.fetch_sub(chunks, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::int64_t> num_bytes_transferred = 0;
+    std::atomic<int> num_chunks = 0;
+  };
+
+  // Finds the ChunkCounter of a pending payload by endpoint, payload id and
+  // direction. The entries are spread over shards with their own locks, so
+  // that chunks of different payloads don't contend with each other nor with
+  // mutex_. The counters are owned by their PendingPayload, so an entry stops
+  // matching once its payload is logged.
+  class ChunkCounterIndex {
+   public:
+    void Add(const std::string &endpoint_id, std::int64_t payload_id,
+             bool incoming, std::weak_ptr<ChunkCounter> chunk_counter);
+    // Returns nullptr if the payload is not pending.
+    std::shared_ptr<ChunkCounter> Find(const std::string &endpoint_id,
+                                       std::int64_t payload_id,
+                                       bool incoming) const;
+    void Remove(const std::string &endpoint_id, std::int64_t payload_id,
+                bool incoming);
+    // Drops the entries whose payload is not pending anymore.
+    void RemoveExpired();
+
+   private:
+    static constexpr int kNumShards = 16;
+    using Key = std::tuple<std::string, std::int64_t, bool>;
+    struct Shard {
+      mutable Mutex mutex;
+      absl::flat_hash_map<Key, std::weak_ptr<ChunkCounter>> chunk_counters
+          ABSL_GUARDED_BY(mutex);
+    };
+
+    const Shard &GetShard(const Key &key) const;
+    Shard &GetShard(const Key &key);
+
+    std::array<Shard, kNumShards> shards_;
+  };
+
   // Tracks the chunks and duration of a Payload on a particular medium.
   class PendingPayload {
    public:
@@ -241,22 +295,21 @@ class AnalyticsRecorder {
                    std::int64_t total_size_bytes, bool no_record_time_millis)
         : PendingPayload(type, total_size_bytes, no_record_time_millis,
                          location::nearby::proto::connections::
-                             OperationResultCode::DETAIL_UNKNOWN) {}
+                             OperationResultCode::DETAIL_UNKNOWN,
+                         std::make_shared<ChunkCounter>()) {}
     PendingPayload(location::nearby::proto::connections::PayloadType type,
                    std::int64_t total_size_bytes, bool no_record_time_millis,
                    location::nearby::proto::connections::OperationResultCode
-                       operation_result_code)
+                       operation_result_code,
+                   std::shared_ptr<ChunkCounter> chunk_counter)
         : start_time_(SystemClock::ElapsedRealtime()),
           type_(type),
           total_size_bytes_(total_size_bytes),
-          num_bytes_transferred_(0),
-          num_chunks_(0),
+          chunk_counter_(std::move(chunk_counter)),
           operation_result_code_(operation_result_code),
           no_record_time_millis_(no_record_time_millis) {}
     ~PendingPayload() = default;
 
-    void AddChunk(std::int64_t chunk_size_bytes);
-
     location::nearby::analytics::proto::ConnectionsLog::Payload GetProtoPayload(
         location::nearby::proto::connections::PayloadStatus status);
 
@@ -266,6 +319,10 @@ class AnalyticsRecorder {
 
     std::int64_t total_size_bytes() const { return total_size_bytes_; }
 
+    const std::shared_ptr<ChunkCounter> &chunk_counter() const {
+      return chunk_counter_;
+    }
+
     void SetOperationResultCode(
         location::nearby::proto::connections::OperationResultCode
             operation_result_code) {
@@ -276,8 +333,7 @@ class AnalyticsRecorder {
     absl::Time start_time_;
     location::nearby::proto::connections::PayloadType type_;
     std::int64_t total_size_bytes_;
-    std::int64_t num_bytes_transferred_;
-    int num_chunks_;
+    std::shared_ptr<ChunkCounter> chunk_counter_;
     location::nearby::proto::connections::OperationResultCode
         operation_result_code_ = location::nearby::proto::connections::
             OperationResultCode::DETAIL_UNKNOWN;
@@ -317,7 +373,9 @@ class AnalyticsRecorder {
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadType type,
         std::int64_t total_size_bytes);
-    void ChunkReceived(std::int64_t payload_id, std::int64_t size_bytes);
+    // Returns nullptr if the payload is not pending.
+    std::shared_ptr<ChunkCounter> GetIncomingChunkCounter(
+        std::int64_t payload_id) const;
     void IncomingPayloadDone(
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadStatus status,
@@ -327,7 +385,8 @@ class AnalyticsRecorder {
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadType type,
         std::int64_t total_size_bytes);
-    void ChunkSent(std::int64_t payload_id, std::int64_t size_bytes);
+    std::shared_ptr<ChunkCounter> GetOutgoingChunkCounter(
+        std::int64_t payload_id) const;
     void OutgoingPayloadDone(
         std::int64_t payload_id,
         location::nearby::proto::connections::PayloadStatus status,
@@ -505,6 +564,9 @@ class AnalyticsRecorder {
       outgoing_connection_requests_ ABSL_GUARDED_BY(mutex_);
   absl::btree_map<std::string, std::unique_ptr<LogicalConnection>>
       active_connections_ ABSL_GUARDED_BY(mutex_);
+  // Lets the chunk callbacks update the pending payloads of
+  // active_connections_ without taking mutex_.
+  ChunkCounterIndex chunk_counters_;
   absl::btree_map<std::string,
                   std::unique_ptr<location::nearby::analytics::proto::
                                       ConnectionsLog::BandwidthUpgradeAttempt>>
@@ -19,12 +19,14 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "net/proto2/contrib/parse_proto/parse_text_proto.h"
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
 #include "connections/implementation/analytics/connection_attempt_metadata_params.h"
 #include "connections/payload_type.h"
@@ -1076,6 +1078,76 @@ TEST(AnalyticsRecorderTest, OutgoingPayloadUpgraded) {
               EqualsProto(strategy_session_proto));
 }
 
+TEST(AnalyticsRecorderTest, CountsPayloadChunksFromManyThreads) {
+  constexpr int kNumEndpoints = 8;
+  constexpr int kNumChunks = 1000;
+  std::int64_t payload_id = 123456789;
+  std::string connection_token = "connection_token";
+
+  CountDownLatch client_session_done_latch(1);
+  FakeEventLogger event_logger(client_session_done_latch);
+  AnalyticsRecorder analytics_recorder(&event_logger,
+                                       /*no_record_time_millis=*/true);
+
+  auto advertising_metadata_params =
+      analytics_recorder.BuildAdvertisingMetadataParams();
+  analytics_recorder.OnStartAdvertising(connections::Strategy::kP2pStar,
+                                        /*mediums=*/{WIFI_LAN},
+                                        advertising_metadata_params.get());
+  std::vector<std::string> endpoint_ids;
+  for (int i = 0; i < kNumEndpoints; ++i) {
+    endpoint_ids.push_back(absl::StrCat("endpoint_id_", i));
+    analytics_recorder.OnConnectionEstablished(endpoint_ids.back(), WIFI_LAN,
+                                               connection_token);
+    analytics_recorder.OnIncomingPayloadStarted(
+        endpoint_ids.back(), payload_id, connections::PayloadType::kFile, 50);
+  }
+  analytics_recorder.OnOutgoingPayloadStarted(
+      endpoint_ids, payload_id, connections::PayloadType::kFile, 50);
+
+  std::vector<std::thread> threads;
+  for (const std::string& endpoint_id : endpoint_ids) {
+    threads.emplace_back([&analytics_recorder, endpoint_id, payload_id]() {
+      for (int i = 0; i < kNumChunks; ++i) {
+        analytics_recorder.OnPayloadChunkSent(endpoint_id, payload_id, 10);
+        analytics_recorder.OnPayloadChunkReceived(endpoint_id, payload_id, 20);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const std::string& endpoint_id : endpoint_ids) {
+    analytics_recorder.OnOutgoingPayloadDone(
+        endpoint_id, payload_id, SUCCESS, OperationResultCode::DETAIL_SUCCESS);
+    analytics_recorder.OnIncomingPayloadDone(
+        endpoint_id, payload_id, SUCCESS, OperationResultCode::DETAIL_SUCCESS);
+    analytics_recorder.OnConnectionClosed(
+        endpoint_id, WIFI_LAN, LOCAL_DISCONNECTION,
+        ConnectionsLog::EstablishedConnection::SAFE_DISCONNECTION);
+  }
+
+  analytics_recorder.LogSession();
+  ASSERT_TRUE(client_session_done_latch.Await(kDefaultTimeout).result());
+
+  const ConnectionsLog::StrategySession& strategy_session =
+      event_logger.GetLoggedClientSession().strategy_session(0);
+  ASSERT_EQ(strategy_session.established_connection_size(), kNumEndpoints);
+  for (const ConnectionsLog::EstablishedConnection& established_connection :
+       strategy_session.established_connection()) {
+    ASSERT_EQ(established_connection.sent_payload_size(), 1);
+    EXPECT_EQ(established_connection.sent_payload(0).num_chunks(), kNumChunks);
+    EXPECT_EQ(established_connection.sent_payload(0).num_bytes_transferred(),
+              kNumChunks * 10);
+    ASSERT_EQ(established_connection.received_payload_size(), 1);
+    EXPECT_EQ(established_connection.received_payload(0).num_chunks(),
+              kNumChunks);
+    EXPECT_EQ(
+        established_connection.received_payload(0).num_bytes_transferred(),
+        kNumChunks * 20);
+  }
+}
+
 TEST(AnalyticsRecorderTest, UpgradeAttemptWorks) {
   std::string endpoint_id = "endpoint_id";
   std::string endpoint_id_1 = "endpoint_id_1";
@@ -0,0 +1,105 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/analytics/latency_histogram.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include "absl/numeric/bits.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace analytics {
+
+int LatencyHistogram::GetBucketIndex(int64_t nanos) {
+  if (nanos < kSubBucketCount) return std::max<int>(nanos, 0);
+  uint64_t value = std::min<uint64_t>(
+      nanos, absl::ToInt64Nanoseconds(kMaxTrackedLatency));
+  // The position of the highest bit, at least kSubBucketBits here.
+  int exponent = absl::bit_width(value) - 1;
+  // The kSubBucketBits bits below the highest one.
+  int sub_bucket =
+      (value >> (exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+  return (exponent - kSubBucketBits + 1) * kSubBucketCount + sub_bucket;
+}
+
+int64_t LatencyHistogram::GetBucketUpperBound(int index) {
+  if (index < kSubBucketCount) return index;
+  int exponent = index / kSubBucketCount + kSubBucketBits - 1;
+  int64_t sub_bucket = index % kSubBucketCount;
+  int shift = exponent - kSubBucketBits;
+  return ((kSubBucketCount + sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(absl::Duration latency) {
+  int64_t nanos = std::max<int64_t>(absl::ToInt64Nanoseconds(latency), 0);
+  buckets_[GetBucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+  sum_nanos_.fetch_add(nanos, std::memory_order_relaxed);
+  int64_t max = max_nanos_.load(std::memory_order_relaxed);
+  while (nanos > max && !max_nanos_.compare_exchange_weak(
+                            max, nanos, std::memory_order_relaxed)) {
+  }
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+absl::Duration LatencyHistogram::GetPercentile(double fraction) const {
+  // The buckets are summed up instead of using count_, since they may be
+  // updated while we read them.
+  uint64_t total = 0;
+  for (const std::atomic<uint64_t>& bucket : buckets_) {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  if (total == 0) return absl::ZeroDuration();
+
+  fraction = std::clamp(fraction, 0.0, 1.0);
+  uint64_t rank = std::max<uint64_t>(std::ceil(fraction * total), 1);
+  int64_t max = max_nanos_.load(std::memory_order_relaxed);
+  uint64_t seen = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return absl::Nanoseconds(std::min(GetBucketUpperBound(i), max));
+    }
+  }
+  return absl::Nanoseconds(max);
+}
+
+LatencyHistogram::Summary LatencyHistogram::GetSummary() const {
+  Summary summary;
+  summary.count = GetCount();
+  if (summary.count == 0) return summary;
+  summary.mean =
+      absl::Nanoseconds(sum_nanos_.load(std::memory_order_relaxed)) /
+      summary.count;
+  summary.p50 = GetPercentile(0.5);
+  summary.p90 = GetPercentile(0.9);
+  summary.p99 = GetPercentile(0.99);
+  summary.max = absl::Nanoseconds(max_nanos_.load(std::memory_order_relaxed));
+  return summary;
+}
+
+void LatencyHistogram::Reset() {
+  count_.store(0, std::memory_order_relaxed);
+  for (std::atomic<uint64_t>& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  sum_nanos_.store(0, std::memory_order_relaxed);
+  max_nanos_.store(0, std::memory_order_relaxed);
+}
+
+}  // namespace analytics
+}  // namespace nearby
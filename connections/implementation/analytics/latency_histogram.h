@@ -0,0 +1,89 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_LATENCY_HISTOGRAM_H_
+#define NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace analytics {
+
+// A histogram of latencies with nanosecond resolution, which can be recorded
+// to from any number of threads without locking.
+//
+// The buckets are log-linear: every power of two is split into
+// kSubBucketCount linear buckets, so the percentiles are accurate to within
+// 1 / kSubBucketCount of their value, from nanoseconds up to minutes.
+// Latencies below kSubBucketCount nanoseconds are kept exactly, and those
+// above kMaxTrackedLatency all land in the last bucket. The maximum is kept
+// exactly in any case.
+class LatencyHistogram {
+ public:
+  struct Summary {
+    int64_t count = 0;
+    absl::Duration mean;
+    absl::Duration p50;
+    absl::Duration p90;
+    absl::Duration p99;
+    absl::Duration max;
+  };
+
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+  // 2^40ns is a bit more than 18 minutes.
+  static constexpr int kMaxExponent = 40;
+  static constexpr absl::Duration kMaxTrackedLatency =
+      absl::Nanoseconds((int64_t{1} << kMaxExponent) - 1);
+  static constexpr int kBucketCount =
+      (kMaxExponent - kSubBucketBits + 1) * kSubBucketCount;
+
+  LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  // Negative latencies are recorded as 0.
+  void Record(absl::Duration latency);
+
+  // Returns the latency below which `fraction` of the recorded latencies lie,
+  // rounded up to the end of its bucket. `fraction` is in [0, 1].
+  absl::Duration GetPercentile(double fraction) const;
+
+  int64_t GetCount() const { return count_.load(std::memory_order_relaxed); }
+
+  Summary GetSummary() const;
+
+  // Drops all the recorded latencies. Latencies recorded concurrently may be
+  // partially dropped.
+  void Reset();
+
+  // Exposed for testing.
+  static int GetBucketIndex(int64_t nanos);
+  static int64_t GetBucketUpperBound(int index);
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_ = {};
+  std::atomic<int64_t> count_ = 0;
+  std::atomic<int64_t> sum_nanos_ = 0;
+  std::atomic<int64_t> max_nanos_ = 0;
+};
+
+}  // namespace analytics
+}  // namespace nearby
+
+#endif  // NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_LATENCY_HISTOGRAM_H_
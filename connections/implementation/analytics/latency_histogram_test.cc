@@ -0,0 +1,124 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/analytics/latency_histogram.h"
+
+#include <cstdint>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace analytics {
+namespace {
+
+TEST(LatencyHistogramTest, BucketsCoverEveryValueOnce) {
+  int64_t lower_bound = 0;
+  for (int i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+    int64_t upper_bound = LatencyHistogram::GetBucketUpperBound(i);
+    ASSERT_GE(upper_bound, lower_bound);
+    EXPECT_EQ(LatencyHistogram::GetBucketIndex(lower_bound), i);
+    EXPECT_EQ(LatencyHistogram::GetBucketIndex(upper_bound), i);
+    // The bucket is no wider than 1 / kSubBucketCount of its values.
+    EXPECT_LE((upper_bound - lower_bound) * LatencyHistogram::kSubBucketCount,
+              upper_bound);
+    lower_bound = upper_bound + 1;
+  }
+  EXPECT_EQ(lower_bound - 1,
+            absl::ToInt64Nanoseconds(LatencyHistogram::kMaxTrackedLatency));
+}
+
+TEST(LatencyHistogramTest, EmptyHistogramHasZeroSummary) {
+  LatencyHistogram histogram;
+
+  LatencyHistogram::Summary summary = histogram.GetSummary();
+
+  EXPECT_EQ(summary.count, 0);
+  EXPECT_EQ(summary.p50, absl::ZeroDuration());
+  EXPECT_EQ(summary.max, absl::ZeroDuration());
+}
+
+TEST(LatencyHistogramTest, KeepsSmallLatenciesExactly) {
+  LatencyHistogram histogram;
+
+  for (int i = 1; i <= 10; ++i) histogram.Record(absl::Nanoseconds(i));
+
+  EXPECT_EQ(histogram.GetPercentile(0.5), absl::Nanoseconds(5));
+  EXPECT_EQ(histogram.GetPercentile(0.9), absl::Nanoseconds(9));
+  EXPECT_EQ(histogram.GetPercentile(1), absl::Nanoseconds(10));
+}
+
+TEST(LatencyHistogramTest, PercentilesAreWithinBucketError) {
+  LatencyHistogram histogram;
+
+  // 1us to 1ms.
+  for (int i = 1; i <= 1000; ++i) histogram.Record(absl::Microseconds(i));
+
+  LatencyHistogram::Summary summary = histogram.GetSummary();
+  EXPECT_EQ(summary.count, 1000);
+  EXPECT_EQ(summary.mean, absl::Nanoseconds(500500));
+  EXPECT_EQ(summary.max, absl::Milliseconds(1));
+  EXPECT_GE(summary.p50, absl::Microseconds(500));
+  EXPECT_LE(summary.p50, absl::Microseconds(500) * 17 / 16);
+  EXPECT_GE(summary.p90, absl::Microseconds(900));
+  EXPECT_LE(summary.p90, absl::Microseconds(900) * 17 / 16);
+  EXPECT_GE(summary.p99, absl::Microseconds(990));
+  EXPECT_LE(summary.p99, absl::Milliseconds(1));
+}
+
+TEST(LatencyHistogramTest, ClampsOutOfRangeLatencies) {
+  LatencyHistogram histogram;
+
+  histogram.Record(absl::Nanoseconds(-5));
+  histogram.Record(absl::Hours(1));
+
+  EXPECT_EQ(histogram.GetPercentile(0), absl::ZeroDuration());
+  EXPECT_EQ(histogram.GetPercentile(1), LatencyHistogram::kMaxTrackedLatency);
+  EXPECT_EQ(histogram.GetSummary().max, absl::Hours(1));
+}
+
+TEST(LatencyHistogramTest, ResetDropsLatencies) {
+  LatencyHistogram histogram;
+  histogram.Record(absl::Milliseconds(1));
+
+  histogram.Reset();
+
+  EXPECT_EQ(histogram.GetCount(), 0);
+  EXPECT_EQ(histogram.GetPercentile(1), absl::ZeroDuration());
+}
+
+TEST(LatencyHistogramTest, RecordsFromManyThreads) {
+  constexpr int kNumThreads = 8;
+  constexpr int kRecordsPerThread = 10000;
+  LatencyHistogram histogram;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&histogram, t]() {
+      for (int i = 0; i < kRecordsPerThread; ++i) {
+        histogram.Record(absl::Microseconds(t + 1));
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  EXPECT_EQ(histogram.GetCount(), kNumThreads * kRecordsPerThread);
+  EXPECT_EQ(histogram.GetSummary().max, absl::Microseconds(kNumThreads));
+}
+
+}  // namespace
+}  // namespace analytics
+}  // namespace nearby
@@ -0,0 +1,119 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/analytics/latency_stats.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <optional>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "connections/implementation/analytics/latency_histogram.h"
+#include "connections/implementation/analytics/packet_meta_data.h"
+#include "connections/payload_type.h"
+#include "internal/platform/mutex_lock.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace analytics {
+
+namespace {
+using ::location::nearby::proto::connections::Medium;
+using ::nearby::connections::PayloadDirection;
+}  // namespace
+
+LatencyStats& LatencyStats::GetInstance() {
+  alignas(LatencyStats) static char storage[sizeof(LatencyStats)];
+  static LatencyStats* stats = new (&storage) LatencyStats();
+  return *stats;
+}
+
+void LatencyStats::Record(Medium medium, PayloadDirection direction,
+                          Stage stage, absl::Duration latency) {
+  LatencyHistogram* histogram = GetOrCreateHistogram(medium, direction, stage);
+  if (histogram != nullptr) histogram->Record(latency);
+}
+
+void LatencyStats::RecordFrame(Medium medium, PayloadDirection direction,
+                               const PacketMetaData& packet_meta_data) {
+  std::optional<absl::Duration> file_io_time = packet_meta_data.GetFileIoTime();
+  if (file_io_time.has_value()) {
+    Record(medium, direction, Stage::kFileIo, *file_io_time);
+  }
+  std::optional<absl::Duration> encryption_time =
+      packet_meta_data.GetEncryptionTime();
+  if (encryption_time.has_value()) {
+    Record(medium, direction, Stage::kEncryption, *encryption_time);
+  }
+  std::optional<absl::Duration> socket_io_time =
+      packet_meta_data.GetSocketIoTime();
+  if (socket_io_time.has_value()) {
+    Record(medium, direction, Stage::kSocketIo, *socket_io_time);
+  }
+}
+
+std::vector<LatencyStats::StageSummary> LatencyStats::GetSummaries() const {
+  std::vector<StageSummary> summaries;
+  for (int i = 0; i < kNumHistograms; ++i) {
+    LatencyHistogram* histogram =
+        histograms_[i].load(std::memory_order_acquire);
+    if (histogram == nullptr || histogram->GetCount() == 0) continue;
+    summaries.push_back({
+        .medium = static_cast<Medium>(i / (kNumDirections * kNumStages)),
+        .direction = static_cast<PayloadDirection>(
+            i / kNumStages % kNumDirections),
+        .stage = static_cast<Stage>(i % kNumStages),
+        .latency = histogram->GetSummary(),
+    });
+  }
+  return summaries;
+}
+
+void LatencyStats::Reset() {
+  for (std::atomic<LatencyHistogram*>& histogram : histograms_) {
+    LatencyHistogram* h = histogram.load(std::memory_order_acquire);
+    if (h != nullptr) h->Reset();
+  }
+}
+
+LatencyHistogram* LatencyStats::GetOrCreateHistogram(
+    Medium medium, PayloadDirection direction, Stage stage) {
+  int medium_index = static_cast<int>(medium);
+  int direction_index = static_cast<int>(direction);
+  if (medium_index < 0 || medium_index >= kNumMediums ||
+      direction_index < 0 || direction_index >= kNumDirections) {
+    return nullptr;
+  }
+  int index =
+      (medium_index * kNumDirections + direction_index) * kNumStages +
+      static_cast<int>(stage);
+  LatencyHistogram* histogram =
+      histograms_[index].load(std::memory_order_acquire);
+  if (histogram != nullptr) return histogram;
+
+  MutexLock lock(&mutex_);
+  histogram = histograms_[index].load(std::memory_order_acquire);
+  if (histogram == nullptr) {
+    // Histograms are never freed, so that they can be read without locking.
+    owned_histograms_.push_back(std::make_unique<LatencyHistogram>());
+    histogram = owned_histograms_.back().get();
+    histograms_[index].store(histogram, std::memory_order_release);
+  }
+  return histogram;
+}
+
+}  // namespace analytics
+}  // namespace nearby
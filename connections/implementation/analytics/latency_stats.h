@@ -0,0 +1,105 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_LATENCY_STATS_H_
+#define NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_LATENCY_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
+#include "connections/implementation/analytics/latency_histogram.h"
+#include "connections/implementation/analytics/packet_meta_data.h"
+#include "connections/payload_type.h"
+#include "internal/platform/mutex.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace analytics {
+
+// Process-wide latency histograms of the stages a payload frame goes through,
+// per medium and direction. They are fed from the PacketMetaData of every
+// frame, and are cheap enough to be always on: recording takes a few relaxed
+// atomic increments, and the histograms are only allocated for the
+// combinations that are actually used.
+class LatencyStats {
+ public:
+  enum class Stage {
+    kFileIo = 0,
+    kEncryption = 1,
+    kSocketIo = 2,
+  };
+
+  struct StageSummary {
+    ::location::nearby::proto::connections::Medium medium;
+    ::nearby::connections::PayloadDirection direction;
+    Stage stage;
+    LatencyHistogram::Summary latency;
+  };
+
+  LatencyStats(const LatencyStats&) = delete;
+  LatencyStats& operator=(const LatencyStats&) = delete;
+
+  static LatencyStats& GetInstance();
+
+  void Record(::location::nearby::proto::connections::Medium medium,
+              ::nearby::connections::PayloadDirection direction, Stage stage,
+              absl::Duration latency) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Records the stages which were measured for the frame.
+  void RecordFrame(::location::nearby::proto::connections::Medium medium,
+                   ::nearby::connections::PayloadDirection direction,
+                   const PacketMetaData& packet_meta_data)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the summaries of all the histograms with recorded latencies.
+  std::vector<StageSummary> GetSummaries() const;
+
+  // Drops all the recorded latencies.
+  void Reset();
+
+ private:
+  static constexpr int kNumMediums =
+      ::location::nearby::proto::connections::Medium_ARRAYSIZE;
+  // UNKNOWN_DIRECTION_PAYLOAD, INCOMING_PAYLOAD and OUTGOING_PAYLOAD.
+  static constexpr int kNumDirections = 3;
+  static constexpr int kNumStages = 3;
+  static constexpr int kNumHistograms =
+      kNumMediums * kNumDirections * kNumStages;
+
+  // This is a singleton object, for which destructor will never be called.
+  // Constructor will be invoked once from GetInstance() static method.
+  LatencyStats() = default;
+  ~LatencyStats() = default;
+
+  // Returns nullptr if the arguments are out of range.
+  LatencyHistogram* GetOrCreateHistogram(
+      ::location::nearby::proto::connections::Medium medium,
+      ::nearby::connections::PayloadDirection direction, Stage stage)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Only taken to create a histogram the first time it's used.
+  Mutex mutex_;
+  std::array<std::atomic<LatencyHistogram*>, kNumHistograms> histograms_ = {};
+  std::vector<std::unique_ptr<LatencyHistogram>> owned_histograms_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace analytics
+}  // namespace nearby
+
+#endif  // NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_LATENCY_STATS_H_
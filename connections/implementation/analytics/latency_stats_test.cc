@@ -0,0 +1,131 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/analytics/latency_stats.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "connections/implementation/analytics/packet_meta_data.h"
+#include "connections/payload_type.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace analytics {
+namespace {
+
+using ::location::nearby::proto::connections::Medium;
+using ::nearby::connections::PayloadDirection;
+
+class LatencyStatsTest : public ::testing::Test {
+ protected:
+  void SetUp() override { LatencyStats::GetInstance().Reset(); }
+  void TearDown() override { LatencyStats::GetInstance().Reset(); }
+};
+
+TEST_F(LatencyStatsTest, RecordsMeasuredStagesOfFrame) {
+  absl::Time start = absl::UnixEpoch() + absl::Hours(1);
+  PacketMetaData packet_meta_data = {
+      .packet_size = 100,
+      .file_io_start_time = start,
+      .file_io_end_time = start + absl::Microseconds(3),
+      .socket_io_start_time = start,
+      .socket_io_end_time = start + absl::Microseconds(7),
+  };
+
+  LatencyStats::GetInstance().RecordFrame(
+      Medium::WIFI_LAN, PayloadDirection::OUTGOING_PAYLOAD, packet_meta_data);
+
+  std::vector<LatencyStats::StageSummary> summaries =
+      LatencyStats::GetInstance().GetSummaries();
+  // Encryption was not measured.
+  ASSERT_EQ(summaries.size(), 2);
+  EXPECT_EQ(summaries[0].medium, Medium::WIFI_LAN);
+  EXPECT_EQ(summaries[0].direction, PayloadDirection::OUTGOING_PAYLOAD);
+  EXPECT_EQ(summaries[0].stage, LatencyStats::Stage::kFileIo);
+  EXPECT_EQ(summaries[0].latency.count, 1);
+  EXPECT_EQ(summaries[0].latency.max, absl::Microseconds(3));
+  EXPECT_EQ(summaries[1].stage, LatencyStats::Stage::kSocketIo);
+  EXPECT_EQ(summaries[1].latency.max, absl::Microseconds(7));
+}
+
+TEST_F(LatencyStatsTest, RecordsStageThatTookNoTime) {
+  absl::Time start = absl::UnixEpoch() + absl::Hours(1);
+  PacketMetaData packet_meta_data = {
+      .packet_size = 100,
+      .encryption_start_time = start,
+      .encryption_end_time = start,
+  };
+
+  LatencyStats::GetInstance().RecordFrame(
+      Medium::BLUETOOTH, PayloadDirection::INCOMING_PAYLOAD, packet_meta_data);
+
+  std::vector<LatencyStats::StageSummary> summaries =
+      LatencyStats::GetInstance().GetSummaries();
+  ASSERT_EQ(summaries.size(), 1);
+  EXPECT_EQ(summaries[0].stage, LatencyStats::Stage::kEncryption);
+  EXPECT_EQ(summaries[0].latency.count, 1);
+  EXPECT_EQ(summaries[0].latency.max, absl::ZeroDuration());
+}
+
+TEST_F(LatencyStatsTest, IgnoresStageThatWasNotStopped) {
+  absl::Time start = absl::UnixEpoch() + absl::Hours(1);
+  PacketMetaData packet_meta_data = {
+      .packet_size = 100,
+      .socket_io_start_time = start,
+  };
+
+  LatencyStats::GetInstance().RecordFrame(
+      Medium::BLUETOOTH, PayloadDirection::INCOMING_PAYLOAD, packet_meta_data);
+
+  EXPECT_TRUE(LatencyStats::GetInstance().GetSummaries().empty());
+}
+
+TEST_F(LatencyStatsTest, KeepsMediumsAndDirectionsApart) {
+  LatencyStats& stats = LatencyStats::GetInstance();
+
+  stats.Record(Medium::BLUETOOTH, PayloadDirection::INCOMING_PAYLOAD,
+               LatencyStats::Stage::kEncryption, absl::Microseconds(1));
+  stats.Record(Medium::BLUETOOTH, PayloadDirection::OUTGOING_PAYLOAD,
+               LatencyStats::Stage::kEncryption, absl::Microseconds(2));
+  stats.Record(Medium::WEB_RTC, PayloadDirection::INCOMING_PAYLOAD,
+               LatencyStats::Stage::kEncryption, absl::Microseconds(3));
+
+  std::vector<LatencyStats::StageSummary> summaries = stats.GetSummaries();
+  ASSERT_EQ(summaries.size(), 3);
+  for (const LatencyStats::StageSummary& summary : summaries) {
+    EXPECT_EQ(summary.latency.count, 1);
+    if (summary.medium == Medium::WEB_RTC) {
+      EXPECT_EQ(summary.latency.max, absl::Microseconds(3));
+    } else if (summary.direction == PayloadDirection::INCOMING_PAYLOAD) {
+      EXPECT_EQ(summary.latency.max, absl::Microseconds(1));
+    } else {
+      EXPECT_EQ(summary.latency.max, absl::Microseconds(2));
+    }
+  }
+}
+
+TEST_F(LatencyStatsTest, IgnoresUnknownMedium) {
+  LatencyStats::GetInstance().Record(static_cast<Medium>(-1),
+                                     PayloadDirection::INCOMING_PAYLOAD,
+                                     LatencyStats::Stage::kSocketIo,
+                                     absl::Microseconds(1));
+
+  EXPECT_TRUE(LatencyStats::GetInstance().GetSummaries().empty());
+}
+
+}  // namespace
+}  // namespace analytics
+}  // namespace nearby
@@ -16,6 +16,7 @@
 #define NEARBY_CONNECTIONS_IMPLEMENTATION_ANALYTICS_PACKET_META_DATA_H_
 
 #include <cstdint>
+#include <optional>
 
 #include "absl/time/time.h"
 #include "internal/platform/implementation/system_clock.h"
@@ -26,12 +27,12 @@ namespace analytics {
 
 struct PacketMetaData {
   int packet_size;
-  absl::Time file_io_start_time;
-  absl::Time file_io_end_time;
-  absl::Time encryption_start_time;
-  absl::Time encryption_end_time;
-  absl::Time socket_io_start_time;
-  absl::Time socket_io_end_time;
+  absl::Time file_io_start_time = absl::InfinitePast();
+  absl::Time file_io_end_time = absl::InfinitePast();
+  absl::Time encryption_start_time = absl::InfinitePast();
+  absl::Time encryption_end_time = absl::InfinitePast();
+  absl::Time socket_io_start_time = absl::InfinitePast();
+  absl::Time socket_io_end_time = absl::InfinitePast();
 
   void Reset() {
     file_io_start_time = SystemClock::ElapsedRealtime();
@@ -72,27 +73,42 @@ struct PacketMetaData {
     socket_io_end_time = SystemClock::ElapsedRealtime();
   }
 
+  // The stage durations below are std::nullopt if the stage was not measured,
+  // that is, if it was not stopped after it was started. A measured stage may
+  // take no time at all at the resolution of the clock.
+  std::optional<absl::Duration> GetEncryptionTime() const {
+    return GetStageTime(encryption_start_time, encryption_end_time);
+  }
+
+  std::optional<absl::Duration> GetFileIoTime() const {
+    return GetStageTime(file_io_start_time, file_io_end_time);
+  }
+
+  std::optional<absl::Duration> GetSocketIoTime() const {
+    return GetStageTime(socket_io_start_time, socket_io_end_time);
+  }
+
   int64_t GetEncryptionTimeInMillis() {
-    if (encryption_end_time > encryption_start_time) {
-      return absl::ToInt64Milliseconds(encryption_end_time -
-                                       encryption_start_time);
-    }
-    return 0L;
+    return absl::ToInt64Milliseconds(
+        GetEncryptionTime().value_or(absl::ZeroDuration()));
   }
 
   int64_t GetFileIoTimeInMillis() {
-    if (file_io_end_time > file_io_start_time) {
-      return absl::ToInt64Milliseconds(file_io_end_time - file_io_start_time);
-    }
-    return 0L;
+    return absl::ToInt64Milliseconds(
+        GetFileIoTime().value_or(absl::ZeroDuration()));
   }
 
   int64_t GetSocketIoTimeInMillis() {
-    if (socket_io_end_time > socket_io_start_time) {
-      return absl::ToInt64Milliseconds(socket_io_end_time -
-                                       socket_io_start_time);
+    return absl::ToInt64Milliseconds(
+        GetSocketIoTime().value_or(absl::ZeroDuration()));
+  }
+
+  static std::optional<absl::Duration> GetStageTime(absl::Time start_time,
+                                                    absl::Time end_time) {
+    if (start_time == absl::InfinitePast() || end_time < start_time) {
+      return std::nullopt;
     }
-    return 0L;
+    return end_time - start_time;
   }
 };
 
@@ -26,6 +26,7 @@
 #include "absl/meta/type_traits.h"
 #include "absl/strings/str_format.h"
 #include "absl/time/time.h"
+#include "connections/implementation/analytics/latency_stats.h"
 #include "internal/platform/implementation/system_clock.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/mutex_lock.h"
@@ -218,6 +219,8 @@ int64_t ThroughputRecorder::GetDurationMillis() { return duration_millis_; }
 
 void ThroughputRecorder::OnFrameSent(Medium medium,
                                      PacketMetaData& packetMetaData) {
+  LatencyStats::GetInstance().RecordFrame(
+      medium, PayloadDirection::OUTGOING_PAYLOAD, packetMetaData);
   MutexLock lock(&mutex_);
   if (payload_type_ == PayloadType::kUnknown) {
     NEARBY_LOGS(INFO) << "PayloadType is invalid, return";
@@ -236,6 +239,8 @@ void ThroughputRecorder::OnFrameSent(Medium medium,
 
 void ThroughputRecorder::OnFrameReceived(Medium medium,
                                          PacketMetaData& packetMetaData) {
+  LatencyStats::GetInstance().RecordFrame(
+      medium, PayloadDirection::INCOMING_PAYLOAD, packetMetaData);
   MutexLock lock(&mutex_);
   if (payload_type_ == PayloadType::kUnknown) {
     NEARBY_LOGS(INFO) << "PayloadType is invalid, return";
@@ -59,14 +59,11 @@ std::int32_t BytesToInt(const ByteArray& bytes) {
   return result;
 }
 
-ByteArray IntToBytes(std::int32_t value) {
-  char int_bytes[sizeof(std::int32_t)];
-  int_bytes[0] = static_cast<char>((value >> 24) & 0x0FF);
-  int_bytes[1] = static_cast<char>((value >> 16) & 0x0FF);
-  int_bytes[2] = static_cast<char>((value >> 8) & 0x0FF);
-  int_bytes[3] = static_cast<char>((value) & 0x0FF);
-
-  return ByteArray(int_bytes, sizeof(int_bytes));
+void AppendIntBytes(std::int32_t value, std::string& output) {
+  output.push_back(static_cast<char>((value >> 24) & 0x0FF));
+  output.push_back(static_cast<char>((value >> 16) & 0x0FF));
+  output.push_back(static_cast<char>((value >> 8) & 0x0FF));
+  output.push_back(static_cast<char>((value) & 0x0FF));
 }
 
 ExceptionOr<std::int32_t> ReadInt(InputStream* reader) {
@@ -77,10 +74,6 @@ ExceptionOr<std::int32_t> ReadInt(InputStream* reader) {
   return ExceptionOr<std::int32_t>(BytesToInt(std::move(read_bytes.result())));
 }
 
-Exception WriteInt(OutputStream* writer, std::int32_t value) {
-  return writer->Write(IntToBytes(value));
-}
-
 }  // namespace
 
 BaseEndpointChannel::BaseEndpointChannel(const std::string& service_id,
@@ -129,7 +122,6 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read(
   {
     MutexLock lock(&reader_mutex_);
 
-    packet_meta_data.StartSocketIo();
     ExceptionOr<std::int32_t> read_int = ReadInt(reader_);
     if (!read_int.ok()) {
       return ExceptionOr<ByteArray>(read_int.exception());
@@ -141,6 +133,10 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read(
       return ExceptionOr<ByteArray>(Exception::kIo);
     }
 
+    // Reading the length prefix blocks until the peer sends a frame, so only
+    // the read of the frame itself is counted as socket I/O, not the time the
+    // channel was idle.
+    packet_meta_data.StartSocketIo();
     ExceptionOr<ByteArray> read_bytes = reader_->ReadExactly(read_int.result());
     if (!read_bytes.ok()) {
       return read_bytes;
@@ -154,11 +150,12 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read(
     MutexLock crypto_lock(&crypto_mutex_);
     Exception message_exception{Exception::kInvalidProtocolBuffer};
     if (IsEncryptionEnabledLocked()) {
-      // If encryption is enabled, decode the message.
-      std::string input(std::move(result));
+      // If encryption is enabled, decode the message. The ciphertext is
+      // decoded straight from the read buffer, and only replaced by the
+      // plaintext once that succeeds.
       packet_meta_data.StartEncryption();
       std::unique_ptr<std::string> decrypted_data =
-          crypto_context_->DecodeMessageFromPeer(input);
+          crypto_context_->DecodeMessageFromPeer(result.AsString());
       if (decrypted_data) {
         result = ByteArray(std::move(*decrypted_data));
       } else {
@@ -168,24 +165,24 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read(
         // In this case, we verify that message is indeed a valid KEEP_ALIVE,
         // and let it through if it is, otherwise message is erased.
         // TODO(apolyudov): verify this happens at most once per session.
-        result = {};
-        auto parsed = parser::FromBytes(ByteArray(input));
+        auto parsed = parser::FromBytes(result);
         if (parsed.ok()) {
           if (parser::GetFrameType(parsed.result()) ==
               location::nearby::connections::V1Frame::KEEP_ALIVE) {
             NEARBY_LOGS(INFO)
                 << __func__
                 << ": Read unencrypted KEEP_ALIVE on encrypted channel.";
-            result = ByteArray(input);
           } else {
             NEARBY_LOGS(WARNING)
                 << __func__ << ": Read unexpected unencrypted frame of type "
                 << parser::GetFrameType(parsed.result());
+            result = {};
           }
         } else {
           message_exception.value = parsed.exception();
           NEARBY_LOGS(WARNING)
               << __func__ << ": Unable to parse data as unencrypted message.";
+          result = {};
         }
       }
       packet_meta_data.StopEncryption();
@@ -215,49 +212,85 @@ Exception BaseEndpointChannel::Write(const ByteArray& data,
     if (is_paused_) {
       BlockUntilUnpaused();
     }
+    writes_in_progress_++;
   }
+  return WriteFrame(data, packet_meta_data);
+}
 
-  ByteArray encrypted_data;
-  const ByteArray* data_to_write = &data;
+Exception BaseEndpointChannel::TryWrite(const ByteArray& data,
+                                        absl::Duration timeout) {
+  {
+    MutexLock pause_lock(&is_paused_mutex_);
+    absl::Time deadline = SystemClock::ElapsedRealtime() + timeout;
+    while (is_paused_ || writes_in_progress_ > 0) {
+      absl::Duration remaining = deadline - SystemClock::ElapsedRealtime();
+      if (remaining <= absl::ZeroDuration()) {
+        return {Exception::kTimeout};
+      }
+      is_paused_cond_.Wait(remaining);
+    }
+    writes_in_progress_++;
+  }
+  PacketMetaData packet_meta_data;
+  return WriteFrame(data, packet_meta_data);
+}
+
+Exception BaseEndpointChannel::WriteFrame(const ByteArray& data,
+                                          PacketMetaData& packet_meta_data) {
+  Exception result = EncryptAndWrite(data, packet_meta_data);
+  MutexLock pause_lock(&is_paused_mutex_);
+  writes_in_progress_--;
+  // Wakes up TryWrite() calls waiting for the writer.
+  is_paused_cond_.Notify();
+  return result;
+}
+
+Exception BaseEndpointChannel::EncryptAndWrite(
+    const ByteArray& data, PacketMetaData& packet_meta_data) {
   {
     // Holding both mutexes is necessary to prevent the keep alive and payload
     // threads from writing encrypted messages out of order which causes a
     // failure to decrypt on the reader side. However we need to release the
     // crypto lock after encrypting to ensure read decryption is not blocked.
     MutexLock lock(&writer_mutex_);
+    std::unique_ptr<std::string> encrypted;
+    absl::string_view data_to_write = data.AsStringView();
     {
       MutexLock crypto_lock(&crypto_mutex_);
       if (IsEncryptionEnabledLocked()) {
         // If encryption is enabled, encode the message.
         packet_meta_data.StartEncryption();
-        std::unique_ptr<std::string> encrypted =
-            crypto_context_->EncodeMessageToPeer(std::string(data));
+        encrypted = crypto_context_->EncodeMessageToPeer(data.AsString());
         packet_meta_data.StopEncryption();
         if (!encrypted) {
           NEARBY_LOGS(WARNING) << __func__ << ": Failed to encrypt data.";
           return {Exception::kIo};
         }
-        encrypted_data = ByteArray(std::move(*encrypted));
-        data_to_write = &encrypted_data;
+        data_to_write = *encrypted;
       }
     }
 
-    size_t data_size = data_to_write->size();
+    size_t data_size = data_to_write.size();
     if (data_size < 0 || data_size > max_allowed_read_bytes_) {
       NEARBY_LOGS(WARNING) << __func__ << ": Write an invalid number of bytes: "
                            << data_size;
       return {Exception::kIo};
     }
 
+    // The length header and the body are framed into a single buffer so the
+    // frame goes out in one write, rather than as a separate 4-byte packet
+    // ahead of the body. The buffer is recycled across writes to avoid an
+    // allocation per frame.
+    write_buffer_.clear();
+    write_buffer_.reserve(sizeof(std::int32_t) + data_size);
+    AppendIntBytes(static_cast<std::int32_t>(data_size), write_buffer_);
+    write_buffer_.append(data_to_write.data(), data_to_write.size());
+    encrypted.reset();
+    ByteArray frame(std::move(write_buffer_));
+
     packet_meta_data.StartSocketIo();
-    Exception write_exception =
-        WriteInt(writer_, static_cast<std::int32_t>(data_size));
-    if (write_exception.Raised()) {
-      NEARBY_LOGS(WARNING) << __func__ << ": Failed to write header: "
-                           << write_exception.value;
-      return write_exception;
-    }
-    write_exception = writer_->Write(*data_to_write);
+    Exception write_exception = writer_->Write(frame);
+    write_buffer_ = std::string(std::move(frame));
     if (write_exception.Raised()) {
       NEARBY_LOGS(WARNING) << __func__ << ": Failed to write data: "
                            << write_exception.value;
@@ -400,7 +433,7 @@ ExceptionOr<ByteArray> BaseEndpointChannel::TryDecrypt(const ByteArray& data) {
     return Exception::kFailed;
   }
   std::unique_ptr<std::string> decrypted_data =
-      crypto_context_->DecodeMessageFromPeer(data.string_data());
+      crypto_context_->DecodeMessageFromPeer(data.AsString());
   if (decrypted_data) {
     return ExceptionOr<ByteArray>(ByteArray(std::move(*decrypted_data)));
   }
@@ -58,6 +58,8 @@ class BaseEndpointChannel : public EndpointChannel {
   Exception Write(const ByteArray& data) override;
   Exception Write(const ByteArray& data, PacketMetaData& packet_meta_data)
       ABSL_LOCKS_EXCLUDED(writer_mutex_, crypto_mutex_) override;
+  Exception TryWrite(const ByteArray& data, absl::Duration timeout)
+      ABSL_LOCKS_EXCLUDED(is_paused_mutex_) override;
   void Close() ABSL_LOCKS_EXCLUDED(is_paused_mutex_) override;
   void Close(location::nearby::proto::connections::DisconnectionReason reason)
       override;
@@ -106,6 +108,13 @@ class BaseEndpointChannel : public EndpointChannel {
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(crypto_mutex_);
   void UnblockPausedWriter() ABSL_EXCLUSIVE_LOCKS_REQUIRED(is_paused_mutex_);
   void BlockUntilUnpaused() ABSL_EXCLUSIVE_LOCKS_REQUIRED(is_paused_mutex_);
+  // Writes `data` for a write counted in `writes_in_progress_`, and then
+  // stops counting it.
+  Exception WriteFrame(const ByteArray& data, PacketMetaData& packet_meta_data)
+      ABSL_LOCKS_EXCLUDED(is_paused_mutex_);
+  Exception EncryptAndWrite(const ByteArray& data,
+                            PacketMetaData& packet_meta_data)
+      ABSL_LOCKS_EXCLUDED(writer_mutex_, crypto_mutex_);
   void CloseIo() ABSL_NO_THREAD_SAFETY_ANALYSIS;
 
   // We need a separate mutex to protect read timestamp, because if a read
@@ -137,6 +146,10 @@ class BaseEndpointChannel : public EndpointChannel {
 
   Mutex writer_mutex_;
   OutputStream* writer_ ABSL_PT_GUARDED_BY(writer_mutex_);
+  // Scratch buffer used to frame the length header and the body of an outgoing
+  // message, so that it can be written out in a single call. Kept around
+  // between writes to reuse its allocation.
+  std::string write_buffer_ ABSL_GUARDED_BY(writer_mutex_);
 
   // An encryptor/decryptor. May be null.
   mutable Mutex crypto_mutex_;
@@ -148,6 +161,8 @@ class BaseEndpointChannel : public EndpointChannel {
   // If true, writes should block until this has been set to false.
   bool is_paused_ ABSL_GUARDED_BY(is_paused_mutex_) = false;
   bool is_closed_ ABSL_GUARDED_BY(is_paused_mutex_) = false;
+  // Number of writes past the pause check, running or waiting for the writer.
+  int writes_in_progress_ ABSL_GUARDED_BY(is_paused_mutex_) = 0;
 
   // The medium technology information of this endpoint channel.
   location::nearby::proto::connections::ConnectionTechnology technology_;
@@ -15,10 +15,12 @@
 #include "connections/implementation/base_endpoint_channel.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "securegcm/ukey2_handshake.h"
 #include "gmock/gmock.h"
@@ -37,9 +39,11 @@
 #include "internal/platform/exception.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/medium_environment.h"
 #include "internal/platform/multi_thread_executor.h"
 #include "internal/platform/output_stream.h"
 #include "internal/platform/pipe.h"
+#include "internal/test/fake_clock.h"
 #include "proto/connections_enums.pb.h"
 
 namespace nearby {
@@ -181,6 +185,34 @@ TEST(BaseEndpointChannelTest, ReadWrite) {
   EXPECT_EQ(rx_message, tx_message);
 }
 
+TEST(BaseEndpointChannelTest, WriteSendsHeaderAndBodyInSingleWrite) {
+  class RecordingOutputStream : public OutputStream {
+   public:
+    Exception Write(const ByteArray& data) override {
+      writes.push_back(data);
+      return {Exception::kSuccess};
+    }
+    Exception Flush() override { return {Exception::kSuccess}; }
+    Exception Close() override { return {Exception::kSuccess}; }
+
+    std::vector<ByteArray> writes;
+  };
+  auto pipe = CreatePipe();
+  RecordingOutputStream output;
+  TestEndpointChannel channel(pipe.first.get(), &output);
+  ByteArray tx_message{"data message"};
+
+  // The second write reuses the buffer of the first one.
+  EXPECT_FALSE(channel.Write(tx_message).Raised());
+  EXPECT_FALSE(channel.Write(tx_message).Raised());
+
+  ASSERT_EQ(output.writes.size(), 2);
+  std::string expected_frame("\x00\x00\x00\x0c", 4);
+  expected_frame.append("data message");
+  EXPECT_EQ(output.writes[0].string_data(), expected_frame);
+  EXPECT_EQ(output.writes[1].string_data(), expected_frame);
+}
+
 TEST(BaseEndpointChannelTest, ChannelUnencryptedByDefault) {
   auto pipe = CreatePipe();
   TestEndpointChannel channel(pipe.first.get(), pipe.second.get());
@@ -398,6 +430,54 @@ TEST(BaseEndpointChannelTest, CanBesuspendedAndResumed) {
   channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
 }
 
+TEST(BaseEndpointChannelTest, TryWriteGivesUpWhilePaused) {
+  auto pipe_a = CreatePipe();  // channel_a writes to pipe_a, reads from pipe_b.
+  auto pipe_b = CreatePipe();  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(pipe_b.first.get(), pipe_a.second.get());
+  TestEndpointChannel channel_b(pipe_a.first.get(), pipe_b.second.get());
+  ByteArray tx_message{"data message"};
+
+  channel_a.Pause();
+  EXPECT_TRUE(channel_a.TryWrite(tx_message, absl::Milliseconds(50))
+                  .Raised(Exception::kTimeout));
+
+  channel_a.Resume();
+  EXPECT_TRUE(channel_a.TryWrite(tx_message, absl::Milliseconds(50)).Ok());
+  EXPECT_EQ(channel_b.Read().result(), tx_message);
+}
+
+TEST(BaseEndpointChannelTest, TryWriteGivesUpWhileAnotherWriteIsStuck) {
+  class StuckOutputStream : public OutputStream {
+   public:
+    Exception Write(const ByteArray& data) override {
+      release.Await();
+      return {Exception::kSuccess};
+    }
+    Exception Flush() override { return {Exception::kSuccess}; }
+    Exception Close() override { return {Exception::kSuccess}; }
+
+    CountDownLatch release{1};
+  };
+  auto pipe = CreatePipe();
+  StuckOutputStream output;
+  TestEndpointChannel channel(pipe.first.get(), &output);
+  MultiThreadExecutor executor(1);
+  CountDownLatch written(1);
+  executor.Execute([&channel, &written]() {
+    EXPECT_TRUE(channel.Write(ByteArray("payload chunk")).Ok());
+    written.CountDown();
+  });
+  absl::SleepFor(absl::Milliseconds(100));
+
+  EXPECT_TRUE(channel.TryWrite(ByteArray("keep-alive"), absl::Milliseconds(50))
+                  .Raised(Exception::kTimeout));
+
+  output.release.CountDown();
+  EXPECT_TRUE(written.Await(absl::Milliseconds(1000)).result());
+  EXPECT_TRUE(
+      channel.TryWrite(ByteArray("keep-alive"), absl::Milliseconds(50)).Ok());
+}
+
 TEST(BaseEndpointChannelTest, ReadAfterInputStreamClosed) {
   auto [input, output] = CreatePipe();
 
@@ -413,6 +493,44 @@ TEST(BaseEndpointChannelTest, ReadAfterInputStreamClosed) {
   ASSERT_TRUE(read_data.GetException().Raised(Exception::kIo));
 }
 
+TEST(BaseEndpointChannelTest, IdleTimeBeforeFrameIsNotCountedAsSocketIo) {
+  // Hands out the length prefix of a frame after the channel was idle for a
+  // minute, then its body after 10ms, on the simulated clock.
+  class DelayedFrameInputStream : public InputStream {
+   public:
+    explicit DelayedFrameInputStream(FakeClock* clock) : clock_(clock) {}
+
+    ExceptionOr<ByteArray> Read(std::int64_t size) override {
+      if (!prefix_read_) {
+        prefix_read_ = true;
+        clock_->FastForward(absl::Minutes(1));
+        return ExceptionOr<ByteArray>(
+            ByteArray(std::string("\x00\x00\x00\x04", 4)));
+      }
+      clock_->FastForward(absl::Milliseconds(10));
+      return ExceptionOr<ByteArray>(ByteArray(std::string("data")));
+    }
+    Exception Close() override { return {Exception::kSuccess}; }
+
+   private:
+    FakeClock* clock_;
+    bool prefix_read_ = false;
+  };
+  MediumEnvironment& env = MediumEnvironment::Instance();
+  env.Start({.use_simulated_clock = true});
+  DelayedFrameInputStream input(*env.GetSimulatedClock());
+  auto pipe = CreatePipe();
+  TestEndpointChannel channel(&input, pipe.second.get());
+  PacketMetaData packet_meta_data;
+
+  ExceptionOr<ByteArray> result = channel.Read(packet_meta_data);
+
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.result(), ByteArray(std::string("data")));
+  EXPECT_EQ(packet_meta_data.GetSocketIoTime(), absl::Milliseconds(10));
+  env.Stop();
+}
+
 TEST(BaseEndpointChannelTest, ReadUnencryptedFrameOnEncryptedChannel) {
   // Setup test communication environment.
   auto pipe_a = CreatePipe();  // channel_a writes to pipe_a, reads from pipe_b.
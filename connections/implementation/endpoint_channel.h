@@ -47,6 +47,13 @@ class EndpointChannel {
   virtual Exception Write(
       const ByteArray& data,
       PacketMetaData& packet_meta_data) = 0;  // throws Exception::IO
+
+  // Like Write(), but gives up with Exception::kTimeout, without writing
+  // anything, if the channel stays paused or busy with other writes for longer
+  // than `timeout`.
+  virtual Exception TryWrite(const ByteArray& data, absl::Duration timeout) {
+    return Write(data);
+  }
   // Closes this EndpointChannel, without tracking the closure in analytics.
 
   virtual void Close() = 0;
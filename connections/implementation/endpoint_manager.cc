@@ -16,12 +16,17 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/functional/any_invocable.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "connections/connection_options.h"
 #include "connections/implementation/analytics/packet_meta_data.h"
@@ -36,6 +41,7 @@
 #include "connections/medium_selector.h"
 #include "connections/payload_type.h"
 #include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/feature_flags.h"
@@ -69,6 +75,14 @@ constexpr absl::Time kInvalidTimestamp = absl::InfinitePast();
 // The maximum time we will wait for the encryption setup during negotiating a
 // connection.
 constexpr absl::Duration kDecryptRetryTimeout = absl::Seconds(3);
+// The maximum number of frames queued for an endpoint before the sender blocks.
+// Queued frames are shared between endpoints, so this bounds the memory to
+// about this many chunks per payload, regardless of the number of endpoints.
+constexpr int kMaxPendingFramesPerEndpoint = 4;
+// The maximum time the sender waits for an endpoint's queue to drain. An
+// endpoint that doesn't write a frame for that long is stuck, and the payload
+// fails for it rather than holding back the other endpoints.
+constexpr absl::Duration kMaxEndpointWriterWait = absl::Seconds(3);
 }  // namespace
 
 class EndpointManager::LockedFrameProcessor {
@@ -105,6 +119,91 @@ class EndpointManager::LockedFrameProcessor {
   FrameProcessorWithMutex* frame_processor_with_mutex_ = nullptr;
 };
 
+class EndpointManager::EndpointWriter {
+ public:
+  EndpointWriter() = default;
+  EndpointWriter(const EndpointWriter&) = delete;
+  EndpointWriter& operator=(const EndpointWriter&) = delete;
+
+  // Queues `write` to run on the writer thread. Blocks while there are already
+  // kMaxPendingFramesPerEndpoint frames queued. `write` returns false on
+  // failure, which is remembered for `payload_id`: the frames of that payload
+  // queued afterwards are dropped, and fail as well. `on_done`, if set, is
+  // called on the writer thread with the result once the frame is written.
+  //
+  // Returns false without queuing `write` if the queue is still full after
+  // kMaxEndpointWriterWait; `payload_id` is then failed as well.
+  bool Enqueue(std::int64_t payload_id, absl::AnyInvocable<bool()> write,
+               absl::AnyInvocable<void(bool)> on_done)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    {
+      MutexLock lock(&mutex_);
+      if (!WaitForPendingFramesBelow(kMaxPendingFramesPerEndpoint,
+                                     payload_id)) {
+        return false;
+      }
+      pending_frames_++;
+    }
+    executor_.Execute("endpoint-writer", [this, payload_id,
+                                          write = std::move(write),
+                                          on_done =
+                                              std::move(on_done)]() mutable {
+      bool succeeded = !HasFailed(payload_id) && write();
+      if (on_done) {
+        on_done(succeeded);
+      }
+      MutexLock lock(&mutex_);
+      if (!succeeded) {
+        failed_payload_ids_.insert(payload_id);
+      }
+      pending_frames_--;
+      cond_.Notify();
+    });
+    return true;
+  }
+
+  // Blocks until all queued frames have been written. Returns false, and
+  // fails `payload_id`, if they aren't written within kMaxEndpointWriterWait.
+  bool Flush(std::int64_t payload_id) ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    return WaitForPendingFramesBelow(1, payload_id);
+  }
+
+  // Returns true if a queued write for `payload_id` failed, or the endpoint
+  // got stuck while sending it. Failures are remembered for as long as the
+  // writer lives; a failed write makes the endpoint be discarded, which
+  // destroys its writer.
+  bool HasFailed(std::int64_t payload_id) ABSL_LOCKS_EXCLUDED(mutex_) {
+    MutexLock lock(&mutex_);
+    return failed_payload_ids_.contains(payload_id);
+  }
+
+ private:
+  bool WaitForPendingFramesBelow(int max_pending_frames,
+                                 std::int64_t payload_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    absl::Time deadline =
+        SystemClock::ElapsedRealtime() + kMaxEndpointWriterWait;
+    while (pending_frames_ >= max_pending_frames) {
+      absl::Duration remaining = deadline - SystemClock::ElapsedRealtime();
+      if (remaining <= absl::ZeroDuration()) {
+        failed_payload_ids_.insert(payload_id);
+        return false;
+      }
+      cond_.Wait(remaining);
+    }
+    return true;
+  }
+
+  Mutex mutex_;
+  ConditionVariable cond_{&mutex_};
+  int pending_frames_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_set<std::int64_t> failed_payload_ids_ ABSL_GUARDED_BY(mutex_);
+  // Must be the last member, so that it is destroyed (and waits for the
+  // pending writes) before the state they update.
+  SingleThreadExecutor executor_;
+};
+
 // A Runnable that continuously grabs the most recent EndpointChannel available
 // for an endpoint.
 //
@@ -372,10 +471,9 @@ void EndpointManager::ProcessDisconnectionFrame(
   }
 }
 
-ExceptionOr<bool> EndpointManager::HandleKeepAlive(
+ExceptionOr<std::optional<absl::Duration>> EndpointManager::HandleKeepAlive(
     EndpointChannel* endpoint_channel, absl::Duration keep_alive_interval,
-    absl::Duration keep_alive_timeout, Mutex* keep_alive_waiter_mutex,
-    ConditionVariable* keep_alive_waiter) {
+    absl::Duration keep_alive_timeout) {
   // Check if it has been too long since we received a frame from our endpoint.
   absl::Time last_read_time = endpoint_channel->GetLastReadTimestamp();
   absl::Duration duration_until_timeout =
@@ -384,13 +482,14 @@ ExceptionOr<bool> EndpointManager::HandleKeepAlive(
           : last_read_time + keep_alive_timeout -
                 SystemClock::ElapsedRealtime();
   if (duration_until_timeout <= absl::ZeroDuration()) {
-    return ExceptionOr<bool>(false);
+    return ExceptionOr<std::optional<absl::Duration>>(std::nullopt);
   }
 
   // If we haven't written anything to the endpoint for a while, attempt to
   // send the KeepAlive frame over the endpoint channel. If the write fails,
-  // our super class will loop back around and try our luck again in case
-  // there's been a replacement for this endpoint.
+  // CheckKeepAlive() will try our luck again in case there's been a
+  // replacement for this endpoint. Any other write, such as a payload chunk,
+  // pushes the next KeepAlive frame back.
   absl::Time last_write_time = endpoint_channel->GetLastWriteTimestamp();
   absl::Duration duration_until_write_keep_alive =
       last_write_time == kInvalidTimestamp
@@ -399,29 +498,75 @@ ExceptionOr<bool> EndpointManager::HandleKeepAlive(
                 SystemClock::ElapsedRealtime();
   if (duration_until_write_keep_alive <= absl::ZeroDuration()) {
     uint32_t seq_num = endpoint_channel->GetNextKeepAliveSeqNo();
-    Exception write_exception = endpoint_channel->Write(
-        parser::ForKeepAlive(/*ack=*/false, /*seq_num=*/seq_num));
+    Exception write_exception = endpoint_channel->TryWrite(
+        parser::ForKeepAlive(/*ack=*/false, /*seq_num=*/seq_num),
+        kKeepAliveWriteTimeout);
+    if (write_exception.Raised(Exception::kTimeout)) {
+      // The channel is paused for a bandwidth upgrade, or busy with other
+      // writes, which will push the next KeepAlive frame back anyway. Don't
+      // hold the worker; try again after the interval.
+      LOG(INFO) << "Skipped a KEEP_ALIVE frame (ack:false, seq_num:" << seq_num
+                << ") on busy channel " << endpoint_channel->GetType();
+      return ExceptionOr<std::optional<absl::Duration>>(
+          std::min(duration_until_timeout, keep_alive_interval));
+    }
     if (!write_exception.Ok()) {
       LOG(ERROR) << "Failed to send KEEP_ALIVE frame (ack:false, seq_num:"
                  << seq_num << ") on channel " << endpoint_channel->GetType();
-      return ExceptionOr<bool>(write_exception);
+      return ExceptionOr<std::optional<absl::Duration>>(write_exception);
     }
     duration_until_write_keep_alive = keep_alive_interval;
     LOG(INFO) << "Sent a KEEP_ALIVE frame (ack:false, seq_num:" << seq_num
               << ") on channel " << endpoint_channel->GetType();
   }
 
-  absl::Duration wait_for =
-      std::min(duration_until_timeout, duration_until_write_keep_alive);
-  {
-    MutexLock lock(keep_alive_waiter_mutex);
-    Exception wait_exception = keep_alive_waiter->Wait(wait_for);
-    if (!wait_exception.Ok()) {
-      return ExceptionOr<bool>(wait_exception);
+  return ExceptionOr<std::optional<absl::Duration>>(
+      std::min(duration_until_timeout, duration_until_write_keep_alive));
+}
+
+std::optional<absl::Duration> EndpointManager::CheckKeepAlive(
+    ClientProxy* client, const std::string& endpoint_id,
+    absl::Duration keep_alive_interval, absl::Duration keep_alive_timeout,
+    Medium& last_failed_medium) {
+  // Same channel selection as EndpointChannelLoopRunnable(), one check at a
+  // time.
+  std::shared_ptr<EndpointChannel> channel =
+      channel_manager_->GetChannelForEndpoint(endpoint_id);
+  if (channel == nullptr) {
+    LOG(INFO) << "Endpoint channel is nullptr, stopping KeepAlive checks.";
+  } else if (last_failed_medium != Medium::UNKNOWN_MEDIUM &&
+             channel->GetMedium() == last_failed_medium) {
+    LOG(INFO) << "No new endpoint channel is found after a failure, stopping "
+                 "KeepAlive checks.";
+  } else {
+    ExceptionOr<std::optional<absl::Duration>> next_check =
+        HandleKeepAlive(channel.get(), keep_alive_interval, keep_alive_timeout);
+    if (next_check.ok() && next_check.result().has_value()) {
+      return next_check.result();
+    }
+    if (next_check.GetException().Raised(Exception::kIo)) {
+      last_failed_medium = channel->GetMedium();
+      LOG(INFO) << "Endpoint channel IO exception; last_failed_medium="
+                << location::nearby::proto::connections::Medium_Name(
+                       last_failed_medium);
+      // Retry right away, in case the channel was replaced.
+      return absl::ZeroDuration();
+    }
+    if (next_check.ok()) {
+      LOG(INFO) << "KeepAlive timed out, dropping current channel: medium="
+                << location::nearby::proto::connections::Medium_Name(
+                       channel->GetMedium());
+      if (client->IsSafeToDisconnectEnabled(endpoint_id)) {
+        channel_manager_->MarkEndpointStopWaitToDisconnect(
+            endpoint_id, /* is_safe_to_disconnect */ false,
+            /* notify_stop_waiting */ true);
+      }
     }
   }
-
-  return ExceptionOr<bool>(true);
+  // Always clear out all state related to this endpoint once it can't be kept
+  // alive anymore.
+  DiscardEndpoint(client, endpoint_id, DisconnectionReason::IO_ERROR);
+  return std::nullopt;
 }
 
 bool operator==(const EndpointManager::FrameProcessor& lhs,
@@ -457,6 +602,11 @@ EndpointManager::~EndpointManager() {
   RunOnEndpointManagerThread("bring-down-endpoints", [this, &latch]() {
     LOG(INFO) << "Bringing down endpoints";
     endpoints_.clear();
+    keep_alive_scheduler_.Shutdown();
+    {
+      MutexLock lock(&endpoint_writers_mutex_);
+      endpoint_writers_.clear();
+    }
     latch.CountDown();
   });
   latch.Await();
@@ -529,6 +679,10 @@ void EndpointManager::RemoveEndpointState(const std::string& endpoint_id) {
   } else {
     LOG(INFO) << "EndpointState not found for endpoint " << endpoint_id;
   }
+  // The channel is unregistered by now, so a KeepAlive check blocked on a
+  // write returns shortly.
+  keep_alive_scheduler_.Remove(endpoint_id);
+  RemoveEndpointWriter(endpoint_id);
 }
 
 void EndpointManager::RegisterEndpoint(
@@ -595,10 +749,10 @@ void EndpointManager::RegisterEndpoint(
               });
         });
 
-        // For every endpoint, there's only one KeepAliveManager instance
-        // running on a dedicated thread. This instance will periodically send
-        // out a ping* to the endpoint while listening for an incoming pong**.
-        // If it fails to send the ping, or if no pong is heard within
+        // For every endpoint, there's only one KeepAlive check scheduled on
+        // the KeepAliveScheduler shared by all endpoints. It periodically
+        // sends out a ping* to the endpoint while listening for an incoming
+        // pong**. If it fails to send the ping, or if no pong is heard within
         // keep_alive_timeout, it initiates a disconnection.
         //
         // (*) Bluetooth requires a constant outgoing stream of messages. If
@@ -609,19 +763,12 @@ void EndpointManager::RegisterEndpoint(
         // listen for the pong.
         NEARBY_VLOG(1) << "EndpointManager enabling KeepAlive for endpoint "
                        << endpoint_id;
-        endpoint_state.StartEndpointKeepAliveManager(
-            [this, client, endpoint_id, keep_alive_interval,
-             keep_alive_timeout](Mutex* keep_alive_waiter_mutex,
-                                 ConditionVariable* keep_alive_waiter) {
-              EndpointChannelLoopRunnable(
-                  "KeepAliveManager", client, endpoint_id,
-                  [this, keep_alive_interval, keep_alive_timeout,
-                   keep_alive_waiter_mutex,
-                   keep_alive_waiter](EndpointChannel* channel) {
-                    return HandleKeepAlive(
-                        channel, keep_alive_interval, keep_alive_timeout,
-                        keep_alive_waiter_mutex, keep_alive_waiter);
-                  });
+        keep_alive_scheduler_.Add(
+            endpoint_id, absl::ZeroDuration(),
+            [this, client, endpoint_id, keep_alive_interval, keep_alive_timeout,
+             last_failed_medium = Medium::UNKNOWN_MEDIUM]() mutable {
+              return CheckKeepAlive(client, endpoint_id, keep_alive_interval,
+                                    keep_alive_timeout, last_failed_medium);
             });
         LOG(INFO) << "Registering endpoint " << endpoint_id
                   << ", workers started and notifying client.";
@@ -663,16 +810,82 @@ std::vector<std::string> EndpointManager::SendPayloadChunk(
     const PayloadTransferFrame::PayloadHeader& payload_header,
     const PayloadTransferFrame::PayloadChunk& payload_chunk,
     const std::vector<std::string>& endpoint_ids,
-    PacketMetaData& packet_meta_data) {
-  ByteArray bytes =
-      parser::ForDataPayloadTransfer(payload_header, payload_chunk);
+    PacketMetaData& packet_meta_data, const WriteCallback& on_write_done) {
+  bool is_last_chunk =
+      (payload_chunk.flags() & PayloadTransferFrame::PayloadChunk::LAST_CHUNK) !=
+      0;
+  const std::string packet_type =
+      PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::DATA);
+
+  // Group the endpoints by the largest chunk they can carry. The chunk is sent
+  // whole to the endpoints that can take it, and in slices to the others, so
+  // that a single low-bandwidth endpoint doesn't force small chunks onto every
+  // endpoint of the payload. The largest frames go first, so the endpoints
+  // taking the whole chunk aren't queued behind the slices of the others.
+  const std::int64_t body_size = payload_chunk.body().size();
+  absl::btree_map<std::int64_t, std::vector<std::string>, std::greater<>>
+      endpoints_by_size;
+  for (const std::string& endpoint_id : endpoint_ids) {
+    std::int64_t max_size = GetMaxTransmitPacketSize(endpoint_id);
+    if (max_size <= 0 || max_size > body_size) {
+      max_size = body_size;
+    }
+    endpoints_by_size[max_size].push_back(endpoint_id);
+  }
+  if (endpoints_by_size.size() > 1) {
+    // Make sure every endpoint gets its own writer, so that the endpoints
+    // receiving many slices don't hold back the others.
+    for (const std::string& endpoint_id : endpoint_ids) {
+      GetEndpointWriter(endpoint_id, /*create=*/true);
+    }
+  }
 
-  return SendTransferFrameBytes(
-      endpoint_ids, bytes, payload_header.id(),
-      /*offset=*/payload_chunk.offset(),
-      /*packet_type=*/
-      PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::DATA),
-      packet_meta_data);
+  std::vector<std::string> failed_endpoint_ids;
+  for (auto& [slice_size, slice_endpoint_ids] : endpoints_by_size) {
+    if (slice_size >= body_size) {
+      std::vector<std::string> failed = SendTransferFrameBytes(
+          slice_endpoint_ids,
+          parser::ForDataPayloadTransfer(payload_header, payload_chunk),
+          payload_header.id(), /*offset=*/payload_chunk.offset(), packet_type,
+          packet_meta_data, /*wait_for_completion=*/is_last_chunk,
+          on_write_done);
+      failed_endpoint_ids.insert(failed_endpoint_ids.end(), failed.begin(),
+                                 failed.end());
+      continue;
+    }
+
+    const absl::string_view body = payload_chunk.body();
+    for (std::int64_t position = 0;
+         position < body_size && !slice_endpoint_ids.empty();
+         position += slice_size) {
+      const std::int64_t offset = payload_chunk.offset() + position;
+      // The chunk is done once its last slice is written. A queued slice that
+      // fails makes the following ones fail too, so the last one reports it.
+      const bool is_last_slice = position + slice_size >= body_size;
+      // The slice is written straight from the chunk body into the frame.
+      std::vector<std::string> failed = SendTransferFrameBytes(
+          slice_endpoint_ids,
+          parser::ForDataPayloadTransfer(
+              payload_header, payload_chunk.flags(), offset,
+              payload_chunk.index(), body.substr(position, slice_size)),
+          payload_header.id(), offset, packet_type, packet_meta_data,
+          /*wait_for_completion=*/is_last_chunk,
+          is_last_slice ? on_write_done : nullptr);
+      // Don't send the rest of the chunk to the endpoints that failed.
+      for (const std::string& endpoint_id : failed) {
+        slice_endpoint_ids.erase(std::remove(slice_endpoint_ids.begin(),
+                                             slice_endpoint_ids.end(),
+                                             endpoint_id),
+                                 slice_endpoint_ids.end());
+        if (on_write_done) {
+          on_write_done(endpoint_id, false);
+        } else {
+          failed_endpoint_ids.push_back(endpoint_id);
+        }
+      }
+    }
+  }
+  return failed_endpoint_ids;
 }
 
 // Designed to run asynchronously. It is called from IO thread pools, and
@@ -743,11 +956,11 @@ std::vector<std::string> EndpointManager::SendControlMessage(
   PacketMetaData packet_meta_data;
 
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, header.id(),
+      endpoint_ids, std::move(bytes), header.id(),
       /*offset=*/control.offset(),
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::CONTROL),
-      packet_meta_data);
+      packet_meta_data, /*wait_for_completion=*/true);
 }
 
 // @EndpointManagerThread
@@ -784,8 +997,8 @@ void EndpointManager::RemoveEndpoint(ClientProxy* client,
   }
 
   // Unregistering from channel_manager_ will also serve to terminate
-  // the dedicated handler and KeepAlive threads we started when we registered
-  // this endpoint.
+  // the dedicated handler thread and KeepAlive check we started when we
+  // registered this endpoint.
   if (channel_manager_->UnregisterChannelForEndpoint(endpoint_id, reason,
                                                      safe_disconnect_result)) {
     // Notify all frame processors of the disconnection immediately and wait
@@ -927,49 +1140,157 @@ std::vector<std::string> EndpointManager::SendPayloadAck(
   PacketMetaData packet_meta_data;
 
   return SendTransferFrameBytes(
-      endpoint_ids, bytes, payload_id,
+      endpoint_ids, std::move(bytes), payload_id,
       /* offset= */ -1,
       /*packet_type=*/
       PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::PAYLOAD_ACK),
-      packet_meta_data);
+      packet_meta_data, /*wait_for_completion=*/true);
 }
 
 std::vector<std::string> EndpointManager::SendTransferFrameBytes(
-    const std::vector<std::string>& endpoint_ids, const ByteArray& bytes,
+    const std::vector<std::string>& endpoint_ids, ByteArray bytes,
     std::int64_t payload_id, std::int64_t offset,
-    const std::string& packet_type, PacketMetaData& packet_meta_data) {
+    const std::string& packet_type, PacketMetaData& packet_meta_data,
+    bool wait_for_completion, const WriteCallback& on_write_done) {
   std::vector<std::string> failed_endpoint_ids;
-  for (const std::string& endpoint_id : endpoint_ids) {
-    std::shared_ptr<EndpointChannel> channel =
-        channel_manager_->GetChannelForEndpoint(endpoint_id);
-
-    if (channel == nullptr) {
-      // We no longer know about this endpoint (it was either explicitly
-      // unregistered, or a read/write error made us unregister it
-      // internally).
-      LOG(ERROR) << "EndpointManager failed to find EndpointChannel "
-                    "over which to write "
-                 << packet_type << " at offset " << offset << " of Payload "
-                 << payload_id << " to endpoint " << endpoint_id;
-
+  auto report = [&failed_endpoint_ids, &on_write_done](
+                    const std::string& endpoint_id, bool succeeded) {
+    if (on_write_done) {
+      on_write_done(endpoint_id, succeeded);
+    } else if (!succeeded) {
       failed_endpoint_ids.push_back(endpoint_id);
+    }
+  };
+  struct QueuedWrite {
+    std::string endpoint_id;
+    std::shared_ptr<EndpointWriter> writer;
+    std::shared_ptr<PacketMetaData> packet_meta_data;
+  };
+  std::vector<QueuedWrite> queued_writes;
+  // The frame is shared by all the writers instead of being copied per
+  // endpoint.
+  auto frame = std::make_shared<const ByteArray>(std::move(bytes));
+  for (const std::string& endpoint_id : endpoint_ids) {
+    std::shared_ptr<EndpointWriter> writer =
+        GetEndpointWriter(endpoint_id, /*create=*/endpoint_ids.size() > 1);
+    if (writer == nullptr) {
+      report(endpoint_id,
+             WriteTransferFrameBytes(endpoint_id, *frame, payload_id, offset,
+                                     packet_type, packet_meta_data));
       continue;
     }
 
-    Exception write_exception = channel->Write(bytes, packet_meta_data);
-    if (!write_exception.Ok()) {
-      failed_endpoint_ids.push_back(endpoint_id);
-      LOG(INFO) << "Failed to send packet; endpoint_id=" << endpoint_id;
+    if (writer->HasFailed(payload_id)) {
+      report(endpoint_id, false);
+      continue;
+    }
+    // Each queued write records its own timings, starting from the caller's.
+    auto queued_meta_data = std::make_shared<PacketMetaData>(packet_meta_data);
+    absl::AnyInvocable<void(bool)> on_done;
+    if (on_write_done && !wait_for_completion) {
+      on_done = [on_write_done, endpoint_id](bool succeeded) {
+        on_write_done(endpoint_id, succeeded);
+      };
+    }
+    if (!writer->Enqueue(
+            payload_id,
+            [this, endpoint_id, frame, payload_id, offset, packet_type,
+             queued_meta_data]() {
+              return WriteTransferFrameBytes(endpoint_id, *frame, payload_id,
+                                             offset, packet_type,
+                                             *queued_meta_data);
+            },
+            std::move(on_done))) {
+      LOG(WARNING) << "Endpoint " << endpoint_id << " is stuck; failing "
+                   << packet_type << " at offset " << offset << " of Payload "
+                   << payload_id;
+      report(endpoint_id, false);
       continue;
     }
-    analytics::ThroughputRecorderContainer::GetInstance()
-        .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
-        ->OnFrameSent(channel->GetMedium(), packet_meta_data);
+    queued_writes.push_back({endpoint_id, std::move(writer),
+                             std::move(queued_meta_data)});
+  }
+
+  if (wait_for_completion) {
+    for (QueuedWrite& queued_write : queued_writes) {
+      if (!queued_write.writer->Flush(payload_id)) {
+        // The write may still be running, and own its timings.
+        report(queued_write.endpoint_id, false);
+        continue;
+      }
+      report(queued_write.endpoint_id,
+             !queued_write.writer->HasFailed(payload_id));
+      // As with inline writes, the caller sees the timings of the last write.
+      packet_meta_data = *queued_write.packet_meta_data;
+    }
   }
 
   return failed_endpoint_ids;
 }
 
+bool EndpointManager::WriteTransferFrameBytes(const std::string& endpoint_id,
+                                              const ByteArray& bytes,
+                                              std::int64_t payload_id,
+                                              std::int64_t offset,
+                                              const std::string& packet_type,
+                                              PacketMetaData& packet_meta_data) {
+  std::shared_ptr<EndpointChannel> channel =
+      channel_manager_->GetChannelForEndpoint(endpoint_id);
+
+  if (channel == nullptr) {
+    // We no longer know about this endpoint (it was either explicitly
+    // unregistered, or a read/write error made us unregister it
+    // internally).
+    LOG(ERROR) << "EndpointManager failed to find EndpointChannel "
+                  "over which to write "
+               << packet_type << " at offset " << offset << " of Payload "
+               << payload_id << " to endpoint " << endpoint_id;
+    return false;
+  }
+
+  Exception write_exception = channel->Write(bytes, packet_meta_data);
+  if (!write_exception.Ok()) {
+    LOG(INFO) << "Failed to send packet; endpoint_id=" << endpoint_id;
+    return false;
+  }
+  analytics::ThroughputRecorderContainer::GetInstance()
+      .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
+      ->OnFrameSent(channel->GetMedium(), packet_meta_data);
+  return true;
+}
+
+std::shared_ptr<EndpointManager::EndpointWriter>
+EndpointManager::GetEndpointWriter(const std::string& endpoint_id,
+                                   bool create) {
+  MutexLock lock(&endpoint_writers_mutex_);
+  auto it = endpoint_writers_.find(endpoint_id);
+  if (it != endpoint_writers_.end()) {
+    return it->second;
+  }
+  if (!create) {
+    return nullptr;
+  }
+  auto writer = std::make_shared<EndpointWriter>();
+  endpoint_writers_.emplace(endpoint_id, writer);
+  return writer;
+}
+
+void EndpointManager::RemoveEndpointWriter(const std::string& endpoint_id) {
+  std::shared_ptr<EndpointWriter> writer;
+  {
+    MutexLock lock(&endpoint_writers_mutex_);
+    auto it = endpoint_writers_.find(endpoint_id);
+    if (it == endpoint_writers_.end()) {
+      return;
+    }
+    writer = std::move(it->second);
+    endpoint_writers_.erase(it);
+  }
+  // The writer may still be in use by a sender; if not, it's destroyed here,
+  // outside of the lock, once its pending writes are done.
+  writer.reset();
+}
+
 EndpointManager::EndpointState::~EndpointState() {
   // We must unregister the endpoint first to signal the runnables that they
   // should exit their loops. SingleThreadExecutor destructors will wait for
@@ -982,28 +1303,12 @@ EndpointManager::EndpointState::~EndpointState() {
         endpoint_id_, DisconnectionReason::SHUTDOWN,
         ConnectionsLog::EstablishedConnection::SAFE_DISCONNECTION);
   }
-
-  // Make sure the KeepAlive thread isn't blocking shutdown.
-  if (keep_alive_waiter_mutex_ && keep_alive_waiter_) {
-    MutexLock lock(keep_alive_waiter_mutex_.get());
-    keep_alive_waiter_->Notify();
-  }
 }
 
 void EndpointManager::EndpointState::StartEndpointReader(Runnable&& runnable) {
   reader_thread_.Execute("reader", std::move(runnable));
 }
 
-void EndpointManager::EndpointState::StartEndpointKeepAliveManager(
-    absl::AnyInvocable<void(Mutex*, ConditionVariable*)> runnable) {
-  keep_alive_thread_.Execute(
-      "keep-alive", [runnable = std::move(runnable),
-                     keep_alive_waiter_mutex = keep_alive_waiter_mutex_.get(),
-                     keep_alive_waiter = keep_alive_waiter_.get()]() mutable {
-        runnable(keep_alive_waiter_mutex, keep_alive_waiter);
-      });
-}
-
 void EndpointManager::RunOnEndpointManagerThread(const std::string& name,
                                                  Runnable runnable) {
   serial_executor_->Execute(name, std::move(runnable));
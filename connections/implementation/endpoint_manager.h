@@ -18,6 +18,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -31,6 +32,7 @@
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_channel.h"
 #include "connections/implementation/endpoint_channel_manager.h"
+#include "connections/implementation/keep_alive_scheduler.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/listeners.h"
 #include "internal/platform/byte_array.h"
@@ -125,8 +127,18 @@ class EndpointManager {
   // transport.
   int GetMaxTransmitPacketSize(const std::string& endpoint_id);
 
+  // Called once a frame was written to `endpoint_id`, or failed to be.
+  using WriteCallback =
+      std::function<void(const std::string& endpoint_id, bool succeeded)>;
+
   // Returns the list of endpoints to which sending this chunk failed.
   //
+  // If `on_write_done` is set, every endpoint is reported through it instead,
+  // and the returned list is empty. A chunk queued on an endpoint's
+  // EndpointWriter is then reported from the writer thread once it's actually
+  // written, which may be after this returns. The last chunk of a payload is
+  // always written, and reported, before this returns.
+  //
   // Invoked from the PayloadManager's sendPayload() method.
   std::vector<std::string> SendPayloadChunk(
       const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
@@ -134,7 +146,8 @@ class EndpointManager {
       const location::nearby::connections::PayloadTransferFrame::PayloadChunk&
           payload_chunk,
       const std::vector<std::string>& endpoint_ids,
-      analytics::PacketMetaData& packet_meta_data);
+      analytics::PacketMetaData& packet_meta_data,
+      const WriteCallback& on_write_done = nullptr);
   std::vector<std::string> SendControlMessage(
       const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
           payload_header,
@@ -150,7 +163,7 @@ class EndpointManager {
   //    a) We failed to read from the endpoint in its dedicated reader thread.
   //    b) We failed to write to the endpoint in PayloadManager.
   //    c) The connection was rejected in PCPHandler.
-  //    d) The dedicated KeepAlive thread exceeded its period of inactivity.
+  //    d) The KeepAlive check exceeded its period of inactivity.
   // Or in the numerous other cases where a failure occurred and we no longer
   // believe the endpoint is in a healthy state.
   //
@@ -167,15 +180,19 @@ class EndpointManager {
                   std::unique_ptr<SingleThreadExecutor> serial_executor);
 
  private:
+  // Number of threads running the KeepAlive checks of all endpoints.
+  static constexpr int kNumKeepAliveWorkers = 2;
+  // How long a KeepAlive check waits for a paused or busy channel before it
+  // skips the KEEP_ALIVE frame, so that a stuck endpoint only holds a worker
+  // for this long.
+  static constexpr absl::Duration kKeepAliveWriteTimeout =
+      absl::Milliseconds(100);
+
   class EndpointState {
    public:
     EndpointState(const std::string& endpoint_id,
                   EndpointChannelManager* channel_manager)
-        : endpoint_id_{endpoint_id},
-          channel_manager_{channel_manager},
-          keep_alive_waiter_mutex_{std::make_unique<Mutex>()},
-          keep_alive_waiter_{std::make_unique<ConditionVariable>(
-              keep_alive_waiter_mutex_.get())} {}
+        : endpoint_id_{endpoint_id}, channel_manager_{channel_manager} {}
 
     EndpointState(const EndpointState&) = delete;
     // The default move constructor would not reset |channel_manager_|, for
@@ -184,37 +201,27 @@ class EndpointManager {
     EndpointState(EndpointState&& other)
         : endpoint_id_{std::move(other.endpoint_id_)},
           channel_manager_{std::exchange(other.channel_manager_, nullptr)},
-          reader_thread_{std::move(other.reader_thread_)},
-          keep_alive_waiter_mutex_{
-              std::exchange(other.keep_alive_waiter_mutex_, nullptr)},
-          keep_alive_waiter_{std::exchange(other.keep_alive_waiter_, nullptr)},
-          keep_alive_thread_{std::move(other.keep_alive_thread_)} {}
+          reader_thread_{std::move(other.reader_thread_)} {}
     EndpointState& operator=(const EndpointState&) = delete;
     EndpointState&& operator=(EndpointState&&) = delete;
     ~EndpointState();
 
     void StartEndpointReader(Runnable&& runnable);
-    void StartEndpointKeepAliveManager(
-        absl::AnyInvocable<void(Mutex*, ConditionVariable*)> runnable);
 
    private:
     const std::string endpoint_id_;
     EndpointChannelManager* channel_manager_;
     SingleThreadExecutor reader_thread_;
-
-    // Use a condition variable so we can wait on the thread but still be able
-    // to wake it up before shutting down. We don't want to just sleep and risk
-    // blocking shutdown. Note: Create the mutex/condition variable on the heap
-    // so raw pointers sent to HandleKeepAlive() aren't invalidated during
-    // std::move operations.
-    mutable std::unique_ptr<Mutex> keep_alive_waiter_mutex_;
-    std::unique_ptr<ConditionVariable> keep_alive_waiter_;
-    SingleThreadExecutor keep_alive_thread_;
   };
 
   // RAII accessor for FrameProcessor
   class LockedFrameProcessor;
 
+  // Bounded queue of frames written to a single endpoint on a dedicated
+  // thread. Used when the same frame is sent to several endpoints, so that a
+  // slow endpoint does not hold back the writes to the others.
+  class EndpointWriter;
+
   // Provides a mutex per FrameProcessor to prevent unregistering (and
   // destroying) a FrameProcessor when it's in use.
   class FrameProcessorWithMutex {
@@ -235,11 +242,22 @@ class EndpointManager {
                                ClientProxy* client_proxy,
                                EndpointChannel* endpoint_channel);
 
-  ExceptionOr<bool> HandleKeepAlive(EndpointChannel* endpoint_channel,
-                                    absl::Duration keep_alive_interval,
-                                    absl::Duration keep_alive_timeout,
-                                    Mutex* keep_alive_waiter_mutex,
-                                    ConditionVariable* keep_alive_waiter);
+  // Sends a KEEP_ALIVE frame if nothing was written to the channel for
+  // |keep_alive_interval|. Returns the delay until the next check, or
+  // std::nullopt if nothing was read from the channel for
+  // |keep_alive_timeout|.
+  ExceptionOr<std::optional<absl::Duration>> HandleKeepAlive(
+      EndpointChannel* endpoint_channel, absl::Duration keep_alive_interval,
+      absl::Duration keep_alive_timeout);
+
+  // Runs HandleKeepAlive() on the current channel of the endpoint, from
+  // |keep_alive_scheduler_|. Discards the endpoint when it timed out, or when
+  // the write failed and the channel was not replaced since. Returns the delay
+  // until the next check, or std::nullopt once the endpoint is discarded.
+  std::optional<absl::Duration> CheckKeepAlive(
+      ClientProxy* client, const std::string& endpoint_id,
+      absl::Duration keep_alive_interval, absl::Duration keep_alive_timeout,
+      location::nearby::proto::connections::Medium& last_failed_medium);
 
   // Waits for a given endpoint EndpointChannelLoopRunnable() workers to
   // terminate.
@@ -260,7 +278,7 @@ class EndpointManager {
 
   // It should be noted that this method may be called multiple times (because
   // invoking this method closes the endpoint channel, which causes the
-  // dedicated reader and KeepAlive threads to terminate, which in turn leads to
+  // dedicated reader thread and KeepAlive checks to terminate, which in turn leads to
   // this method being called), but that's alright because the implementation of
   // this method is idempotent.
   // @EndpointManagerThread
@@ -281,11 +299,40 @@ class EndpointManager {
       ClientProxy* client, const std::string& service_id,
       const std::string& endpoint_id, DisconnectionReason reason);
 
+  // Sends the frame to every endpoint in `endpoint_ids` and returns the ones
+  // for which the write failed, or reports each endpoint through
+  // `on_write_done` if it's set.
+  //
+  // When the frame goes to more than one endpoint, it is queued on each
+  // endpoint's EndpointWriter and written concurrently; this call then only
+  // blocks while one of the queues is full. An endpoint whose queue stays full
+  // for a few seconds is considered stuck, and fails instead. Queued writes are
+  // reported through `on_write_done` once they're done. Without it, a failed
+  // queued write makes the next call for the same payload fail. If
+  // `wait_for_completion` is true, all queued writes to `endpoint_ids` are
+  // drained before returning, so the result covers every frame sent so far.
   std::vector<std::string> SendTransferFrameBytes(
       const std::vector<std::string>& endpoint_ids,
-      const ByteArray& payload_transfer_frame_bytes, std::int64_t payload_id,
+      ByteArray payload_transfer_frame_bytes, std::int64_t payload_id,
       std::int64_t offset, const std::string& packet_type,
-      analytics::PacketMetaData& packet_meta_data);
+      analytics::PacketMetaData& packet_meta_data, bool wait_for_completion,
+      const WriteCallback& on_write_done = nullptr);
+
+  // Writes the frame to the endpoint's current channel. Returns false if the
+  // endpoint has no channel or the write failed.
+  bool WriteTransferFrameBytes(const std::string& endpoint_id,
+                               const ByteArray& payload_transfer_frame_bytes,
+                               std::int64_t payload_id, std::int64_t offset,
+                               const std::string& packet_type,
+                               analytics::PacketMetaData& packet_meta_data);
+
+  // Returns the EndpointWriter of the endpoint. If there's none yet, one is
+  // created if `create` is true, otherwise nullptr is returned.
+  std::shared_ptr<EndpointWriter> GetEndpointWriter(
+      const std::string& endpoint_id, bool create)
+      ABSL_LOCKS_EXCLUDED(endpoint_writers_mutex_);
+  void RemoveEndpointWriter(const std::string& endpoint_id)
+      ABSL_LOCKS_EXCLUDED(endpoint_writers_mutex_);
 
   // Executes all jobs sequentially, on a serial_executor_.
   void RunOnEndpointManagerThread(const std::string& name, Runnable runnable);
@@ -299,9 +346,20 @@ class EndpointManager {
                       FrameProcessorWithMutex>
       frame_processors_ ABSL_GUARDED_BY(frame_processors_lock_);
 
+  // Sends the KEEP_ALIVE frames of all registered endpoints. Must outlive
+  // |endpoints_|.
+  KeepAliveScheduler keep_alive_scheduler_{kNumKeepAliveWorkers};
+
   // We keep track of all registered channel endpoints here.
   absl::flat_hash_map<std::string, EndpointState> endpoints_;
 
+  // Writers of the endpoints that have been sent multi-endpoint frames. Once
+  // created, all frames to that endpoint go through its writer, to preserve
+  // the order of writes. Accessed from the payload threads.
+  Mutex endpoint_writers_mutex_;
+  absl::flat_hash_map<std::string, std::shared_ptr<EndpointWriter>>
+      endpoint_writers_ ABSL_GUARDED_BY(endpoint_writers_mutex_);
+
   // Indicates whether the destructor has been called yet. If `is_shutdown_`
   // is true, assume any `ClientProxy` pointers are invalid, and should not
   // be used.
@@ -16,6 +16,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -40,6 +41,7 @@
 #include "internal/platform/byte_array.h"
 #include "internal/platform/count_down_latch.h"
 #include "internal/platform/exception.h"
+#include "internal/platform/implementation/system_clock.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/single_thread_executor.h"
 #include "internal/test/fake_single_thread_executor.h"
@@ -69,6 +71,8 @@ class MockEndpointChannel : public EndpointChannel {
   MOCK_METHOD(Exception, Write,
               (const ByteArray& data, PacketMetaData& packet_meta_data),
               (override));
+  MOCK_METHOD(Exception, TryWrite,
+              (const ByteArray& data, absl::Duration timeout), (override));
   MOCK_METHOD(void, Close, (), (override));
   MOCK_METHOD(void, Close, (DisconnectionReason reason), (override));
   MOCK_METHOD(void, Close,
@@ -163,6 +167,30 @@ class TestEndpointManager : public EndpointManager {
 
 class EndpointManagerTest : public ::testing::Test {
  protected:
+  // Returns a channel that reads empty frames until it's closed, and calls
+  // `on_write`, if set, for every frame written to it.
+  static std::unique_ptr<MockEndpointChannel> MakeMockChannel(
+      std::function<Exception()> on_write = nullptr) {
+    auto channel = std::make_unique<MockEndpointChannel>();
+    ON_CALL(*channel, Read(_)).WillByDefault([channel = channel.get()]() {
+      absl::SleepFor(absl::Milliseconds(100));
+      if (channel->IsClosed()) return ExceptionOr<ByteArray>(Exception::kIo);
+      return ExceptionOr<ByteArray>(ByteArray{});
+    });
+    ON_CALL(*channel, Close(_))
+        .WillByDefault([channel = channel.get()](DisconnectionReason reason) {
+          channel->DoClose();
+        });
+    if (on_write) {
+      ON_CALL(*channel, Write(_, _))
+          .WillByDefault([on_write](const ByteArray&, PacketMetaData&) {
+            return on_write();
+          });
+    }
+    EXPECT_CALL(*channel, GetMedium()).WillRepeatedly(Return(Medium::BLE));
+    return channel;
+  }
+
   void RegisterEndpoint(std::unique_ptr<MockEndpointChannel> channel,
                         bool should_close = true) {
     CountDownLatch done(1);
@@ -357,6 +385,358 @@ TEST_F(EndpointManagerTest, SendControlMessageAndPayloadAckWorks) {
   NEARBY_LOGS(INFO) << "Will call destructors now";
 }
 
+TEST_F(EndpointManagerTest, SlowEndpointDoesNotBlockOtherEndpoints) {
+  const std::string kFastEndpointId = "fast_endpoint_id";
+  const std::string kSlowEndpointId = "slow_endpoint_id";
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_offset(0);
+  chunk.set_body(std::string(512, 'a'));
+  CountDownLatch fast_endpoint_written(1);
+  CountDownLatch slow_endpoint_unblocked(1);
+  EXPECT_CALL(mock_listener_.initiated_cb, Call).Times(2);
+  em_.RegisterEndpoint(client_.get(), kFastEndpointId, info_,
+                       connection_options_,
+                       MakeMockChannel([&fast_endpoint_written]() {
+                         fast_endpoint_written.CountDown();
+                         return Exception{Exception::kSuccess};
+                       }),
+                       listener_, connection_token_);
+  em_.RegisterEndpoint(client_.get(), kSlowEndpointId, info_,
+                       connection_options_,
+                       MakeMockChannel([&slow_endpoint_unblocked]() {
+                         slow_endpoint_unblocked.Await();
+                         return Exception{Exception::kSuccess};
+                       }),
+                       listener_, connection_token_);
+  PacketMetaData packet_meta_data;
+
+  // The chunk is queued for both endpoints, and the fast one is written while
+  // the slow one is still blocked.
+  auto failed_ids = em_.SendPayloadChunk(
+      header, chunk, std::vector{kFastEndpointId, kSlowEndpointId},
+      packet_meta_data);
+  EXPECT_EQ(failed_ids, std::vector<std::string>{});
+  EXPECT_TRUE(fast_endpoint_written.Await(absl::Milliseconds(1000)).result());
+
+  // Control messages wait for all the queued writes to complete.
+  slow_endpoint_unblocked.CountDown();
+  PayloadTransferFrame::ControlMessage control;
+  control.set_offset(512);
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  failed_ids = em_.SendControlMessage(
+      header, control, std::vector{kFastEndpointId, kSlowEndpointId});
+  EXPECT_EQ(failed_ids, std::vector<std::string>{});
+
+  em_.UnregisterEndpoint(client_.get(), kFastEndpointId);
+  em_.UnregisterEndpoint(client_.get(), kSlowEndpointId);
+}
+
+TEST_F(EndpointManagerTest, StuckEndpointDoesNotHoldBackOtherEndpoints) {
+  const std::string kFastEndpointId = "fast_endpoint_id";
+  const std::string kStuckEndpointId = "stuck_endpoint_id";
+  constexpr int kChunkCount = 50;
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(kChunkCount * 512);
+  // Shared with the channels, which may outlive the test body.
+  auto stuck_endpoint_unblocked = std::make_shared<CountDownLatch>(1);
+  EXPECT_CALL(mock_listener_.initiated_cb, Call).Times(2);
+  em_.RegisterEndpoint(client_.get(), kFastEndpointId, info_,
+                       connection_options_, MakeMockChannel([]() {
+                         return Exception{Exception::kSuccess};
+                       }),
+                       listener_, connection_token_);
+  em_.RegisterEndpoint(client_.get(), kStuckEndpointId, info_,
+                       connection_options_,
+                       MakeMockChannel([stuck_endpoint_unblocked]() {
+                         stuck_endpoint_unblocked->Await();
+                         return Exception{Exception::kSuccess};
+                       }),
+                       listener_, connection_token_);
+  CountDownLatch fast_endpoint_done(kChunkCount);
+  CountDownLatch stuck_endpoint_failed(1);
+  std::atomic<int> stuck_endpoint_failures = 0;
+
+  for (int i = 0; i < kChunkCount; ++i) {
+    PayloadTransferFrame::PayloadChunk chunk;
+    chunk.set_offset(i * 512);
+    chunk.set_body(std::string(512, 'a'));
+    PacketMetaData packet_meta_data;
+    em_.SendPayloadChunk(
+        header, chunk, std::vector{kFastEndpointId, kStuckEndpointId},
+        packet_meta_data, [&](const std::string& endpoint_id, bool succeeded) {
+          if (endpoint_id == kFastEndpointId) {
+            if (succeeded) fast_endpoint_done.CountDown();
+          } else if (!succeeded) {
+            stuck_endpoint_failures++;
+            stuck_endpoint_failed.CountDown();
+          }
+        });
+  }
+
+  // Once its queue is full, the stuck endpoint fails after a bounded wait, and
+  // every chunk is written to the fast endpoint while it's still blocked.
+  EXPECT_TRUE(fast_endpoint_done.Await(absl::Milliseconds(1000)).result());
+  EXPECT_TRUE(stuck_endpoint_failed.Await(absl::Milliseconds(0)).result());
+  EXPECT_GT(stuck_endpoint_failures, 0);
+
+  stuck_endpoint_unblocked->CountDown();
+  em_.UnregisterEndpoint(client_.get(), kFastEndpointId);
+  em_.UnregisterEndpoint(client_.get(), kStuckEndpointId);
+}
+
+TEST_F(EndpointManagerTest, FailedQueuedWriteIsReported) {
+  const std::string kEndpointId1 = "endpoint_id_1";
+  const std::string kEndpointId2 = "endpoint_id_2";
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_offset(0);
+  chunk.set_body(std::string(512, 'a'));
+  chunk.set_flags(PayloadTransferFrame::PayloadChunk::LAST_CHUNK);
+  EXPECT_CALL(mock_listener_.initiated_cb, Call).Times(2);
+  em_.RegisterEndpoint(client_.get(), kEndpointId1, info_, connection_options_,
+                       MakeMockChannel([]() {
+                         return Exception{Exception::kSuccess};
+                       }),
+                       listener_, connection_token_);
+  em_.RegisterEndpoint(client_.get(), kEndpointId2, info_, connection_options_,
+                       MakeMockChannel([]() {
+                         return Exception{Exception::kIo};
+                       }),
+                       listener_, connection_token_);
+  PacketMetaData packet_meta_data;
+
+  // The last chunk waits for the queued writes, so the failure is reported.
+  auto failed_ids = em_.SendPayloadChunk(
+      header, chunk, std::vector{kEndpointId1, kEndpointId2}, packet_meta_data);
+  EXPECT_EQ(failed_ids, std::vector<std::string>{kEndpointId2});
+
+  em_.UnregisterEndpoint(client_.get(), kEndpointId1);
+  em_.UnregisterEndpoint(client_.get(), kEndpointId2);
+}
+
+TEST_F(EndpointManagerTest, QueuedChunkIsReportedOnceWritten) {
+  const std::string kSlowEndpointId = "slow_endpoint_id";
+  const std::string kFailingEndpointId = "failing_endpoint_id";
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_offset(0);
+  chunk.set_body(std::string(512, 'a'));
+  CountDownLatch slow_endpoint_unblocked(1);
+  EXPECT_CALL(mock_listener_.initiated_cb, Call).Times(2);
+  em_.RegisterEndpoint(client_.get(), kSlowEndpointId, info_,
+                       connection_options_,
+                       MakeMockChannel([&slow_endpoint_unblocked]() {
+                         slow_endpoint_unblocked.Await();
+                         return Exception{Exception::kSuccess};
+                       }),
+                       listener_, connection_token_);
+  em_.RegisterEndpoint(client_.get(), kFailingEndpointId, info_,
+                       connection_options_, MakeMockChannel([]() {
+                         return Exception{Exception::kIo};
+                       }),
+                       listener_, connection_token_);
+  PacketMetaData packet_meta_data;
+  CountDownLatch slow_endpoint_reported(1);
+  CountDownLatch failing_endpoint_reported(1);
+  std::atomic<bool> slow_endpoint_succeeded = false;
+  std::atomic<bool> failing_endpoint_succeeded = true;
+
+  auto failed_ids = em_.SendPayloadChunk(
+      header, chunk, std::vector{kSlowEndpointId, kFailingEndpointId},
+      packet_meta_data,
+      [&](const std::string& endpoint_id, bool succeeded) {
+        if (endpoint_id == kSlowEndpointId) {
+          slow_endpoint_succeeded = succeeded;
+          slow_endpoint_reported.CountDown();
+        } else {
+          failing_endpoint_succeeded = succeeded;
+          failing_endpoint_reported.CountDown();
+        }
+      });
+  EXPECT_EQ(failed_ids, std::vector<std::string>{});
+
+  // The failure is reported as soon as the write fails, while the chunk is
+  // only reported as sent to the slow endpoint once it's written.
+  EXPECT_TRUE(
+      failing_endpoint_reported.Await(absl::Milliseconds(1000)).result());
+  EXPECT_FALSE(failing_endpoint_succeeded);
+  EXPECT_FALSE(slow_endpoint_reported.Await(absl::Milliseconds(100)).result());
+  slow_endpoint_unblocked.CountDown();
+  EXPECT_TRUE(slow_endpoint_reported.Await(absl::Milliseconds(1000)).result());
+  EXPECT_TRUE(slow_endpoint_succeeded);
+
+  em_.UnregisterEndpoint(client_.get(), kSlowEndpointId);
+  em_.UnregisterEndpoint(client_.get(), kFailingEndpointId);
+}
+
+TEST_F(EndpointManagerTest, StuckChannelsDoNotDelayKeepAlivesOfOthers) {
+  connection_options_.keep_alive_interval_millis = 50;
+  connection_options_.keep_alive_timeout_millis = 10000;
+  // Shared with the channels, which may outlive the test body.
+  auto healthy_keep_alives = std::make_shared<CountDownLatch>(3);
+
+  // As many stuck endpoints as keep-alive workers.
+  const std::vector<std::string> endpoint_ids = {
+      "stuck_endpoint_id_1", "stuck_endpoint_id_2", "healthy_endpoint_id"};
+  EXPECT_CALL(mock_listener_.initiated_cb, Call).Times(3);
+  for (const std::string& endpoint_id : endpoint_ids) {
+    auto channel = MakeMockChannel();
+    // Never timed out, and always due for a KEEP_ALIVE frame.
+    EXPECT_CALL(*channel, GetLastReadTimestamp()).WillRepeatedly([]() {
+      return SystemClock::ElapsedRealtime();
+    });
+    EXPECT_CALL(*channel, GetLastWriteTimestamp())
+        .WillRepeatedly(Return(absl::InfinitePast()));
+    if (endpoint_id != "healthy_endpoint_id") {
+      // Paused for a bandwidth upgrade that never ends, or blocked behind a
+      // write that never returns. Write() would block forever.
+      EXPECT_CALL(*channel, Write(_)).Times(0);
+      EXPECT_CALL(*channel, TryWrite)
+          .WillRepeatedly([](const ByteArray&, absl::Duration timeout) {
+            absl::SleepFor(timeout);
+            return Exception{Exception::kTimeout};
+          });
+    } else {
+      EXPECT_CALL(*channel, TryWrite)
+          .WillRepeatedly(
+              [healthy_keep_alives](const ByteArray&, absl::Duration) {
+                healthy_keep_alives->CountDown();
+                return Exception{Exception::kSuccess};
+              });
+    }
+    em_.RegisterEndpoint(client_.get(), endpoint_id, info_,
+                         connection_options_, std::move(channel), listener_,
+                         connection_token_);
+  }
+
+  EXPECT_TRUE(healthy_keep_alives->Await(absl::Milliseconds(2000)).result());
+
+  for (const std::string& endpoint_id : endpoint_ids) {
+    em_.UnregisterEndpoint(client_.get(), endpoint_id);
+  }
+}
+
+TEST_F(EndpointManagerTest, ChunkIsSlicedForEndpointsWithSmallerPackets) {
+  const std::string kLargePacketEndpointId = "large_packet_endpoint_id";
+  const std::string kSmallPacketEndpointId = "small_packet_endpoint_id";
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_offset(0);
+  chunk.set_body(std::string(250, 'a'));
+  std::atomic<int> large_packet_writes = 0;
+  std::atomic<int> small_packet_writes = 0;
+
+  auto large_packet_channel = MakeMockChannel([&large_packet_writes]() {
+    large_packet_writes++;
+    return Exception{Exception::kSuccess};
+  });
+  ON_CALL(*large_packet_channel, GetMaxTransmitPacketSize())
+      .WillByDefault(Return(1000));
+  auto small_packet_channel = MakeMockChannel([&small_packet_writes]() {
+    small_packet_writes++;
+    return Exception{Exception::kSuccess};
+  });
+  ON_CALL(*small_packet_channel, GetMaxTransmitPacketSize())
+      .WillByDefault(Return(100));
+  EXPECT_CALL(mock_listener_.initiated_cb, Call).Times(2);
+  em_.RegisterEndpoint(client_.get(), kLargePacketEndpointId, info_,
+                       connection_options_, std::move(large_packet_channel),
+                       listener_, connection_token_);
+  em_.RegisterEndpoint(client_.get(), kSmallPacketEndpointId, info_,
+                       connection_options_, std::move(small_packet_channel),
+                       listener_, connection_token_);
+  PacketMetaData packet_meta_data;
+
+  auto failed_ids = em_.SendPayloadChunk(
+      header, chunk,
+      std::vector{kLargePacketEndpointId, kSmallPacketEndpointId},
+      packet_meta_data);
+  EXPECT_EQ(failed_ids, std::vector<std::string>{});
+  // Wait for the queued writes to complete.
+  PayloadTransferFrame::ControlMessage control;
+  control.set_offset(250);
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  em_.SendControlMessage(
+      header, control,
+      std::vector{kLargePacketEndpointId, kSmallPacketEndpointId});
+
+  // One data frame and one control frame to the first endpoint; the chunk is
+  // split into 100, 100 and 50 bytes for the second one.
+  EXPECT_EQ(large_packet_writes, 2);
+  EXPECT_EQ(small_packet_writes, 4);
+
+  em_.UnregisterEndpoint(client_.get(), kLargePacketEndpointId);
+  em_.UnregisterEndpoint(client_.get(), kSmallPacketEndpointId);
+}
+
+TEST_F(EndpointManagerTest, WholeChunkIsSentBeforeSlices) {
+  const std::string kLargePacketEndpointId = "large_packet_endpoint_id";
+  const std::string kSmallPacketEndpointId = "small_packet_endpoint_id";
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_offset(0);
+  chunk.set_body(std::string(1000, 'a'));
+  CountDownLatch large_packet_written(1);
+  // Shared with the channel, which may outlive the test body.
+  auto small_packet_unblocked = std::make_shared<CountDownLatch>(1);
+
+  auto large_packet_channel = MakeMockChannel([&large_packet_written]() {
+    large_packet_written.CountDown();
+    return Exception{Exception::kSuccess};
+  });
+  ON_CALL(*large_packet_channel, GetMaxTransmitPacketSize())
+      .WillByDefault(Return(1000));
+  auto small_packet_channel = MakeMockChannel([small_packet_unblocked]() {
+    small_packet_unblocked->Await();
+    return Exception{Exception::kSuccess};
+  });
+  ON_CALL(*small_packet_channel, GetMaxTransmitPacketSize())
+      .WillByDefault(Return(100));
+  EXPECT_CALL(mock_listener_.initiated_cb, Call).Times(2);
+  em_.RegisterEndpoint(client_.get(), kLargePacketEndpointId, info_,
+                       connection_options_, std::move(large_packet_channel),
+                       listener_, connection_token_);
+  em_.RegisterEndpoint(client_.get(), kSmallPacketEndpointId, info_,
+                       connection_options_, std::move(small_packet_channel),
+                       listener_, connection_token_);
+  PacketMetaData packet_meta_data;
+  SingleThreadExecutor sender;
+
+  sender.Execute([&]() {
+    em_.SendPayloadChunk(
+        header, chunk,
+        std::vector{kLargePacketEndpointId, kSmallPacketEndpointId},
+        packet_meta_data);
+  });
+
+  // The 10 slices for the blocked endpoint don't fit its queue, but the whole
+  // chunk is queued for the other endpoint before them.
+  EXPECT_TRUE(large_packet_written.Await(absl::Milliseconds(1000)).result());
+
+  small_packet_unblocked->CountDown();
+  sender.Shutdown();
+  em_.UnregisterEndpoint(client_.get(), kLargePacketEndpointId);
+  em_.UnregisterEndpoint(client_.get(), kSmallPacketEndpointId);
+}
+
 TEST_F(EndpointManagerTest, SingleReadOnReadError) {
   auto endpoint_channel = std::make_unique<MockEndpointChannel>();
   EXPECT_CALL(*endpoint_channel, Read(_))
@@ -12,14 +12,76 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdlib>
+#include <optional>
+#include <string>
+
 #include "connections/implementation/offline_frames.h"
+#include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "internal/platform/byte_array.h"
 
+namespace {
+
+using ::location::nearby::connections::OfflineFrame;
+using ::location::nearby::connections::PayloadTransferFrame;
+using ::location::nearby::connections::V1Frame;
+using ::nearby::connections::parser::DataPayloadTransferView;
+
+bool IsDataFrame(const OfflineFrame& frame) {
+  return frame.version() == OfflineFrame::V1 &&
+         frame.v1().type() == V1Frame::PAYLOAD_TRANSFER &&
+         frame.v1().payload_transfer().packet_type() ==
+             PayloadTransferFrame::DATA &&
+         frame.v1().payload_transfer().has_payload_header() &&
+         frame.v1().payload_transfer().has_payload_chunk();
+}
+
+// The DATA frames are read and written by hand, check that they agree with
+// protobuf.
+void CheckDataFrameCodec(const nearby::ByteArray& bytes) {
+  OfflineFrame expected;
+  bool parsed = expected.ParseFromArray(bytes.data(), bytes.size());
+
+  std::optional<DataPayloadTransferView> view =
+      nearby::connections::parser::ParseDataPayloadTransfer(
+          bytes.AsStringView());
+  if (view.has_value()) {
+    if (!parsed || !IsDataFrame(expected)) abort();
+    PayloadTransferFrame::PayloadChunk chunk = view->chunk;
+    if (view->body.has_value()) chunk.set_body(std::string(*view->body));
+    const PayloadTransferFrame& transfer = expected.v1().payload_transfer();
+    if (view->header.SerializeAsString() !=
+            transfer.payload_header().SerializeAsString() ||
+        chunk.SerializeAsString() !=
+            transfer.payload_chunk().SerializeAsString()) {
+      abort();
+    }
+  }
+
+  if (parsed && IsDataFrame(expected)) {
+    const PayloadTransferFrame& transfer = expected.v1().payload_transfer();
+    OfflineFrame frame;
+    frame.set_version(OfflineFrame::V1);
+    frame.mutable_v1()->set_type(V1Frame::PAYLOAD_TRANSFER);
+    auto* sub_frame = frame.mutable_v1()->mutable_payload_transfer();
+    sub_frame->set_packet_type(PayloadTransferFrame::DATA);
+    *sub_frame->mutable_payload_header() = transfer.payload_header();
+    *sub_frame->mutable_payload_chunk() = transfer.payload_chunk();
+    nearby::ByteArray written =
+        nearby::connections::parser::ForDataPayloadTransfer(
+            transfer.payload_header(), transfer.payload_chunk());
+    if (std::string(written) != frame.SerializeAsString()) abort();
+  }
+}
+
+}  // namespace
+
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   nearby::ByteArray byte_array;
   byte_array.SetData(reinterpret_cast<const char*>(data), size);
 
   nearby::connections::parser::FromBytes(byte_array);
+  CheckDataFrameCodec(byte_array);
 
   return 0;
 }
@@ -17,21 +17,27 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/str_cat.h"
 #include "connections/implementation/internal_payload.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/payload.h"
 #include "connections/payload_type.h"
 #include "internal/platform/byte_array.h"
+#include "internal/platform/condition_variable.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/expected.h"
 #include "internal/platform/file.h"
 #include "internal/platform/implementation/platform.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/mutex_lock.h"
 #include "internal/platform/os_name.h"
 #include "internal/platform/output_stream.h"
 #include "internal/platform/pipe.h"
@@ -197,6 +203,9 @@ class OutgoingFileInternalPayload : public InternalPayload {
       : InternalPayload(std::move(payload)),
         total_size_{payload_.AsFile()->GetTotalSize()} {}
 
+  // The file must outlive a running read-ahead.
+  ~OutgoingFileInternalPayload() override { TakeReadAhead(); }
+
   location::nearby::connections::PayloadTransferFrame::PayloadHeader::
       PayloadType
       GetType() const override {
@@ -210,7 +219,10 @@ class OutgoingFileInternalPayload : public InternalPayload {
     InputFile* file = payload_.AsFile();
     if (!file) return {};
 
-    ExceptionOr<ByteArray> bytes_read = file->Read(chunk_size);
+    std::optional<ExceptionOr<ByteArray>> read_ahead = TakeReadAhead();
+    ExceptionOr<ByteArray> bytes_read =
+        read_ahead.has_value() ? std::move(*read_ahead)
+                               : file->Read(chunk_size);
     if (!bytes_read.ok()) {
       return {};
     }
@@ -224,6 +236,17 @@ class OutgoingFileInternalPayload : public InternalPayload {
       return {};
     }
 
+    if (chunk_size > 0 && bytes.size() > static_cast<size_t>(chunk_size)) {
+      // The chunk size went down since the read-ahead started. Keep the rest
+      // for the next chunk.
+      MutexLock lock(&read_ahead_->mutex);
+      read_ahead_->result.emplace(
+          ByteArray(bytes.data() + chunk_size, bytes.size() - chunk_size));
+      return ByteArray(bytes.data(), chunk_size);
+    }
+
+    // Read the next chunk while this one is being sent.
+    StartReadAhead(chunk_size);
     return bytes;
   }
 
@@ -237,6 +260,13 @@ class OutgoingFileInternalPayload : public InternalPayload {
     if (!file) {
       return {Exception::kIo};
     }
+    // Skipping is only supported before the first chunk is detached, when
+    // nothing has been read ahead yet.
+    if (TakeReadAhead().has_value()) {
+      LOG(WARNING) << "Cannot skip offset after reading file payload " << this;
+      file->Close();
+      return {Exception::kIo};
+    }
 
     ExceptionOr<size_t> real_offset = file->Skip(offset);
     if (real_offset.ok() && real_offset.GetResult() == offset) {
@@ -255,11 +285,82 @@ class OutgoingFileInternalPayload : public InternalPayload {
 
   void Close() override {
     InputFile* file = payload_.AsFile();
-    if (file) file->Close();
+    if (!file) return;
+    // Don't close the file under a running read-ahead.
+    TakeReadAhead();
+    file->Close();
   }
 
  private:
+  // Shared by every ReadAhead so that each has a reference to it.
+  struct ReadAheadState {
+    Mutex mutex;
+    ConditionVariable done{&mutex};
+    // Set while a read-ahead is queued or running.
+    bool pending ABSL_GUARDED_BY(mutex) = false;
+    // Set once a worker has picked up the queued read-ahead.
+    bool started ABSL_GUARDED_BY(mutex) = false;
+    // Tells a dropped read-ahead apart from the one queued after it.
+    std::int64_t generation ABSL_GUARDED_BY(mutex) = 0;
+    std::optional<ExceptionOr<ByteArray>> result ABSL_GUARDED_BY(mutex);
+  };
+
+  // Read-aheads of all outgoing files share a few threads, rather than one
+  // thread per file.
+  static MultiThreadExecutor& GetReadAheadExecutor() {
+    static MultiThreadExecutor* executor =
+        new MultiThreadExecutor(kNumReadAheadThreads);
+    return *executor;
+  }
+
+  void StartReadAhead(int chunk_size) {
+    std::int64_t generation;
+    {
+      MutexLock lock(&read_ahead_->mutex);
+      read_ahead_->pending = true;
+      read_ahead_->started = false;
+      generation = ++read_ahead_->generation;
+    }
+    GetReadAheadExecutor().Execute(
+        "read-ahead", [state = read_ahead_, file = payload_.AsFile(),
+                       chunk_size, generation]() {
+          {
+            MutexLock lock(&state->mutex);
+            // Dropped before a worker got to it.
+            if (!state->pending || state->generation != generation) return;
+            state->started = true;
+          }
+          ExceptionOr<ByteArray> bytes_read = file->Read(chunk_size);
+          MutexLock lock(&state->mutex);
+          state->result.emplace(std::move(bytes_read));
+          state->pending = false;
+          state->done.Notify();
+        });
+  }
+
+  // Waits for a running read-ahead, if any, and returns its result. A
+  // read-ahead that is still queued behind other files is dropped, so the
+  // caller reads the chunk itself instead of waiting for a free thread.
+  // Returns nullopt if nothing was read ahead.
+  std::optional<ExceptionOr<ByteArray>> TakeReadAhead() {
+    MutexLock lock(&read_ahead_->mutex);
+    if (read_ahead_->pending && !read_ahead_->started) {
+      read_ahead_->pending = false;
+    }
+    while (read_ahead_->pending) {
+      read_ahead_->done.Wait();
+    }
+    std::optional<ExceptionOr<ByteArray>> read_ahead =
+        std::move(read_ahead_->result);
+    read_ahead_->result.reset();
+    return read_ahead;
+  }
+
+  static constexpr int kNumReadAheadThreads = 2;
+
   std::int64_t total_size_;
+  std::shared_ptr<ReadAheadState> read_ahead_ =
+      std::make_shared<ReadAheadState>();
 };
 
 class IncomingFileInternalPayload : public InternalPayload {
@@ -283,9 +384,9 @@ class IncomingFileInternalPayload : public InternalPayload {
 
   Exception AttachNextChunk(const ByteArray& chunk) override {
     if (chunk.Empty()) {
-      // Received null last chunk for incoming payload.
-      output_file_.Close();
-      return {Exception::kSuccess};
+      // Received null last chunk for incoming payload. Closing writes out what
+      // the file still buffers, so its errors are the payload's errors.
+      return output_file_.Close();
     }
 
     return output_file_.Write(chunk);
@@ -367,7 +468,9 @@ ErrorOr<std::unique_ptr<InternalPayload>> CreateIncomingInternalPayload(
     }
 
     case PayloadTransferFrame::PayloadHeader::STREAM: {
-      auto [input, output] = CreatePipe();
+      // The chunks are written from the reader thread of the endpoint, which
+      // must not block until the client reads the stream.
+      auto [input, output] = CreatePipe(kUnboundedPipeCapacity);
 
       return {std::make_unique<IncomingStreamInternalPayload>(
           Payload(payload_id, std::move(input)), std::move(output))};
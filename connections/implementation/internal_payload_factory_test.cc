@@ -19,8 +19,10 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "connections/implementation/internal_payload.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/payload.h"
@@ -29,6 +31,7 @@
 #include "internal/platform/exception.h"
 #include "internal/platform/expected.h"
 #include "internal/platform/file.h"
+#include "internal/platform/input_stream.h"
 #include "internal/platform/pipe.h"
 
 namespace nearby {
@@ -130,6 +133,44 @@ TEST(InternalPayloadFactoryTest, CanCreateInternalPayloadFromStreamMessage) {
   internal_payload->Close();
 }
 
+TEST(InternalPayloadFactoryTest,
+     AttachNextChunk_StreamLargerThanPipeCapacity_DoesNotBlock) {
+  constexpr size_t kChunkSize = 64 * 1024;
+  constexpr size_t kNumChunks = 2 * kDefaultPipeCapacity / kChunkSize;
+  PayloadTransferFrame frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  auto& header = *frame.mutable_payload_header();
+  header.set_type(PayloadTransferFrame::PayloadHeader::STREAM);
+  header.set_id(12345);
+  header.set_total_size(0);
+  ErrorOr<std::unique_ptr<InternalPayload>> result =
+      CreateIncomingInternalPayload(frame, "");
+  ASSERT_FALSE(result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload = std::move(result.value());
+  Payload payload = internal_payload->ReleasePayload();
+
+  // Nothing reads the stream until the whole payload has arrived, as when the
+  // client is slow; the reader thread of the endpoint must not block meanwhile.
+  for (size_t i = 0; i < kNumChunks; ++i) {
+    ByteArray chunk(std::string(kChunkSize, static_cast<char>('a' + i % 26)));
+    EXPECT_TRUE(internal_payload->AttachNextChunk(chunk).Ok());
+  }
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray()).Ok());
+
+  InputStream* stream = payload.AsStream();
+  ASSERT_NE(stream, nullptr);
+  for (size_t i = 0; i < kNumChunks; ++i) {
+    ExceptionOr<ByteArray> chunk = stream->ReadExactly(kChunkSize);
+    ASSERT_TRUE(chunk.ok());
+    EXPECT_EQ(chunk.result(),
+              ByteArray(std::string(kChunkSize,
+                                    static_cast<char>('a' + i % 26))));
+  }
+  ExceptionOr<ByteArray> end = stream->Read(kChunkSize);
+  ASSERT_TRUE(end.ok());
+  EXPECT_TRUE(end.result().Empty());
+}
+
 TEST(InternalPayloadFactoryTest, CanCreateInternalPayloadFromFileMessage) {
   PayloadTransferFrame frame;
   std::string path = "/tmp/Downloads";
@@ -249,6 +290,72 @@ TEST(InternalPayloadFactoryTest,
   EXPECT_EQ(contents_after_skip, ByteArray("456789"));
 }
 
+TEST(InternalPayloadFactoryTest, DetachNextChunk_FilePayload_ReadsInOrder) {
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  CreateFileWithContents(payload_id, contents);
+  InputFile inputFile(payload_id, contents.size());
+  ErrorOr<std::unique_ptr<InternalPayload>> internal_payload_result =
+      CreateOutgoingInternalPayload(Payload{payload_id, std::move(inputFile)});
+  ASSERT_FALSE(internal_payload_result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload =
+      std::move(internal_payload_result.value());
+
+  EXPECT_EQ(internal_payload->DetachNextChunk(4), ByteArray("0123"));
+  EXPECT_EQ(internal_payload->DetachNextChunk(4), ByteArray("4567"));
+  EXPECT_EQ(internal_payload->DetachNextChunk(4), ByteArray("89"));
+  EXPECT_TRUE(internal_payload->DetachNextChunk(4).Empty());
+}
+
+TEST(InternalPayloadFactoryTest,
+     DetachNextChunk_FilePayloadSmallerChunkSize_SplitsChunk) {
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  CreateFileWithContents(payload_id, contents);
+  InputFile inputFile(payload_id, contents.size());
+  ErrorOr<std::unique_ptr<InternalPayload>> internal_payload_result =
+      CreateOutgoingInternalPayload(Payload{payload_id, std::move(inputFile)});
+  ASSERT_FALSE(internal_payload_result.has_error());
+  std::unique_ptr<InternalPayload> internal_payload =
+      std::move(internal_payload_result.value());
+
+  EXPECT_EQ(internal_payload->DetachNextChunk(5), ByteArray("01234"));
+  EXPECT_EQ(internal_payload->DetachNextChunk(2), ByteArray("56"));
+  EXPECT_EQ(internal_payload->DetachNextChunk(2), ByteArray("78"));
+  EXPECT_EQ(internal_payload->DetachNextChunk(2), ByteArray("9"));
+  EXPECT_TRUE(internal_payload->DetachNextChunk(2).Empty());
+}
+
+TEST(InternalPayloadFactoryTest,
+     DetachNextChunk_ManyFilePayloads_ReadInOrder) {
+  // More files than read-ahead threads, sent interleaved.
+  constexpr int kNumFiles = 8;
+  std::vector<std::unique_ptr<InternalPayload>> internal_payloads;
+  for (int i = 0; i < kNumFiles; ++i) {
+    ByteArray contents(absl::StrCat(i, "123456789"));
+    Payload::Id payload_id = Payload::GenerateId();
+    CreateFileWithContents(payload_id, contents);
+    InputFile inputFile(payload_id, contents.size());
+    ErrorOr<std::unique_ptr<InternalPayload>> internal_payload_result =
+        CreateOutgoingInternalPayload(
+            Payload{payload_id, std::move(inputFile)});
+    ASSERT_FALSE(internal_payload_result.has_error());
+    internal_payloads.push_back(std::move(internal_payload_result.value()));
+  }
+
+  for (int i = 0; i < kNumFiles; ++i) {
+    EXPECT_EQ(internal_payloads[i]->DetachNextChunk(4),
+              ByteArray(absl::StrCat(i, "123")));
+  }
+  for (int i = 0; i < kNumFiles; ++i) {
+    EXPECT_EQ(internal_payloads[i]->DetachNextChunk(4), ByteArray("4567"));
+  }
+  for (int i = 0; i < kNumFiles; ++i) {
+    EXPECT_EQ(internal_payloads[i]->DetachNextChunk(4), ByteArray("89"));
+    EXPECT_TRUE(internal_payloads[i]->DetachNextChunk(4).Empty());
+  }
+}
+
 TEST(InternalPayloadFactoryTest,
      SkipToOffset_StreamPayloadValidOffset_SkipsOffset) {
   ByteArray contents("0123456789");
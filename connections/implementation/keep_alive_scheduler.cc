@@ -0,0 +1,148 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/keep_alive_scheduler.h"
+
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/time/time.h"
+#include "internal/platform/implementation/system_clock.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace nearby {
+namespace connections {
+
+KeepAliveScheduler::KeepAliveScheduler(int num_workers)
+    : workers_(num_workers) {
+  timer_thread_.Execute("keep-alive-timer", [this]() { RunTimerLoop(); });
+}
+
+KeepAliveScheduler::~KeepAliveScheduler() { Shutdown(); }
+
+void KeepAliveScheduler::Add(const std::string& endpoint_id,
+                             absl::Duration delay, Check check) {
+  MutexLock lock(&mutex_);
+  if (is_shutdown_) {
+    LOG(WARNING) << "KeepAliveScheduler is shut down, not checking endpoint "
+                 << endpoint_id;
+    return;
+  }
+  RemoveLocked(endpoint_id);
+  Entry& entry = entries_[endpoint_id];
+  entry.check = std::move(check);
+  ScheduleLocked(endpoint_id, entry, SystemClock::ElapsedRealtime() + delay);
+}
+
+void KeepAliveScheduler::Remove(const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+  RemoveLocked(endpoint_id);
+}
+
+void KeepAliveScheduler::Shutdown() {
+  {
+    MutexLock lock(&mutex_);
+    if (is_shutdown_) return;
+    is_shutdown_ = true;
+    cond_.Notify();
+  }
+  timer_thread_.Shutdown();
+  workers_.Shutdown();
+  MutexLock lock(&mutex_);
+  // The checks dropped by the workers will never return, so unblock the
+  // pending Remove() calls too.
+  entries_.clear();
+  deadlines_.clear();
+  cond_.Notify();
+}
+
+int KeepAliveScheduler::GetEndpointCount() const {
+  MutexLock lock(&mutex_);
+  return entries_.size();
+}
+
+void KeepAliveScheduler::RemoveLocked(const std::string& endpoint_id) {
+  auto it = entries_.find(endpoint_id);
+  while (it != entries_.end() && it->second.running) {
+    cond_.Wait();
+    it = entries_.find(endpoint_id);
+  }
+  if (it == entries_.end()) return;
+  deadlines_.erase({it->second.deadline, endpoint_id});
+  entries_.erase(it);
+}
+
+void KeepAliveScheduler::ScheduleLocked(const std::string& endpoint_id,
+                                        Entry& entry, absl::Time deadline) {
+  entry.deadline = deadline;
+  bool is_earliest = deadlines_.empty() || deadline < deadlines_.begin()->first;
+  deadlines_.insert({deadline, endpoint_id});
+  if (is_earliest) {
+    // Wake up the timer thread to wait for the new deadline instead.
+    cond_.Notify();
+  }
+}
+
+void KeepAliveScheduler::RunTimerLoop() {
+  MutexLock lock(&mutex_);
+  while (!is_shutdown_) {
+    absl::Time now = SystemClock::ElapsedRealtime();
+    while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+      std::string endpoint_id = deadlines_.begin()->second;
+      deadlines_.erase(deadlines_.begin());
+      entries_[endpoint_id].running = true;
+      workers_.Execute("keep-alive-check", [this, endpoint_id]() {
+        RunCheck(endpoint_id);
+      });
+    }
+    if (deadlines_.empty()) {
+      cond_.Wait();
+    } else {
+      cond_.Wait(deadlines_.begin()->first - now);
+    }
+  }
+}
+
+void KeepAliveScheduler::RunCheck(const std::string& endpoint_id) {
+  Check check;
+  {
+    MutexLock lock(&mutex_);
+    // Shutdown() forgets the entries of the checks that don't run.
+    if (is_shutdown_) return;
+    check = std::move(entries_[endpoint_id].check);
+  }
+
+  std::optional<absl::Duration> delay = check();
+
+  MutexLock lock(&mutex_);
+  auto it = entries_.find(endpoint_id);
+  if (it == entries_.end()) return;
+  Entry& entry = it->second;
+  entry.running = false;
+  if (!delay.has_value() || is_shutdown_) {
+    NEARBY_VLOG(1) << "Stopped keep-alive checks of endpoint " << endpoint_id;
+    entries_.erase(it);
+  } else {
+    entry.check = std::move(check);
+    ScheduleLocked(endpoint_id, entry,
+                   SystemClock::ElapsedRealtime() + *delay);
+  }
+  // Unblock Remove() calls waiting for this check.
+  cond_.Notify();
+}
+
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,105 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_KEEP_ALIVE_SCHEDULER_H_
+#define CORE_INTERNAL_KEEP_ALIVE_SCHEDULER_H_
+
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/time/time.h"
+#include "internal/platform/condition_variable.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/single_thread_executor.h"
+
+namespace nearby {
+namespace connections {
+
+// Runs the keep-alive checks of all connected endpoints on a fixed number of
+// threads.
+//
+// Each endpoint registers a check function, which sends a KEEP_ALIVE frame if
+// the endpoint has been idle for too long, and returns how long to wait until
+// it should be called again. Since the check derives its deadlines from the
+// last read/write times of the channel, no frame is sent while data flows.
+//
+// A single timer thread waits for the earliest deadline, and hands the due
+// checks to a small pool of workers, so that a check blocked on a slow write
+// does not delay the other endpoints.
+class KeepAliveScheduler {
+ public:
+  // Returns the delay until the next check, or std::nullopt to stop checking
+  // the endpoint.
+  using Check = absl::AnyInvocable<std::optional<absl::Duration>()>;
+
+  explicit KeepAliveScheduler(int num_workers);
+  ~KeepAliveScheduler();
+  KeepAliveScheduler(const KeepAliveScheduler&) = delete;
+  KeepAliveScheduler& operator=(const KeepAliveScheduler&) = delete;
+
+  // Calls `check` for `endpoint_id` after `delay`, and then as long as it
+  // asks for it. Replaces the previous check of the endpoint, if any.
+  void Add(const std::string& endpoint_id, absl::Duration delay, Check check)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stops checking `endpoint_id`. If its check is running, waits for it to
+  // return. Must not be called from a check.
+  void Remove(const std::string& endpoint_id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stops the timer thread and waits for the running checks to return. The
+  // other checks are dropped.
+  void Shutdown() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of endpoints being checked.
+  int GetEndpointCount() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Entry {
+    Check check;
+    absl::Time deadline = absl::InfiniteFuture();
+    // True while `check` is running on a worker. It is taken out of the entry
+    // while it runs.
+    bool running = false;
+  };
+
+  // Waits until no check of `endpoint_id` is running, and forgets it.
+  void RemoveLocked(const std::string& endpoint_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void ScheduleLocked(const std::string& endpoint_id, Entry& entry,
+                      absl::Time deadline) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RunTimerLoop() ABSL_LOCKS_EXCLUDED(mutex_);
+  void RunCheck(const std::string& endpoint_id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  mutable Mutex mutex_;
+  // Notified when the deadlines change, and when a check returns.
+  ConditionVariable cond_{&mutex_};
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // Deadlines of the entries whose check is not running, earliest first.
+  std::set<std::pair<absl::Time, std::string>> deadlines_
+      ABSL_GUARDED_BY(mutex_);
+  bool is_shutdown_ ABSL_GUARDED_BY(mutex_) = false;
+  MultiThreadExecutor workers_;
+  SingleThreadExecutor timer_thread_;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_KEEP_ALIVE_SCHEDULER_H_
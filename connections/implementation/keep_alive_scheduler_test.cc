@@ -0,0 +1,157 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/keep_alive_scheduler.h"
+
+#include <atomic>
+#include <optional>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/count_down_latch.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr absl::Duration kTimeout = absl::Seconds(5);
+constexpr absl::Duration kShortDelay = absl::Milliseconds(10);
+
+TEST(KeepAliveSchedulerTest, RunsCheckUntilItStops) {
+  KeepAliveScheduler scheduler(1);
+  CountDownLatch done(1);
+  std::atomic<int> calls = 0;
+
+  scheduler.Add("endpoint", absl::ZeroDuration(),
+                [&]() -> std::optional<absl::Duration> {
+                  if (++calls < 3) return kShortDelay;
+                  done.CountDown();
+                  return std::nullopt;
+                });
+
+  ASSERT_TRUE(done.Await(kTimeout).result());
+  // Give the worker some time to forget about the endpoint.
+  absl::SleepFor(kShortDelay);
+  EXPECT_EQ(calls, 3);
+  EXPECT_EQ(scheduler.GetEndpointCount(), 0);
+}
+
+TEST(KeepAliveSchedulerTest, WaitsForDelay) {
+  KeepAliveScheduler scheduler(1);
+  CountDownLatch done(1);
+  absl::Time start = absl::Now();
+  absl::Time called_at;
+
+  scheduler.Add("endpoint", absl::Milliseconds(100),
+                [&]() -> std::optional<absl::Duration> {
+                  called_at = absl::Now();
+                  done.CountDown();
+                  return std::nullopt;
+                });
+
+  ASSERT_TRUE(done.Await(kTimeout).result());
+  EXPECT_GE(called_at - start, absl::Milliseconds(100));
+}
+
+TEST(KeepAliveSchedulerTest, RemoveStopsChecks) {
+  KeepAliveScheduler scheduler(1);
+  CountDownLatch first_call(1);
+  std::atomic<int> calls = 0;
+
+  scheduler.Add("endpoint", absl::ZeroDuration(),
+                [&]() -> std::optional<absl::Duration> {
+                  if (calls++ == 0) first_call.CountDown();
+                  return kShortDelay;
+                });
+  ASSERT_TRUE(first_call.Await(kTimeout).result());
+  scheduler.Remove("endpoint");
+  int calls_after_remove = calls;
+  absl::SleepFor(kShortDelay * 5);
+
+  EXPECT_EQ(calls, calls_after_remove);
+  EXPECT_EQ(scheduler.GetEndpointCount(), 0);
+}
+
+TEST(KeepAliveSchedulerTest, RemoveWaitsForRunningCheck) {
+  KeepAliveScheduler scheduler(1);
+  CountDownLatch started(1);
+  std::atomic<bool> returned = false;
+
+  scheduler.Add("endpoint", absl::ZeroDuration(),
+                [&]() -> std::optional<absl::Duration> {
+                  started.CountDown();
+                  absl::SleepFor(absl::Milliseconds(50));
+                  returned = true;
+                  return kShortDelay;
+                });
+  ASSERT_TRUE(started.Await(kTimeout).result());
+  scheduler.Remove("endpoint");
+
+  EXPECT_TRUE(returned);
+}
+
+TEST(KeepAliveSchedulerTest, AddReplacesPreviousCheck) {
+  KeepAliveScheduler scheduler(1);
+  CountDownLatch done(1);
+  std::atomic<bool> old_check_called = false;
+
+  scheduler.Add("endpoint", absl::Seconds(1),
+                [&]() -> std::optional<absl::Duration> {
+                  old_check_called = true;
+                  return std::nullopt;
+                });
+  scheduler.Add("endpoint", absl::ZeroDuration(),
+                [&]() -> std::optional<absl::Duration> {
+                  done.CountDown();
+                  return std::nullopt;
+                });
+
+  ASSERT_TRUE(done.Await(kTimeout).result());
+  EXPECT_FALSE(old_check_called);
+}
+
+TEST(KeepAliveSchedulerTest, ChecksManyEndpointsWithFewThreads) {
+  constexpr int kNumEndpoints = 200;
+  KeepAliveScheduler scheduler(2);
+  CountDownLatch done(kNumEndpoints);
+
+  for (int i = 0; i < kNumEndpoints; ++i) {
+    scheduler.Add(absl::StrCat("endpoint-", i), absl::Milliseconds(i % 20),
+                  [&done, calls = 0]() mutable
+                  -> std::optional<absl::Duration> {
+                    if (++calls < 3) return kShortDelay;
+                    done.CountDown();
+                    return std::nullopt;
+                  });
+  }
+
+  EXPECT_TRUE(done.Await(kTimeout).result());
+}
+
+TEST(KeepAliveSchedulerTest, AddAfterShutdownIsIgnored) {
+  KeepAliveScheduler scheduler(1);
+  scheduler.Shutdown();
+
+  scheduler.Add("endpoint", absl::ZeroDuration(),
+                []() -> std::optional<absl::Duration> { return kShortDelay; });
+
+  EXPECT_EQ(scheduler.GetEndpointCount(), 0);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
@@ -14,8 +14,14 @@
 
 #include "connections/implementation/mediums/ble_v2/bloom_filter.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
 #include "absl/numeric/int128.h"
-#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "internal/platform/byte_array.h"
 #include "internal/platform/logging.h"
 #include "src/MurmurHash3.h"
 
@@ -24,14 +30,48 @@ namespace connections {
 namespace mediums {
 
 namespace {
-constexpr int kHasherNumberOfRepetitions = 5;
+constexpr std::uint32_t kHasherNumberOfRepetitions = 5;
+
+bool TestBit(absl::string_view bytes, size_t pos) {
+  return (static_cast<std::uint8_t>(bytes[pos >> 3]) >> (pos & 7)) & 1;
+}
+}  // namespace
+
+void BitSet::SetFromBytes(absl::string_view bytes) {
+  for (size_t pos = 0; pos < Size(); ++pos) {
+    Set(pos, TestBit(bytes, pos));
+  }
+}
+
+void BitSet::WriteToBytes(absl::Span<char> bytes) const {
+  std::memset(bytes.data(), 0, bytes.size());
+  for (size_t pos = 0; pos < Size(); ++pos) {
+    if (Test(pos)) bytes[pos >> 3] |= 1 << (pos & 7);
+  }
+}
+
+BloomFilter::Key::Key(absl::string_view s) {
+  absl::uint128 hash128;
+  MurmurHash3_x64_128(s.data(), s.size(), 0, &hash128);
+  std::uint64_t hash64 =
+      absl::Uint128Low64(hash128);  // the lower 64 bits of the 128-bit hash
+  hash1_ = static_cast<std::uint32_t>(
+      hash64);  // the lower 32 bits of the 64-bit hash
+  hash2_ = static_cast<std::uint32_t>(
+      hash64 >> 32);  // the upper 32 bits of the 64-bit hash
+}
+
+std::uint32_t BloomFilter::Key::GetProbe(std::uint32_t i) const {
+  // Same as Guava's int arithmetic, which wraps around.
+  std::uint32_t combined_hash = hash1_ + i * hash2_;
+  // Flip all the bits if it's negative (guaranteed positive number)
+  if (combined_hash & 0x80000000) combined_hash = ~combined_hash;
+  return combined_hash;
 }
 
 BloomFilter::BloomFilter(std::unique_ptr<BitSet> bit_set,
                          const ByteArray& bytes)
     : bit_set_(std::move(bit_set)) {
-  const char* bytes_read_ptr = bytes.data();
-
   if (bytes.size() == 0) {
     // Ignore it; we don't need to copy the bit for the empty bytes.
     return;
@@ -43,70 +83,54 @@ BloomFilter::BloomFilter(std::unique_ptr<BitSet> bit_set,
                       << bytes.size() << ", bit_set.size=" << bit_set_->Size();
     return;
   }
-  for (size_t byte_index = 0; byte_index < bytes.size(); byte_index++) {
-    for (size_t bit_index = 0; bit_index < 8; bit_index++) {
-      bit_set_->Set((byte_index * 8) + bit_index,
-                    (*bytes_read_ptr >> bit_index) & 0x01);
-    }
-    bytes_read_ptr++;
-  }
+  bit_set_->SetFromBytes(bytes.AsStringView());
 }
 
 BloomFilter::operator ByteArray() const {
-  std::string bitset_binary_string = bit_set_->ToString();
-
   ByteArray result_bytes(GetMinBytesForBits());
-  char* result_bytes_write_ptr = result_bytes.data();
-  // We go through the string backwards because the rightmost character
-  // corresponds to position 0 in the bitset.
-  for (size_t i = bit_set_->Size(); i > 0; i -= 8) {
-    std::string byte_binary_string = bitset_binary_string.substr(i - 8, 8);
-    std::uint32_t byte_value;
-    absl::numbers_internal::safe_strtou32_base(byte_binary_string, &byte_value,
-                                               /* base= */ 2);
-    *result_bytes_write_ptr = static_cast<char>(byte_value & 0x000000FF);
-    result_bytes_write_ptr++;
-  }
+  bit_set_->WriteToBytes(
+      absl::MakeSpan(result_bytes.data(), result_bytes.size()));
   return result_bytes;
 }
 
-void BloomFilter::Add(const std::string& s) {
-  std::vector<std::int32_t> hashes = GetHashes(s);
-  for (int32_t hash : hashes) {
-    size_t position = static_cast<size_t>(hash) % bit_set_->Size();
-    bit_set_->Set(position, true);
+void BloomFilter::Add(const Key& key) {
+  const size_t size = bit_set_->Size();
+  for (std::uint32_t i = 1; i <= kHasherNumberOfRepetitions; i++) {
+    bit_set_->Set(key.GetProbe(i) % size, true);
   }
 }
 
-bool BloomFilter::PossiblyContains(const std::string& s) {
-  std::vector<std::int32_t> hashes = GetHashes(s);
-  for (int32_t hash : hashes) {
-    size_t position = static_cast<size_t>(hash) % bit_set_->Size();
-    if (!bit_set_->Test(position)) {
+bool BloomFilter::PossiblyContains(const Key& key) const {
+  const size_t size = bit_set_->Size();
+  for (std::uint32_t i = 1; i <= kHasherNumberOfRepetitions; i++) {
+    if (!bit_set_->Test(key.GetProbe(i) % size)) {
       return false;
     }
   }
   return true;
 }
 
-std::vector<std::int32_t> BloomFilter::GetHashes(const std::string& s) {
-  std::vector<std::int32_t> hashes(kHasherNumberOfRepetitions, 0);
+bool BloomFilter::PossiblyContainsAny(absl::Span<const Key> keys) const {
+  for (const Key& key : keys) {
+    if (PossiblyContains(key)) return true;
+  }
+  return false;
+}
 
-  absl::uint128 hash128;
-  MurmurHash3_x64_128(s.data(), s.size(), 0, &hash128);
-  std::uint64_t hash64 =
-      absl::Uint128Low64(hash128);  // the lower 64 bits of the 128-bit hash
-  std::int32_t hash1 = static_cast<std::int32_t>(
-      hash64 & 0x00000000FFFFFFFF);  // the lower 32 bits of the 64-bit hash
-  std::int32_t hash2 = static_cast<std::int32_t>(
-      (hash64 >> 32) & 0x0FFFFFFFF);  // the upper 32 bits of the 64-bit hash
-  for (size_t i = 1; i <= kHasherNumberOfRepetitions; i++) {
-    std::int32_t combinedHash = static_cast<std::int32_t>(hash1 + (i * hash2));
-    // Flip all the bits if it's negative (guaranteed positive number)
-    if (combinedHash < 0) combinedHash = ~combinedHash;
-    hashes[i - 1] = combinedHash;
+bool BloomFilter::PossiblyContainsAny(const ByteArray& bytes,
+                                      absl::Span<const Key> keys) {
+  const size_t size = bytes.size() * 8;
+  if (size == 0) return false;
+  absl::string_view bits = bytes.AsStringView();
+  for (const Key& key : keys) {
+    bool contains = true;
+    for (std::uint32_t i = 1; contains && i <= kHasherNumberOfRepetitions;
+         i++) {
+      contains = TestBit(bits, key.GetProbe(i) % size);
+    }
+    if (contains) return true;
   }
-  return hashes;
+  return false;
 }
 
 }  // namespace mediums
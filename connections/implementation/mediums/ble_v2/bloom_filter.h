@@ -15,9 +15,15 @@
 #ifndef CORE_INTERNAL_MEDIUMS_BLE_V2_BLOOM_FILTER_H_
 #define CORE_INTERNAL_MEDIUMS_BLE_V2_BLOOM_FILTER_H_
 
-#include <bitset>
-#include <vector>
-
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "internal/platform/byte_array.h"
 
 namespace nearby {
@@ -40,6 +46,13 @@ class BitSet {
   virtual void Set(size_t pos, bool value) = 0;
   virtual bool Test(size_t pos) const = 0;
   virtual size_t Size() const = 0;
+
+  // Sets all the bits from `bytes`, which holds bit `pos` of the set in bit
+  // (pos % 8) of byte (pos / 8). `bytes` must be Size() / 8 long.
+  virtual void SetFromBytes(absl::string_view bytes);
+  // Writes all the bits to `bytes`, in the layout read by SetFromBytes().
+  // `bytes` must be Size() / 8 long.
+  virtual void WriteToBytes(absl::Span<char> bytes) const;
 };
 
 // A bloom filter that gives access to the underlying BitSet. The implementation
@@ -47,6 +60,24 @@ class BitSet {
 // Guava's BloomFilter.
 class BloomFilter {
  public:
+  // A key hashed for the filter. All the probed positions are derived from a
+  // single 128-bit hash of the key, so a key which is checked against many
+  // filters, e.g. a tracked service ID against every scanned advertisement,
+  // only needs to be hashed once.
+  class Key {
+   public:
+    explicit Key(absl::string_view s);
+
+   private:
+    friend class BloomFilter;
+
+    // Returns the `i`-th probe, counting from 1, as a non-negative value.
+    std::uint32_t GetProbe(std::uint32_t i) const;
+
+    std::uint32_t hash1_;
+    std::uint32_t hash2_;
+  };
+
   // Constructs by injecting BitSet implementation. The bit_set will be default
   // zero-out.
   explicit BloomFilter(std::unique_ptr<BitSet> bit_set)
@@ -65,11 +96,21 @@ class BloomFilter {
 
   explicit operator ByteArray() const;
 
-  void Add(const std::string& s);
-  bool PossiblyContains(const std::string& s);
+  void Add(absl::string_view s) { Add(Key(s)); }
+  void Add(const Key& key);
+  bool PossiblyContains(absl::string_view s) const {
+    return PossiblyContains(Key(s));
+  }
+  bool PossiblyContains(const Key& key) const;
+  // Returns true if any of the `keys` is possibly in the filter.
+  bool PossiblyContainsAny(absl::Span<const Key> keys) const;
+
+  // Same as PossiblyContainsAny() on the filter serialized to `bytes`, without
+  // constructing it.
+  static bool PossiblyContainsAny(const ByteArray& bytes,
+                                  absl::Span<const Key> keys);
 
  private:
-  std::vector<std::int32_t> GetHashes(const std::string& s);
   int GetMinBytesForBits() const { return (bit_set_->Size() + 7) >> 3; }
 
   std::unique_ptr<BitSet> bit_set_;
@@ -79,17 +120,46 @@ class BloomFilter {
 //
 // It is templatized on the size of the byte array and not the size of
 // the bit set to ensure the bit set's length is a multiple of 8 (and can
-// neatly be returned as a ByteArray).
+// neatly be returned as a ByteArray). The bits are kept in 64-bit words,
+// which are read and written a byte at a time.
 template <size_t CapacityInBytes>
 class BitSetImpl final : public BitSet {
  public:
-  std::string ToString() const override { return bits_.to_string(); }
-  void Set(size_t pos, bool value) override { bits_.set(pos, value); }
-  bool Test(size_t pos) const override { return bits_.test(pos); }
-  size_t Size() const override { return bits_.size(); }
+  std::string ToString() const override {
+    std::string result(Size(), '0');
+    for (size_t pos = 0; pos < Size(); ++pos) {
+      if (Test(pos)) result[Size() - 1 - pos] = '1';
+    }
+    return result;
+  }
+  void Set(size_t pos, bool value) override {
+    std::uint64_t mask = std::uint64_t{1} << (pos % 64);
+    if (value) {
+      words_[pos / 64] |= mask;
+    } else {
+      words_[pos / 64] &= ~mask;
+    }
+  }
+  bool Test(size_t pos) const override {
+    return (words_[pos / 64] >> (pos % 64)) & 1;
+  }
+  size_t Size() const override { return CapacityInBytes * 8; }
+
+  void SetFromBytes(absl::string_view bytes) override {
+    words_.fill(0);
+    for (size_t i = 0; i < CapacityInBytes; ++i) {
+      words_[i / 8] |= std::uint64_t{static_cast<std::uint8_t>(bytes[i])}
+                       << (i % 8 * 8);
+    }
+  }
+  void WriteToBytes(absl::Span<char> bytes) const override {
+    for (size_t i = 0; i < CapacityInBytes; ++i) {
+      bytes[i] = static_cast<char>(words_[i / 8] >> (i % 8 * 8));
+    }
+  }
 
  private:
-  std::bitset<CapacityInBytes * 8> bits_;
+  std::array<std::uint64_t, (CapacityInBytes + 7) / 8> words_ = {};
 };
 
 }  // namespace mediums
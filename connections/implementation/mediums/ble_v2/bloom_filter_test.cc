@@ -15,8 +15,14 @@
 #include "connections/implementation/mediums/ble_v2/bloom_filter.h"
 
 #include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "internal/platform/byte_array.h"
 
 namespace nearby {
 namespace connections {
@@ -212,6 +218,76 @@ TEST(BloomFilterTest, ConstructLongByteArrayFails) {
   EXPECT_FALSE(bloom_filter_inherited.PossiblyContains("ELEMENT_1"));
 }
 
+TEST(BloomFilterTest, EncodingIsStable) {
+  BloomFilter bloom_filter(std::make_unique<BitSetImpl<10>>());
+
+  bloom_filter.Add("ELEMENT_1");
+  bloom_filter.Add("ELEMENT_2");
+
+  // Filters are exchanged with other platforms, the bits of an element must
+  // not change.
+  EXPECT_EQ(std::string(ByteArray(bloom_filter)),
+            std::string("\x00\x10\x14\x20\x04\x04\x04\x60\x00\x00", 10));
+}
+
+TEST(BloomFilterTest, KeyMatchesString) {
+  BloomFilter bloom_filter(std::make_unique<BitSetImpl<kByteArrayLength>>());
+  BloomFilter::Key key("ELEMENT_1");
+
+  bloom_filter.Add(key);
+
+  EXPECT_TRUE(bloom_filter.PossiblyContains("ELEMENT_1"));
+  EXPECT_TRUE(bloom_filter.PossiblyContains(key));
+  EXPECT_FALSE(bloom_filter.PossiblyContains(BloomFilter::Key("ELEMENT_2")));
+}
+
+TEST(BloomFilterTest, PossiblyContainsAny) {
+  BloomFilter bloom_filter(std::make_unique<BitSetImpl<kByteArrayLength>>());
+  bloom_filter.Add("ELEMENT_2");
+  std::vector<BloomFilter::Key> keys = {BloomFilter::Key("ELEMENT_1"),
+                                        BloomFilter::Key("ELEMENT_3")};
+
+  EXPECT_FALSE(bloom_filter.PossiblyContainsAny(keys));
+  EXPECT_FALSE(bloom_filter.PossiblyContainsAny({}));
+
+  keys.push_back(BloomFilter::Key("ELEMENT_2"));
+
+  EXPECT_TRUE(bloom_filter.PossiblyContainsAny(keys));
+}
+
+TEST(BloomFilterTest, PossiblyContainsAnyInBytesMatchesFilter) {
+  BloomFilter bloom_filter(std::make_unique<BitSetImpl<10>>());
+  bloom_filter.Add("ELEMENT_1");
+  bloom_filter.Add("ELEMENT_2");
+  ByteArray bloom_filter_bytes(bloom_filter);
+
+  for (int i = 0; i < 100; i++) {
+    BloomFilter::Key key("ELEMENT_" + std::to_string(i));
+    EXPECT_EQ(BloomFilter::PossiblyContainsAny(bloom_filter_bytes, {&key, 1}),
+              bloom_filter.PossiblyContains(key))
+        << i;
+  }
+  BloomFilter::Key key("ELEMENT_1");
+  EXPECT_FALSE(BloomFilter::PossiblyContainsAny(ByteArray(), {&key, 1}));
+}
+
+TEST(BloomFilterTest, BitSetImplRoundTripsBytes) {
+  BitSetImpl<3> bit_set;
+  bit_set.Set(0, true);
+  bit_set.Set(9, true);
+  bit_set.Set(23, true);
+
+  char bytes[3];
+  bit_set.WriteToBytes(absl::MakeSpan(bytes));
+
+  EXPECT_EQ(std::string(bytes, 3), std::string("\x01\x02\x80", 3));
+  EXPECT_EQ(bit_set.ToString(), "100000000000001000000001");
+
+  BitSetImpl<3> copy;
+  copy.SetFromBytes(absl::string_view(bytes, 3));
+  EXPECT_EQ(copy.ToString(), bit_set.ToString());
+}
+
 }  // namespace
 }  // namespace mediums
 }  // namespace connections
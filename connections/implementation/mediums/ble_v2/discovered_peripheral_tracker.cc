@@ -22,6 +22,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/escaping.h"
@@ -100,6 +101,7 @@ void DiscoveredPeripheralTracker::StartTracking(
 
   // Replace if key exists.
   service_id_infos_.insert_or_assign(service_id, std::move(service_id_info));
+  UpdateServiceIdBloomFilterKeys();
 
   // Add service id hash to service id map for dct advertisement.
   if (include_dct_advertisement) {
@@ -113,6 +115,7 @@ void DiscoveredPeripheralTracker::StartTracking(
   // the new service we're now tracking.
   // See the documentation of advertisementReadResult for more information.
   advertisement_read_results_.clear();
+  ++read_results_generation_;
 
   // Remove stale data from any previous sessions.
   ClearDataForServiceId(service_id);
@@ -124,6 +127,7 @@ void DiscoveredPeripheralTracker::StopTracking(const std::string& service_id) {
   dct_service_id_hash_to_service_id_map_.erase(
       advertisements::ble::DctAdvertisement::ComputeServiceIdHash(service_id));
   service_id_infos_.erase(service_id);
+  UpdateServiceIdBloomFilterKeys();
 }
 
 void DiscoveredPeripheralTracker::ProcessFoundBleAdvertisement(
@@ -195,47 +199,60 @@ bool DiscoveredPeripheralTracker::HandleOnLostAdvertisementLocked(
   }
 
   for (const auto& hash : on_lost_advertisement->hashes()) {
-    for (const auto& it : gatt_advertisement_infos_) {
-      if (it.second.advertisement_header.GetAdvertisementHash().string_data() ==
-          hash) {
-        auto discovery_cb_it = service_id_infos_.find(it.second.service_id);
-        if (discovery_cb_it == service_id_infos_.end()) {
-          LOG(INFO)
-              << __func__
-              << ": Discarding OnLost advertisement for untracked service_id";
-          break;
-        }
-
-        auto gatt_advertisements =
-            gatt_advertisements_[it.second.advertisement_header];
+    const auto hash_it = gatt_advertisements_by_hash_.find(hash);
+    if (hash_it == gatt_advertisements_by_hash_.end() ||
+        hash_it->second.empty()) {
+      continue;
+    }
+    const auto gai_it =
+        gatt_advertisement_infos_.find(*hash_it->second.begin());
+    if (gai_it == gatt_advertisement_infos_.end()) {
+      continue;
+    }
+    // Copy the info out, ClearGattAdvertisement() below erases it.
+    const GattAdvertisementInfo gatt_advertisement_info = gai_it->second;
+    auto discovery_cb_it =
+        service_id_infos_.find(gatt_advertisement_info.service_id);
+    if (discovery_cb_it == service_id_infos_.end()) {
+      LOG(INFO) << __func__
+                << ": Discarding OnLost advertisement for untracked service_id";
+      continue;
+    }
 
-        // Need to report OnLost for each gatt_advertisement.
-        for (const auto& gatt_advertisement : gatt_advertisements) {
-          BleV2Peripheral lost_peripheral = it.second.peripheral;
-          lost_peripheral.SetId(ByteArray(gatt_advertisement));
-          if (gatt_advertisement.IsValid()) {
-            if (NearbyFlags::GetInstance().GetBoolFlag(
-                    config_package_nearby::nearby_connections_feature::
-                        kEnableInstantOnLost)) {
-              AddInstantLostAdvertisement(it.second.advertisement_header);
-              discovery_cb_it->second.discovered_peripheral_callback
-                  .instant_lost_cb(lost_peripheral, it.second.service_id,
-                                   gatt_advertisement.GetData(),
-                                   gatt_advertisement.IsFastAdvertisement());
-            } else {
-              discovery_cb_it->second.discovered_peripheral_callback
-                  .peripheral_lost_cb(lost_peripheral, it.second.service_id,
-                                      gatt_advertisement.GetData(),
-                                      gatt_advertisement.IsFastAdvertisement());
-            }
-            LOG(INFO) << __func__ << ": OnLost triggered for service_id "
-                      << it.second.service_id;
-          }
+    BleAdvertisementSet gatt_advertisements;
+    const auto ga_it =
+        gatt_advertisements_.find(gatt_advertisement_info.advertisement_header);
+    if (ga_it != gatt_advertisements_.end()) {
+      gatt_advertisements = ga_it->second;
+    }
 
-          ClearGattAdvertisement(gatt_advertisement);
+    // Need to report OnLost for each gatt_advertisement.
+    for (const auto& gatt_advertisement : gatt_advertisements) {
+      BleV2Peripheral lost_peripheral = gatt_advertisement_info.peripheral;
+      lost_peripheral.SetId(ByteArray(gatt_advertisement));
+      if (gatt_advertisement.IsValid()) {
+        if (NearbyFlags::GetInstance().GetBoolFlag(
+                config_package_nearby::nearby_connections_feature::
+                    kEnableInstantOnLost)) {
+          AddInstantLostAdvertisement(
+              gatt_advertisement_info.advertisement_header);
+          discovery_cb_it->second.discovered_peripheral_callback
+              .instant_lost_cb(lost_peripheral,
+                               gatt_advertisement_info.service_id,
+                               gatt_advertisement.GetData(),
+                               gatt_advertisement.IsFastAdvertisement());
+        } else {
+          discovery_cb_it->second.discovered_peripheral_callback
+              .peripheral_lost_cb(lost_peripheral,
+                                  gatt_advertisement_info.service_id,
+                                  gatt_advertisement.GetData(),
+                                  gatt_advertisement.IsFastAdvertisement());
         }
-        break;
+        LOG(INFO) << __func__ << ": OnLost triggered for service_id "
+                  << gatt_advertisement_info.service_id;
       }
+
+      ClearGattAdvertisement(gatt_advertisement);
     }
   }
   return true;
@@ -311,6 +328,8 @@ void DiscoveredPeripheralTracker::ClearGattAdvertisement(
   }
   auto item = gatt_advertisement_infos_.extract(gai_it);
   GattAdvertisementInfo& gatt_advertisement_info = item.mapped();
+  RemoveGattAdvertisementFromHashIndex(
+      gatt_advertisement, gatt_advertisement_info.advertisement_header);
 
   const auto ga_it =
       gatt_advertisements_.find(gatt_advertisement_info.advertisement_header);
@@ -333,6 +352,20 @@ void DiscoveredPeripheralTracker::ClearGattAdvertisement(
   }
 }
 
+void DiscoveredPeripheralTracker::RemoveGattAdvertisementFromHashIndex(
+    const BleAdvertisement& gatt_advertisement,
+    const BleAdvertisementHeader& advertisement_header) {
+  const auto it = gatt_advertisements_by_hash_.find(
+      advertisement_header.GetAdvertisementHash().AsStringView());
+  if (it == gatt_advertisements_by_hash_.end()) {
+    return;
+  }
+  it->second.erase(gatt_advertisement);
+  if (it->second.empty()) {
+    gatt_advertisements_by_hash_.erase(it);
+  }
+}
+
 void DiscoveredPeripheralTracker::HandleAdvertisement(
     BleV2Peripheral peripheral,
     const nearby::api::ble_v2::BleAdvertisementData& advertisement_data) {
@@ -501,6 +534,13 @@ BleAdvertisementHeader DiscoveredPeripheralTracker::HandleRawGattAdvertisements(
         .service_id = service_id,
         .advertisement_header = new_advertisement_header,
         .peripheral = peripheral};
+    if (gai_it != gatt_advertisement_infos_.end()) {
+      RemoveGattAdvertisementFromHashIndex(gatt_advertisement,
+                                           old_advertisement_header);
+    }
+    gatt_advertisements_by_hash_[std::string(
+        new_advertisement_header.GetAdvertisementHash())]
+        .insert(gatt_advertisement);
     gatt_advertisement_infos_.insert_or_assign(
         gatt_advertisement, std::move(gatt_advertisement_info));
   }
@@ -611,14 +651,16 @@ bool DiscoveredPeripheralTracker::IsDummyAdvertisementHeader(
   // regular advertisement has different value, it will include PSM value if
   // received it from extended advertisement protocol and it will not has PSM
   // value if it fetched from GATT connection.
-  BloomFilter bloom_filter(
-      std::make_unique<BitSetImpl<
-          BleAdvertisementHeader::kServiceIdBloomFilterByteLength>>());
+  // The service ID bloom filter is empty.
+  const ByteArray service_id_bloom_filter =
+      advertisement_header.GetServiceIdBloomFilter();
   return advertisement_header.GetVersion() ==
              BleAdvertisementHeader::Version::kV2 &&
          advertisement_header.GetNumSlots() == 1 &&
-         advertisement_header.GetServiceIdBloomFilter() ==
-             ByteArray(bloom_filter);
+         service_id_bloom_filter.size() ==
+             BleAdvertisementHeader::kServiceIdBloomFilterByteLength &&
+         absl::c_all_of(service_id_bloom_filter.AsStringView(),
+                        [](char c) { return c == 0; });
 }
 
 std::optional<BleAdvertisementData>
@@ -774,20 +816,25 @@ ByteArray DiscoveredPeripheralTracker::ExtractAdvertisementHeaderBytes(
   return {};
 }
 
+void DiscoveredPeripheralTracker::UpdateServiceIdBloomFilterKeys() {
+  service_id_bloom_filter_keys_.clear();
+  service_id_bloom_filter_keys_.reserve(service_id_infos_.size());
+  for (const auto& item : service_id_infos_) {
+    service_id_bloom_filter_keys_.emplace_back(item.first);
+  }
+}
+
 bool DiscoveredPeripheralTracker::IsInterestingAdvertisementHeader(
     const BleAdvertisementHeader& advertisement_header) {
-  BloomFilter bloom_filter(
-      std::make_unique<BitSetImpl<
-          BleAdvertisementHeader::kServiceIdBloomFilterByteLength>>(),
-      advertisement_header.GetServiceIdBloomFilter());
-
-  for (const auto& item : service_id_infos_) {
-    const std::string& service_id = item.first;
-    if (bloom_filter.PossiblyContains(service_id)) {
-      return true;
-    }
+  const ByteArray service_id_bloom_filter =
+      advertisement_header.GetServiceIdBloomFilter();
+  // A filter of another size can't be read.
+  if (service_id_bloom_filter.size() !=
+      BleAdvertisementHeader::kServiceIdBloomFilterByteLength) {
+    return false;
   }
-  return false;
+  return BloomFilter::PossiblyContainsAny(service_id_bloom_filter,
+                                          service_id_bloom_filter_keys_);
 }
 
 bool DiscoveredPeripheralTracker::ShouldReadRawAdvertisementFromServer(
@@ -848,8 +895,18 @@ DiscoveredPeripheralTracker::FetchRawAdvertisements(
     BleV2Peripheral peripheral,
     const BleAdvertisementHeader& advertisement_header,
     AdvertisementFetcher advertisement_fetcher) {
-  // Fetch the raw GATT advertisements and store the results.
-  auto& result = advertisement_read_results_[advertisement_header];
+  if (!fetching_advertisements_.insert(advertisement_header).second) {
+    VLOG(1) << ": Ignore the advertisement header due to it "
+               "is already in fetching.";
+    return {};
+  }
+
+  // Take the last read result out of the map while it's being updated.
+  std::unique_ptr<mediums::AdvertisementReadResult> result;
+  auto item = advertisement_read_results_.extract(advertisement_header);
+  if (!item.empty()) {
+    result = std::move(item.mapped());
+  }
   if (result == nullptr) {
     result = std::make_unique<mediums::AdvertisementReadResult>();
   }
@@ -858,12 +915,30 @@ DiscoveredPeripheralTracker::FetchRawAdvertisements(
   std::transform(service_id_infos_.begin(), service_id_infos_.end(),
                  std::back_inserter(service_ids),
                  [](auto& kv) { return kv.first; });
+  int read_results_generation = read_results_generation_;
+
+  // Reading GATT advertisements takes seconds, don't hold up the scan results
+  // of other peripherals meanwhile.
+  mutex_.Unlock();
   advertisement_fetcher(peripheral, advertisement_header.GetNumSlots(),
                         advertisement_header.GetPsm(), service_ids, *result);
+  mutex_.Lock();
+
+  fetching_advertisements_.erase(advertisement_header);
+  // Drop the result if tracking changed while reading. It may miss the
+  // service IDs we track now, and the header will be read again next time.
+  if (read_results_generation != read_results_generation_ ||
+      !IsInterestingAdvertisementHeader(advertisement_header)) {
+    LOG(INFO) << ": Ignore the fetched GATT advertisement from server due to "
+                 "tracking changed while reading it.";
+    return {};
+  }
 
   // Take those results and return all the advertisements we were able to
   // read.
-  return result->GetAdvertisements();
+  auto it = advertisement_read_results_.insert_or_assign(advertisement_header,
+                                                         std::move(result));
+  return it.first->second->GetAdvertisements();
 }
 
 void DiscoveredPeripheralTracker::FetchRawAdvertisementsInThread(
@@ -871,6 +946,7 @@ void DiscoveredPeripheralTracker::FetchRawAdvertisementsInThread(
     const BleAdvertisementHeader& advertisement_header,
     AdvertisementFetcher advertisement_fetcher) {
   std::vector<std::string> service_ids;
+  int read_results_generation;
 
   {
     MutexLock lock(&mutex_);
@@ -884,6 +960,7 @@ void DiscoveredPeripheralTracker::FetchRawAdvertisementsInThread(
     std::transform(service_id_infos_.begin(), service_id_infos_.end(),
                    std::back_inserter(service_ids),
                    [](auto& kv) { return kv.first; });
+    read_results_generation = read_results_generation_;
   }
 
   auto result = std::make_unique<mediums::AdvertisementReadResult>();
@@ -894,10 +971,12 @@ void DiscoveredPeripheralTracker::FetchRawAdvertisementsInThread(
     // The fetching process might take a few seconds, and tracking settings
     // could change during that time. We need to double-check if the result
     // is still valid afterward.
-    if (!IsInterestingAdvertisementHeader(advertisement_header)) {
+    if (read_results_generation != read_results_generation_ ||
+        !IsInterestingAdvertisementHeader(advertisement_header)) {
       LOG(WARNING)
-          << ": Ignore the fetched GATT advertisement from server due to it "
-             "is not interesting header now.";
+          << ": Ignore the fetched GATT advertisement from server due to "
+             "tracking changed while reading it.";
+      fetching_advertisements_.erase(advertisement_header);
       return;
     }
 
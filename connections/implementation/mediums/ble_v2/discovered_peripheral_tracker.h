@@ -30,6 +30,7 @@
 #include "connections/implementation/mediums/ble_v2/advertisement_read_result.h"
 #include "connections/implementation/mediums/ble_v2/ble_advertisement.h"
 #include "connections/implementation/mediums/ble_v2/ble_advertisement_header.h"
+#include "connections/implementation/mediums/ble_v2/bloom_filter.h"
 #include "connections/implementation/mediums/ble_v2/discovered_peripheral_callback.h"
 #include "connections/implementation/mediums/lost_entity_tracker.h"
 #include "connections/implementation/pcp.h"
@@ -159,7 +160,7 @@ class DiscoveredPeripheralTracker {
   // Clears out all data related to the provided GATT advertisement. This
   // includes:
   //   1. Removing the corresponding GATT advertisement from
-  //      gatt_advertisement_infos_.
+  //      gatt_advertisement_infos_ and gatt_advertisements_by_hash_.
   //   2. Removing the corresponding advertisement header from
   //      advertisement_read_results.
   //   3. Removing the corresponding advertisement header from
@@ -168,6 +169,13 @@ class DiscoveredPeripheralTracker {
   void ClearGattAdvertisement(const BleAdvertisement& gatt_advertisement)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Removes `gatt_advertisement` from gatt_advertisements_by_hash_ under the
+  // hash of `advertisement_header`.
+  void RemoveGattAdvertisementFromHashIndex(
+      const BleAdvertisement& gatt_advertisement,
+      const BleAdvertisementHeader& advertisement_header)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Handles the legacy fast advertisement or the extended fast/regular
   // advertisement.
   void HandleAdvertisement(
@@ -229,6 +237,9 @@ class DiscoveredPeripheralTracker {
       const api::ble_v2::BleAdvertisementData& advertisement_data)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Rehashes the tracked service IDs after they changed.
+  void UpdateServiceIdBloomFilterKeys() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Returns true if the advertisement header contains a service ID we're
   // tracking.
   bool IsInterestingAdvertisementHeader(
@@ -242,7 +253,10 @@ class DiscoveredPeripheralTracker {
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   // Fetches advertisement from BLE medium if advertisement header is read in
-  // AdvertisementData.
+  // AdvertisementData. `mutex_` is released while `advertisement_fetcher`
+  // runs, so scan results of other peripherals are processed meanwhile.
+  // Returns nothing if the header is already being read, or if tracking
+  // changed during the read.
   //
   // advertisement_fetcher : a fetcher passed from BLE medium to read the
   // advertisement from BLE characteristics by GATT server.
@@ -298,6 +312,11 @@ class DiscoveredPeripheralTracker {
   absl::flat_hash_map<std::string, std::string>
       dct_service_id_hash_to_service_id_map_ ABSL_GUARDED_BY(mutex_);
 
+  // The keys of `service_id_infos_`, hashed once for the service ID bloom
+  // filter of every advertisement header.
+  std::vector<BloomFilter::Key> service_id_bloom_filter_keys_
+      ABSL_GUARDED_BY(mutex_);
+
   // ------------ ADVERTISEMENT HEADER MAPS ------------
   // Maps advertisement headers to AdvertisementReadResult. Tells us when to
   // retry reading a GATT advertisement. If no entry exists for a particular
@@ -316,6 +335,10 @@ class DiscoveredPeripheralTracker {
                       std::unique_ptr<AdvertisementReadResult>>
       advertisement_read_results_ ABSL_GUARDED_BY(mutex_);
 
+  // Incremented whenever advertisement_read_results_ is cleared, so that GATT
+  // reads that were in progress at the time don't store their results.
+  int read_results_generation_ ABSL_GUARDED_BY(mutex_) = 0;
+
   // Maps advertisement headers to a set of GATT advertisements from a single
   // peripheral. Used to retrieve GATT advertisements that we need to reprocess
   // every time a header is seen. Entries are added when GATT advertisements are
@@ -331,6 +354,12 @@ class DiscoveredPeripheralTracker {
   absl::flat_hash_map<BleAdvertisement, GattAdvertisementInfo>
       gatt_advertisement_infos_ ABSL_GUARDED_BY(mutex_);
 
+  // Maps an advertisement header's hash to the GATT advertisements in
+  // gatt_advertisement_infos_ whose header carries that hash. Kept in step with
+  // gatt_advertisement_infos_ so instant on-lost hashes are looked up directly.
+  absl::flat_hash_map<std::string, BleAdvertisementSet>
+      gatt_advertisements_by_hash_ ABSL_GUARDED_BY(mutex_);
+
   // Tracks the advertisements in GATT fetching.
   absl::flat_hash_set<BleAdvertisementHeader> fetching_advertisements_
       ABSL_GUARDED_BY(mutex_);
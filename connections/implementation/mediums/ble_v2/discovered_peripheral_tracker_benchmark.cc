@@ -0,0 +1,189 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks DiscoveredPeripheralTracker with a growing number of discovered
+// peripherals: the cost of an instant on-lost advertisement, and of seeing an
+// already discovered advertisement header again.
+//
+// Run with
+//   bazel run -c opt \
+//     //connections/implementation/mediums/ble_v2:discovered_peripheral_tracker_benchmark
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "connections/implementation/flags/nearby_connections_feature_flags.h"
+#include "connections/implementation/mediums/ble_v2/advertisement_read_result.h"
+#include "connections/implementation/mediums/ble_v2/ble_advertisement.h"
+#include "connections/implementation/mediums/ble_v2/ble_advertisement_header.h"
+#include "connections/implementation/mediums/ble_v2/ble_utils.h"
+#include "connections/implementation/mediums/ble_v2/bloom_filter.h"
+#include "connections/implementation/mediums/ble_v2/discovered_peripheral_tracker.h"
+#include "connections/implementation/mediums/ble_v2/instant_on_lost_advertisement.h"
+#include "connections/implementation/mediums/utils.h"
+#include "connections/implementation/pcp.h"
+#include "internal/flags/nearby_flags.h"
+#include "internal/platform/ble_v2.h"
+#include "internal/platform/bluetooth_adapter.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/implementation/ble_v2.h"
+#include "internal/platform/mac_address.h"
+#include "internal/platform/medium_environment.h"
+#include "internal/platform/uuid.h"
+
+namespace nearby {
+namespace connections {
+namespace mediums {
+namespace {
+
+constexpr absl::string_view kServiceId = "benchmark-service-id";
+constexpr absl::string_view kDeviceToken = "\x04\x20";
+
+ByteArray CreateAdvertisementHeader(const ByteArray& advertisement_hash) {
+  BloomFilter service_id_bloom_filter(
+      std::make_unique<BitSetImpl<
+          BleAdvertisementHeader::kServiceIdBloomFilterByteLength>>());
+  service_id_bloom_filter.Add(kServiceId);
+  return ByteArray(BleAdvertisementHeader(
+      BleAdvertisementHeader::Version::kV2, /*extended_advertisement=*/false,
+      /*num_slots=*/1, ByteArray(service_id_bloom_filter), advertisement_hash,
+      BleAdvertisementHeader::kDefaultPsmValue));
+}
+
+api::ble_v2::BleAdvertisementData CreateAdvertisementData(
+    const ByteArray& service_data) {
+  api::ble_v2::BleAdvertisementData advertisement_data{};
+  advertisement_data.service_data.insert(
+      {bleutils::kCopresenceServiceUuid, service_data});
+  return advertisement_data;
+}
+
+// A tracker that has discovered `peripheral_count` peripherals, each with its
+// own advertisement header.
+class TrackerFixture {
+ public:
+  explicit TrackerFixture(int peripheral_count) {
+    NearbyFlags::GetInstance().OverrideBoolFlagValue(
+        config_package_nearby::nearby_connections_feature::
+            kEnableGattQueryInThread,
+        false);
+    MediumEnvironment::Instance().Start();
+    adapter_ = std::make_unique<BluetoothAdapter>();
+    medium_ = std::make_unique<BleV2Medium>(*adapter_);
+    MacAddress mac_address;
+    MacAddress::FromString(adapter_->GetMacAddress(), mac_address);
+    peripheral_ = BleV2Peripheral(*medium_, mac_address.address());
+
+    tracker_.StartTracking(std::string(kServiceId),
+                           /*include_dct_advertisement=*/false,
+                           Pcp::kP2pPointToPoint, {}, Uuid());
+    for (int i = 0; i < peripheral_count; ++i) {
+      ByteArray advertisement_hash = Utils::GenerateRandomBytes(
+          BleAdvertisementHeader::kAdvertisementHashByteLength);
+      ByteArray header = CreateAdvertisementHeader(advertisement_hash);
+      ByteArray advertisement(BleAdvertisement(
+          BleAdvertisement::Version::kV2, BleAdvertisement::SocketVersion::kV2,
+          bleutils::GenerateServiceIdHash(std::string(kServiceId)),
+          ByteArray(absl::StrCat("data", i)),
+          ByteArray(std::string(kDeviceToken)),
+          BleAdvertisementHeader::kDefaultPsmValue));
+      Find(CreateAdvertisementData(header), advertisement);
+      headers_.push_back(std::move(header));
+    }
+  }
+
+  ~TrackerFixture() {
+    tracker_.StopTracking(std::string(kServiceId));
+    MediumEnvironment::Instance().Stop();
+    NearbyFlags::GetInstance().ResetOverridedValues();
+  }
+
+  // Reports `advertisement_data`, answering any GATT read with
+  // `advertisement`.
+  void Find(const api::ble_v2::BleAdvertisementData& advertisement_data,
+            const ByteArray& advertisement = ByteArray()) {
+    tracker_.ProcessFoundBleAdvertisement(
+        peripheral_, advertisement_data,
+        [advertisement](BleV2Peripheral, int, int,
+                        const std::vector<std::string>&,
+                        AdvertisementReadResult& advertisement_read_result) {
+          advertisement_read_result.AddAdvertisement(0, advertisement);
+          advertisement_read_result.RecordLastReadStatus(/*is_success=*/true);
+        });
+  }
+
+  const std::vector<ByteArray>& headers() const { return headers_; }
+
+ private:
+  std::unique_ptr<BluetoothAdapter> adapter_;
+  std::unique_ptr<BleV2Medium> medium_;
+  BleV2Peripheral peripheral_;
+  DiscoveredPeripheralTracker tracker_;
+  std::vector<ByteArray> headers_;
+};
+
+// An instant on-lost advertisement whose hashes match none of the discovered
+// peripherals, so the tracker state is the same for every iteration.
+void BM_InstantOnLostAdvertisement(benchmark::State& state) {
+  TrackerFixture fixture(state.range(0));
+  std::list<std::string> hashes;
+  for (int i = 0; i < InstantOnLostAdvertisement::kMaxHashCount; ++i) {
+    hashes.push_back(std::string(Utils::GenerateRandomBytes(
+        BleAdvertisementHeader::kAdvertisementHashByteLength)));
+  }
+  auto on_lost_advertisement =
+      InstantOnLostAdvertisement::CreateFromHashes(hashes);
+  if (!on_lost_advertisement.ok()) {
+    state.SkipWithError("Failed to create the on-lost advertisement.");
+    return;
+  }
+  api::ble_v2::BleAdvertisementData advertisement_data =
+      CreateAdvertisementData(ByteArray(on_lost_advertisement->ToBytes()));
+
+  for (auto _ : state) {
+    fixture.Find(advertisement_data);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InstantOnLostAdvertisement)
+    ->ArgName("peripherals")
+    ->RangeMultiplier(10)
+    ->Range(1, 1000);
+
+// An advertisement header that was already read over GATT.
+void BM_RediscoveredAdvertisementHeader(benchmark::State& state) {
+  TrackerFixture fixture(state.range(0));
+  api::ble_v2::BleAdvertisementData advertisement_data =
+      CreateAdvertisementData(fixture.headers().back());
+
+  for (auto _ : state) {
+    fixture.Find(advertisement_data);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RediscoveredAdvertisementHeader)
+    ->ArgName("peripherals")
+    ->RangeMultiplier(10)
+    ->Range(1, 1000);
+
+}  // namespace
+}  // namespace mediums
+}  // namespace connections
+}  // namespace nearby
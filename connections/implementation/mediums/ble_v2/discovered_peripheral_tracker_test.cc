@@ -18,12 +18,14 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
@@ -1287,6 +1289,75 @@ TEST_P(DiscoveredPeripheralTrackerTest, InstantLostPeripheralForInstantOnLost) {
   EXPECT_TRUE(lost_latch.Await(kWaitDuration).result());
 }
 
+TEST_P(DiscoveredPeripheralTrackerTest,
+       InstantLostOnlyMatchingPeripheralAmongManyForInstantOnLost) {
+  EnableInstantOnLost();
+  constexpr int kPeripheralCount = 100;
+  constexpr int kLostIndex = 42;
+  std::vector<std::string> service_ids = {std::string(kServiceIdA)};
+  std::vector<ByteArray> advertisement_hashes;
+  CountDownLatch found_latch(kPeripheralCount);
+  CountDownLatch lost_latch(1);
+  std::atomic<int> lost_count = 0;
+
+  discovered_peripheral_tracker_.StartTracking(
+      std::string(kServiceIdA), false, Pcp::kP2pPointToPoint,
+      {
+          .peripheral_discovered_cb =
+              [&found_latch](BleV2Peripheral peripheral,
+                             const std::string& service_id,
+                             const ByteArray& advertisement_bytes,
+                             bool fast_advertisement) {
+                found_latch.CountDown();
+              },
+          .instant_lost_cb =
+              [&lost_latch, &lost_count](BleV2Peripheral peripheral,
+                                         const std::string& service_id,
+                                         const ByteArray& advertisement_bytes,
+                                         bool fast_advertisement) {
+                EXPECT_EQ(advertisement_bytes,
+                          ByteArray(absl::StrCat("data", kLostIndex)));
+                lost_count++;
+                lost_latch.CountDown();
+              },
+      },
+      {});
+
+  for (int i = 0; i < kPeripheralCount; ++i) {
+    ByteArray advertisement_hash = GenerateRandomAdvertisementHash();
+    advertisement_hashes.push_back(advertisement_hash);
+    api::ble_v2::BleAdvertisementData advertisement_data{};
+    advertisement_data.service_data.insert(
+        {bleutils::kCopresenceServiceUuid,
+         CreateBleAdvertisementHeader(advertisement_hash, service_ids)});
+    CountDownLatch fetch_latch(1);
+    FindAdvertisement(advertisement_data,
+                      {CreateBleAdvertisement(
+                          std::string(kServiceIdA),
+                          ByteArray(absl::StrCat("data", i)),
+                          ByteArray(std::string(kDeviceToken)))},
+                      fetch_latch);
+    fetch_latch.Await(kWaitDuration);
+  }
+  ASSERT_TRUE(found_latch.Await(kWaitDuration).result());
+
+  // Only one of the hashes belongs to a tracked peripheral.
+  auto advertisement = InstantOnLostAdvertisement::CreateFromHashes(
+      std::list<std::string>({std::string(GenerateRandomAdvertisementHash()),
+                              std::string(advertisement_hashes[kLostIndex])}));
+  ASSERT_OK(advertisement);
+  api::ble_v2::BleAdvertisementData loss_advertisement_data{};
+  loss_advertisement_data.service_data.insert(
+      {bleutils::kCopresenceServiceUuid, ByteArray(advertisement->ToBytes())});
+  CountDownLatch fetch_latch(1);
+
+  FindAdvertisement(loss_advertisement_data,
+                    {ByteArray(advertisement->ToBytes())}, fetch_latch);
+
+  EXPECT_TRUE(lost_latch.Await(kWaitDuration).result());
+  EXPECT_EQ(lost_count, 1);
+}
+
 TEST_P(DiscoveredPeripheralTrackerTest,
        IgnoreFoundAdvertisementForInstantOnLost) {
   EnableInstantOnLost();
@@ -1637,6 +1708,140 @@ TEST_P(DiscoveredPeripheralTrackerTest,
   EXPECT_EQ(GetFetchAdvertisementCallbackCount(), 2);
 }
 
+TEST_P(DiscoveredPeripheralTrackerTest, GattReadDoesNotBlockOtherPeripherals) {
+  if (GetParam()) {
+    GTEST_SKIP() << "GATT reads are queued on one thread when they run in "
+                    "the tracker's executor.";
+  }
+  constexpr int kOtherPeripheralCount = 10;
+  std::vector<std::string> service_ids = {std::string(kServiceIdA)};
+  CountDownLatch slow_found_latch(1);
+  CountDownLatch other_found_latch(kOtherPeripheralCount);
+  CountDownLatch read_started_latch(1);
+  CountDownLatch read_released_latch(1);
+
+  discovered_peripheral_tracker_.StartTracking(
+      std::string(kServiceIdA), false, Pcp::kP2pPointToPoint,
+      {
+          .peripheral_discovered_cb =
+              [&](BleV2Peripheral peripheral, const std::string& service_id,
+                  const ByteArray& advertisement_bytes,
+                  bool fast_advertisement) {
+                if (advertisement_bytes == ByteArray(std::string(kData))) {
+                  slow_found_latch.CountDown();
+                } else {
+                  other_found_latch.CountDown();
+                }
+              },
+      },
+      {});
+
+  api::ble_v2::BleAdvertisementData slow_advertisement_data{};
+  slow_advertisement_data.service_data.insert(
+      {bleutils::kCopresenceServiceUuid,
+       CreateBleAdvertisementHeader(GenerateRandomAdvertisementHash(),
+                                    service_ids)});
+  ByteArray slow_advertisement_bytes = CreateBleAdvertisement(
+      std::string(kServiceIdA), ByteArray(std::string(kData)),
+      ByteArray(std::string(kDeviceToken)));
+  std::thread slow_scan([&]() {
+    discovered_peripheral_tracker_.ProcessFoundBleAdvertisement(
+        CreateBlePeripheral(), slow_advertisement_data,
+        [&](BleV2Peripheral peripheral, int num_slots, int psm,
+            const std::vector<std::string>& interesting_service_ids,
+            mediums::AdvertisementReadResult& advertisement_read_result) {
+          read_started_latch.CountDown();
+          read_released_latch.Await();
+          advertisement_read_result.AddAdvertisement(0,
+                                                     slow_advertisement_bytes);
+          advertisement_read_result.RecordLastReadStatus(/*is_success=*/true);
+        });
+  });
+  ASSERT_TRUE(read_started_latch.Await(kWaitDuration).result());
+
+  // Other peripherals are discovered while the first GATT read is blocked.
+  for (int i = 0; i < kOtherPeripheralCount; ++i) {
+    api::ble_v2::BleAdvertisementData advertisement_data{};
+    advertisement_data.service_data.insert(
+        {bleutils::kCopresenceServiceUuid,
+         CreateBleAdvertisementHeader(GenerateRandomAdvertisementHash(),
+                                      service_ids)});
+    CountDownLatch fetch_latch(1);
+    FindAdvertisement(advertisement_data,
+                      {CreateBleAdvertisement(
+                          std::string(kServiceIdA),
+                          ByteArray(absl::StrCat("data", i)),
+                          ByteArray(std::string(kDeviceToken)))},
+                      fetch_latch);
+  }
+  EXPECT_TRUE(other_found_latch.Await(kWaitDuration).result());
+  EXPECT_FALSE(slow_found_latch.Await(absl::ZeroDuration()).result());
+
+  read_released_latch.CountDown();
+  slow_scan.join();
+  EXPECT_TRUE(slow_found_latch.Await(kWaitDuration).result());
+}
+
+TEST_P(DiscoveredPeripheralTrackerTest, ScanResultsFromManyThreads) {
+  constexpr int kThreadCount = 4;
+  constexpr int kPeripheralsPerThread = 25;
+  std::vector<std::string> service_ids = {std::string(kServiceIdA)};
+  CountDownLatch found_latch(kThreadCount * kPeripheralsPerThread);
+  std::atomic<bool> scanning = true;
+
+  discovered_peripheral_tracker_.StartTracking(
+      std::string(kServiceIdA), false, Pcp::kP2pPointToPoint,
+      {
+          .peripheral_discovered_cb =
+              [&found_latch](BleV2Peripheral peripheral,
+                             const std::string& service_id,
+                             const ByteArray& advertisement_bytes,
+                             bool fast_advertisement) {
+                found_latch.CountDown();
+              },
+      },
+      {});
+
+  std::vector<std::thread> scan_threads;
+  for (int t = 0; t < kThreadCount; ++t) {
+    scan_threads.emplace_back([&, t]() {
+      for (int i = 0; i < kPeripheralsPerThread; ++i) {
+        api::ble_v2::BleAdvertisementData advertisement_data{};
+        advertisement_data.service_data.insert(
+            {bleutils::kCopresenceServiceUuid,
+             CreateBleAdvertisementHeader(GenerateRandomAdvertisementHash(),
+                                          service_ids)});
+        ByteArray advertisement_bytes = CreateBleAdvertisement(
+            std::string(kServiceIdA),
+            ByteArray(absl::StrCat("data", t, "_", i)),
+            ByteArray(std::string(kDeviceToken)));
+        discovered_peripheral_tracker_.ProcessFoundBleAdvertisement(
+            CreateBlePeripheral(), advertisement_data,
+            [advertisement_bytes](
+                BleV2Peripheral peripheral, int num_slots, int psm,
+                const std::vector<std::string>& interesting_service_ids,
+                mediums::AdvertisementReadResult& advertisement_read_result) {
+              advertisement_read_result.AddAdvertisement(0,
+                                                         advertisement_bytes);
+              advertisement_read_result.RecordLastReadStatus(
+                  /*is_success=*/true);
+            });
+      }
+    });
+  }
+  std::thread lost_thread([&]() {
+    while (scanning) {
+      discovered_peripheral_tracker_.ProcessLostGattAdvertisements();
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+  });
+
+  for (std::thread& thread : scan_threads) thread.join();
+  EXPECT_TRUE(found_latch.Await(kWaitDuration * 5).result());
+  scanning = false;
+  lost_thread.join();
+}
+
 INSTANTIATE_TEST_SUITE_P(DiscoveredPeripheralTrackerFlagsTest,
                          DiscoveredPeripheralTrackerTest,
                          /*kEnableGattQueryInThread=*/testing::Bool());
@@ -15,9 +15,9 @@
 #include "connections/implementation/mediums/multiplex/multiplex_output_stream.h"
 
 #include <memory>
-#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -218,9 +218,11 @@ void MultiplexOutputStream::MultiplexWriter::EnqueueToSend(
 void MultiplexOutputStream::MultiplexWriter::StartWriting() {
   NEARBY_LOGS(INFO) << "Writing loop started.";
   while (true) {
-    auto enqueued_frame = data_queue_.TryTake();
-    if (enqueued_frame != std::nullopt) {
-      Write(enqueued_frame.value());
+    std::vector<EnqueuedFrame> enqueued_frames = data_queue_.TakeAll();
+    if (!enqueued_frames.empty()) {
+      for (EnqueuedFrame& enqueued_frame : enqueued_frames) {
+        Write(enqueued_frame);
+      }
       continue;
     }
     {
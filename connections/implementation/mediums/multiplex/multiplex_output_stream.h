@@ -17,6 +17,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
@@ -104,7 +105,7 @@ class MultiplexOutputStream {
   class EnqueuedFrame {
    public:
     EnqueuedFrame(Future<bool>* future, ByteArray data)
-        : future_(future), data_(data) {}
+        : future_(future), data_(std::move(data)) {}
     ~EnqueuedFrame() = default;
 
     Future<bool>* future_;
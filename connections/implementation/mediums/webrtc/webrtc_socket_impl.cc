@@ -69,7 +69,9 @@ WebRtcSocket::WebRtcSocket(
     : name_(name), data_channel_(std::move(data_channel)) {
   NEARBY_LOGS(INFO) << "WebRtcSocket::WebRtcSocket(" << name_
                     << ") this: " << this;
-  std::tie(pipe_input_, pipe_output_) = CreatePipe();
+  // Written by OnMessage() on the single offload thread, which must not block
+  // until the socket is read.
+  std::tie(pipe_input_, pipe_output_) = CreatePipe(kUnboundedPipeCapacity);
   data_channel_->RegisterObserver(this);
 }
 
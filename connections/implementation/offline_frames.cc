@@ -14,11 +14,17 @@
 
 #include "connections/implementation/offline_frames.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "connections/connection_options.h"
 #include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/internal_payload.h"
@@ -56,20 +62,309 @@ ByteArray ToBytes(OfflineFrame&& frame) {
   return bytes;
 }
 
+// DATA frames carry almost all the bytes of a connection, so they are written
+// and read directly in the protobuf wire format, instead of going through an
+// OfflineFrame, which copies the chunk body in and out of the message.
+constexpr int kWireTypeVarint = 0;
+constexpr int kWireTypeLengthDelimited = 2;
+// A varint holds 7 bits per byte.
+constexpr int kMaxVarintSize = 10;
+constexpr int kMaxVarint32Size = 5;
+
+// Field numbers, see offline_wire_formats.proto.
+constexpr int kOfflineFrameVersionField = 1;
+constexpr int kOfflineFrameV1Field = 2;
+constexpr int kV1FrameTypeField = 1;
+constexpr int kV1FramePayloadTransferField = 4;
+constexpr int kPayloadTransferPacketTypeField = 1;
+constexpr int kPayloadTransferHeaderField = 2;
+constexpr int kPayloadTransferChunkField = 3;
+constexpr int kPayloadChunkFlagsField = 1;
+constexpr int kPayloadChunkOffsetField = 2;
+constexpr int kPayloadChunkBodyField = 3;
+constexpr int kPayloadChunkIndexField = 4;
+
+size_t VarintSize(std::uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+// Negative int32 fields are sign-extended to 64 bits on the wire.
+std::uint64_t Int32ToVarint(std::int32_t value) {
+  return static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+}
+
+size_t TagSize(int field_number) {
+  return VarintSize(static_cast<std::uint64_t>(field_number) << 3);
+}
+
+size_t VarintFieldSize(int field_number, std::uint64_t value) {
+  return TagSize(field_number) + VarintSize(value);
+}
+
+size_t LengthDelimitedFieldSize(int field_number, size_t length) {
+  return TagSize(field_number) + VarintSize(length) + length;
+}
+
+char* WriteVarint(std::uint64_t value, char* out) {
+  while (value >= 0x80) {
+    *out++ = static_cast<char>(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = static_cast<char>(value);
+  return out;
+}
+
+char* WriteTag(int field_number, int wire_type, char* out) {
+  return WriteVarint(
+      (static_cast<std::uint64_t>(field_number) << 3) | wire_type, out);
+}
+
+char* WriteVarintField(int field_number, std::uint64_t value, char* out) {
+  return WriteVarint(value, WriteTag(field_number, kWireTypeVarint, out));
+}
+
+char* WriteLengthHeader(int field_number, size_t length, char* out) {
+  return WriteVarint(length,
+                     WriteTag(field_number, kWireTypeLengthDelimited, out));
+}
+
+// The fields of a PayloadChunk, if set.
+struct DataChunkFields {
+  std::optional<std::int32_t> flags;
+  std::optional<std::int64_t> offset;
+  std::optional<absl::string_view> body;
+  std::optional<std::int32_t> index;
+};
+
+size_t DataChunkSize(const DataChunkFields& chunk) {
+  size_t size = 0;
+  if (chunk.flags.has_value()) {
+    size += VarintFieldSize(kPayloadChunkFlagsField,
+                            Int32ToVarint(*chunk.flags));
+  }
+  if (chunk.offset.has_value()) {
+    size += VarintFieldSize(kPayloadChunkOffsetField, *chunk.offset);
+  }
+  if (chunk.body.has_value()) {
+    size += LengthDelimitedFieldSize(kPayloadChunkBodyField, chunk.body->size());
+  }
+  if (chunk.index.has_value()) {
+    size += VarintFieldSize(kPayloadChunkIndexField,
+                            Int32ToVarint(*chunk.index));
+  }
+  return size;
+}
+
+// Writes the same bytes as ToBytes() does for the OfflineFrame built by
+// ForDataPayloadTransfer(), with the fields in field number order.
+ByteArray WriteDataPayloadTransfer(
+    const PayloadTransferFrame::PayloadHeader& header,
+    const DataChunkFields& chunk, size_t chunk_size) {
+  size_t header_size = header.ByteSizeLong();
+  size_t transfer_size =
+      VarintFieldSize(kPayloadTransferPacketTypeField,
+                      PayloadTransferFrame::DATA) +
+      LengthDelimitedFieldSize(kPayloadTransferHeaderField, header_size) +
+      LengthDelimitedFieldSize(kPayloadTransferChunkField, chunk_size);
+  size_t v1_size =
+      VarintFieldSize(kV1FrameTypeField, V1Frame::PAYLOAD_TRANSFER) +
+      LengthDelimitedFieldSize(kV1FramePayloadTransferField, transfer_size);
+  size_t frame_size =
+      VarintFieldSize(kOfflineFrameVersionField, OfflineFrame::V1) +
+      LengthDelimitedFieldSize(kOfflineFrameV1Field, v1_size);
+
+  ByteArray bytes(frame_size);
+  char* out = bytes.data();
+  out = WriteVarintField(kOfflineFrameVersionField, OfflineFrame::V1, out);
+  out = WriteLengthHeader(kOfflineFrameV1Field, v1_size, out);
+  out = WriteVarintField(kV1FrameTypeField, V1Frame::PAYLOAD_TRANSFER, out);
+  out = WriteLengthHeader(kV1FramePayloadTransferField, transfer_size, out);
+  out = WriteVarintField(kPayloadTransferPacketTypeField,
+                         PayloadTransferFrame::DATA, out);
+  out = WriteLengthHeader(kPayloadTransferHeaderField, header_size, out);
+  // ByteSizeLong() cached the sizes of the header.
+  out = reinterpret_cast<char*>(header.SerializeWithCachedSizesToArray(
+      reinterpret_cast<std::uint8_t*>(out)));
+  out = WriteLengthHeader(kPayloadTransferChunkField, chunk_size, out);
+  if (chunk.flags.has_value()) {
+    out = WriteVarintField(kPayloadChunkFlagsField,
+                           Int32ToVarint(*chunk.flags), out);
+  }
+  if (chunk.offset.has_value()) {
+    out = WriteVarintField(kPayloadChunkOffsetField, *chunk.offset, out);
+  }
+  if (chunk.body.has_value()) {
+    out = WriteLengthHeader(kPayloadChunkBodyField, chunk.body->size(), out);
+    out = std::copy(chunk.body->begin(), chunk.body->end(), out);
+  }
+  if (chunk.index.has_value()) {
+    out = WriteVarintField(kPayloadChunkIndexField,
+                           Int32ToVarint(*chunk.index), out);
+  }
+  return bytes;
+}
+
+// A field expected in a message, and its value once read.
+struct WireField {
+  int number;
+  int wire_type;
+  bool present = false;
+  std::uint64_t varint = 0;
+  absl::string_view bytes;
+};
+
+bool ReadVarint(absl::string_view& data, int max_size, std::uint64_t& value) {
+  value = 0;
+  for (int i = 0; i < max_size && i < data.size(); ++i) {
+    std::uint64_t byte = static_cast<std::uint8_t>(data[i]);
+    if (i == kMaxVarintSize - 1 && byte > 1) {
+      // More than 64 bits.
+      return false;
+    }
+    value |= (byte & 0x7f) << (7 * i);
+    if (byte < 0x80) {
+      data.remove_prefix(i + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reads the fields of a message, which must all be in `fields`, and appear at
+// most once. Returns false otherwise, or if the message is malformed.
+bool ReadWireFields(absl::string_view message,
+                    absl::Span<WireField> fields) {
+  while (!message.empty()) {
+    // All the fields we read have single byte tags.
+    std::uint8_t tag = static_cast<std::uint8_t>(message.front());
+    if (tag >= 0x80) {
+      return false;
+    }
+    message.remove_prefix(1);
+    auto field = std::find_if(fields.begin(), fields.end(),
+                              [tag](const WireField& field) {
+                                return field.number == (tag >> 3) &&
+                                       field.wire_type == (tag & 0x7);
+                              });
+    if (field == fields.end() || field->present) {
+      return false;
+    }
+    field->present = true;
+    if (field->wire_type == kWireTypeVarint) {
+      if (!ReadVarint(message, kMaxVarintSize, field->varint)) {
+        return false;
+      }
+    } else {
+      std::uint64_t length;
+      if (!ReadVarint(message, kMaxVarint32Size, length) ||
+          length > std::numeric_limits<std::int32_t>::max() ||
+          length > message.size()) {
+        return false;
+      }
+      field->bytes = message.substr(0, length);
+      message.remove_prefix(length);
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
+std::optional<DataPayloadTransferView> ParseDataPayloadTransfer(
+    absl::string_view bytes) {
+  WireField frame_fields[] = {
+      {kOfflineFrameVersionField, kWireTypeVarint},
+      {kOfflineFrameV1Field, kWireTypeLengthDelimited},
+  };
+  if (!ReadWireFields(bytes, absl::MakeSpan(frame_fields)) ||
+      !frame_fields[0].present || frame_fields[0].varint != OfflineFrame::V1 ||
+      !frame_fields[1].present) {
+    return std::nullopt;
+  }
+  WireField v1_fields[] = {
+      {kV1FrameTypeField, kWireTypeVarint},
+      {kV1FramePayloadTransferField, kWireTypeLengthDelimited},
+  };
+  if (!ReadWireFields(frame_fields[1].bytes, absl::MakeSpan(v1_fields)) ||
+      !v1_fields[0].present ||
+      v1_fields[0].varint != V1Frame::PAYLOAD_TRANSFER ||
+      !v1_fields[1].present) {
+    return std::nullopt;
+  }
+  WireField transfer_fields[] = {
+      {kPayloadTransferPacketTypeField, kWireTypeVarint},
+      {kPayloadTransferHeaderField, kWireTypeLengthDelimited},
+      {kPayloadTransferChunkField, kWireTypeLengthDelimited},
+  };
+  if (!ReadWireFields(v1_fields[1].bytes, absl::MakeSpan(transfer_fields)) ||
+      !transfer_fields[0].present ||
+      transfer_fields[0].varint != PayloadTransferFrame::DATA ||
+      !transfer_fields[1].present || !transfer_fields[2].present) {
+    return std::nullopt;
+  }
+  WireField chunk_fields[] = {
+      {kPayloadChunkFlagsField, kWireTypeVarint},
+      {kPayloadChunkOffsetField, kWireTypeVarint},
+      {kPayloadChunkBodyField, kWireTypeLengthDelimited},
+      {kPayloadChunkIndexField, kWireTypeVarint},
+  };
+  if (!ReadWireFields(transfer_fields[2].bytes, absl::MakeSpan(chunk_fields))) {
+    return std::nullopt;
+  }
+
+  DataPayloadTransferView view;
+  // The header is small, and has fields we don't want to decode by hand.
+  if (!view.header.ParseFromArray(transfer_fields[1].bytes.data(),
+                                  transfer_fields[1].bytes.size())) {
+    return std::nullopt;
+  }
+  // Like protobuf, keep the low 32 bits of int32 fields.
+  if (chunk_fields[0].present) {
+    view.chunk.set_flags(static_cast<std::int32_t>(chunk_fields[0].varint));
+  }
+  if (chunk_fields[1].present) {
+    view.chunk.set_offset(static_cast<std::int64_t>(chunk_fields[1].varint));
+  }
+  if (chunk_fields[2].present) {
+    view.body = chunk_fields[2].bytes;
+  }
+  if (chunk_fields[3].present) {
+    view.chunk.set_index(static_cast<std::int32_t>(chunk_fields[3].varint));
+  }
+  return view;
+}
+
 ExceptionOrOfflineFrame FromBytes(const ByteArray& bytes) {
   OfflineFrame frame;
 
-  if (frame.ParseFromString(std::string(bytes))) {
-    Exception validation_exception = EnsureValidOfflineFrame(frame);
-    if (validation_exception.Raised()) {
-      return ExceptionOrOfflineFrame(validation_exception);
+  std::optional<DataPayloadTransferView> data =
+      ParseDataPayloadTransfer(bytes.AsStringView());
+  if (data.has_value()) {
+    frame.set_version(OfflineFrame::V1);
+    auto* v1_frame = frame.mutable_v1();
+    v1_frame->set_type(V1Frame::PAYLOAD_TRANSFER);
+    auto* sub_frame = v1_frame->mutable_payload_transfer();
+    sub_frame->set_packet_type(PayloadTransferFrame::DATA);
+    *sub_frame->mutable_payload_header() = std::move(data->header);
+    auto* chunk = sub_frame->mutable_payload_chunk();
+    *chunk = std::move(data->chunk);
+    if (data->body.has_value()) {
+      chunk->set_body(std::string(*data->body));
     }
-    return ExceptionOrOfflineFrame(std::move(frame));
-  } else {
+  } else if (!frame.ParseFromArray(bytes.data(), bytes.size())) {
     return ExceptionOrOfflineFrame(Exception::kInvalidProtocolBuffer);
   }
+
+  Exception validation_exception = EnsureValidOfflineFrame(frame);
+  if (validation_exception.Raised()) {
+    return ExceptionOrOfflineFrame(validation_exception);
+  }
+  return ExceptionOrOfflineFrame(std::move(frame));
 }
 
 V1Frame::FrameType GetFrameType(const OfflineFrame& frame) {
@@ -209,6 +504,17 @@ ByteArray ForConnectionResponse(std::int32_t status, const OsInfo& os_info,
 ByteArray ForDataPayloadTransfer(
     const PayloadTransferFrame::PayloadHeader& header,
     const PayloadTransferFrame::PayloadChunk& chunk) {
+  DataChunkFields fields;
+  if (chunk.has_flags()) fields.flags = chunk.flags();
+  if (chunk.has_offset()) fields.offset = chunk.offset();
+  if (chunk.has_body()) fields.body = chunk.body();
+  if (chunk.has_index()) fields.index = chunk.index();
+  size_t chunk_size = DataChunkSize(fields);
+  if (chunk_size == chunk.ByteSizeLong()) {
+    return WriteDataPayloadTransfer(header, fields, chunk_size);
+  }
+
+  // The chunk has unknown fields, let protobuf write them.
   OfflineFrame frame;
 
   frame.set_version(OfflineFrame::V1);
@@ -222,6 +528,14 @@ ByteArray ForDataPayloadTransfer(
   return ToBytes(std::move(frame));
 }
 
+ByteArray ForDataPayloadTransfer(
+    const PayloadTransferFrame::PayloadHeader& header, std::int32_t flags,
+    std::int64_t offset, std::int32_t index, absl::string_view body) {
+  DataChunkFields fields = {
+      .flags = flags, .offset = offset, .body = body, .index = index};
+  return WriteDataPayloadTransfer(header, fields, DataChunkSize(fields));
+}
+
 ByteArray ForControlPayloadTransfer(
     const PayloadTransferFrame::PayloadHeader& header,
     const PayloadTransferFrame::ControlMessage& control) {
@@ -16,9 +16,11 @@
 #define CORE_INTERNAL_OFFLINE_FRAMES_H_
 
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "connections/connection_options.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/medium_selector.h"
@@ -40,6 +42,23 @@ using UpgradePathInfo = ::location::nearby::connections::
 ExceptionOr<location::nearby::connections::OfflineFrame> FromBytes(
     const ByteArray& offline_frame_bytes);
 
+// A PAYLOAD_TRANSFER/DATA frame, whose body points into the bytes it was
+// parsed from.
+struct DataPayloadTransferView {
+  location::nearby::connections::PayloadTransferFrame::PayloadHeader header;
+  // The chunk fields, except for the body.
+  location::nearby::connections::PayloadTransferFrame::PayloadChunk chunk;
+  // std::nullopt if the chunk has no body.
+  std::optional<absl::string_view> body;
+};
+
+// Parses a DATA frame without going through OfflineFrame, and without copying
+// its body. Returns std::nullopt if `offline_frame_bytes` is not a DATA frame
+// as written by ForDataPayloadTransfer(), e.g. if it has unknown fields, in
+// which case FromBytes() has the final say. The frame is not validated.
+std::optional<DataPayloadTransferView> ParseDataPayloadTransfer(
+    absl::string_view offline_frame_bytes);
+
 // Returns FrameType of a parsed message, or
 // V1Frame::UNKNOWN_FRAME_TYPE, if frame contents is not recognized.
 location::nearby::connections::V1Frame::FrameType GetFrameType(
@@ -63,6 +82,13 @@ ByteArray ForDataPayloadTransfer(
         header,
     const location::nearby::connections::PayloadTransferFrame::PayloadChunk&
         chunk);
+// Same as above, for a chunk with all of `flags`, `offset`, `index` and
+// `body` set. `body` is copied straight into the frame.
+ByteArray ForDataPayloadTransfer(
+    const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
+        header,
+    std::int32_t flags, std::int64_t offset, std::int32_t index,
+    absl::string_view body);
 ByteArray ForControlPayloadTransfer(
     const location::nearby::connections::PayloadTransferFrame::PayloadHeader&
         header,
@@ -16,6 +16,7 @@
 
 #include <array>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -361,6 +362,117 @@ TEST(OfflineFramesTest, CanGenerateDataPayloadTransfer) {
   EXPECT_THAT(message, EqualsProto(kExpected));
 }
 
+// What ForDataPayloadTransfer() wrote before it skipped OfflineFrame.
+std::string SerializeDataPayloadTransfer(
+    const PayloadTransferFrame::PayloadHeader& header,
+    const PayloadTransferFrame::PayloadChunk& chunk) {
+  OfflineFrame frame;
+  frame.set_version(OfflineFrame::V1);
+  frame.mutable_v1()->set_type(V1Frame::PAYLOAD_TRANSFER);
+  auto* sub_frame = frame.mutable_v1()->mutable_payload_transfer();
+  sub_frame->set_packet_type(PayloadTransferFrame::DATA);
+  *sub_frame->mutable_payload_header() = header;
+  *sub_frame->mutable_payload_chunk() = chunk;
+  return frame.SerializeAsString();
+}
+
+TEST(OfflineFramesTest, DataPayloadTransferMatchesProtobufEncoding) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(-12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::FILE);
+  header.set_total_size(1LL << 40);
+  header.set_file_name("file.txt");
+  std::vector<PayloadTransferFrame::PayloadChunk> chunks(5);
+  chunks[1].set_body("");
+  chunks[2].set_flags(PayloadTransferFrame::PayloadChunk::LAST_CHUNK);
+  chunks[2].set_offset(0);
+  chunks[2].set_index(7);
+  chunks[3].set_flags(-1);
+  chunks[3].set_offset(-1);
+  chunks[3].set_body(std::string(300, 'a'));
+  chunks[3].set_index(-2);
+  chunks[4].set_offset(1LL << 40);
+  chunks[4].set_body(std::string(100000, 'b'));
+
+  for (const PayloadTransferFrame::PayloadChunk& chunk : chunks) {
+    ByteArray bytes = ForDataPayloadTransfer(header, chunk);
+    EXPECT_EQ(std::string(bytes), SerializeDataPayloadTransfer(header, chunk));
+  }
+}
+
+TEST(OfflineFramesTest, DataPayloadTransferWithBodyViewMatchesChunk) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_flags(0);
+  chunk.set_offset(150);
+  chunk.set_body("payload data");
+  chunk.set_index(3);
+
+  ByteArray bytes = ForDataPayloadTransfer(header, /*flags=*/0, /*offset=*/150,
+                                           /*index=*/3, "payload data");
+
+  EXPECT_EQ(std::string(bytes), SerializeDataPayloadTransfer(header, chunk));
+}
+
+TEST(OfflineFramesTest, ParseDataPayloadTransferReturnsBodyView) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(1024);
+  ByteArray bytes = ForDataPayloadTransfer(header, /*flags=*/1, /*offset=*/150,
+                                           /*index=*/2, "payload data");
+
+  std::optional<DataPayloadTransferView> view =
+      ParseDataPayloadTransfer(bytes.AsStringView());
+
+  ASSERT_TRUE(view.has_value());
+  EXPECT_THAT(view->header,
+              EqualsProto(R"pb(id: 12345 type: BYTES total_size: 1024)pb"));
+  EXPECT_THAT(view->chunk, EqualsProto(R"pb(flags: 1 offset: 150 index: 2)pb"));
+  ASSERT_TRUE(view->body.has_value());
+  EXPECT_EQ(*view->body, "payload data");
+  // The body is not copied.
+  EXPECT_GE(view->body->data(), bytes.data());
+  EXPECT_LE(view->body->data() + view->body->size(),
+            bytes.data() + bytes.size());
+}
+
+TEST(OfflineFramesTest, ParseDataPayloadTransferLeavesOtherFramesToProtobuf) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  PayloadTransferFrame::ControlMessage control;
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  ByteArray control_bytes = ForControlPayloadTransfer(header, control);
+  // A DATA frame with a field this version doesn't know about.
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_body("payload data");
+  std::string data_bytes = SerializeDataPayloadTransfer(header, chunk);
+  data_bytes.append("\x78\x01");
+
+  EXPECT_FALSE(
+      ParseDataPayloadTransfer(control_bytes.AsStringView()).has_value());
+  EXPECT_TRUE(FromBytes(control_bytes).ok());
+  EXPECT_FALSE(ParseDataPayloadTransfer(data_bytes).has_value());
+  auto response = FromBytes(ByteArray(data_bytes));
+  ASSERT_TRUE(response.ok());
+  EXPECT_EQ(response.result().v1().payload_transfer().payload_chunk().body(),
+            "payload data");
+}
+
+TEST(OfflineFramesTest, ParseDataPayloadTransferRejectsTruncatedFrame) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  ByteArray bytes = ForDataPayloadTransfer(header, /*flags=*/0, /*offset=*/0,
+                                           /*index=*/0, "payload data");
+
+  for (size_t size = 0; size < bytes.size(); ++size) {
+    EXPECT_FALSE(
+        ParseDataPayloadTransfer(bytes.AsStringView().substr(0, size))
+            .has_value());
+  }
+}
+
 TEST(OfflineFramesTest, CanGeneratePayloadAckPayloadTransfer) {
   constexpr absl::string_view kExpected =
       R"pb(
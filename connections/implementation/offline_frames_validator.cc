@@ -15,9 +15,11 @@
 #include "connections/implementation/offline_frames_validator.h"
 
 #include <cstddef>
-#include <regex>  //NOLINT
-#include <string>
 
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
 #include "connections/implementation/internal_payload.h"
 #include "connections/implementation/offline_frames.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
@@ -48,20 +50,16 @@ using ::location::nearby::connections::ConnectionResponseFrame;
 using ::location::nearby::connections::PayloadTransferFrame;
 using ::location::nearby::connections::V1Frame;
 
-constexpr absl::string_view kIpv4PatternString{
-    "^([01]?\\d\\d?|2[0-4]\\d|25[0-5])\\."
-    "([01]?\\d\\d?|2[0-4]\\d|25[0-5])\\."
-    "([01]?\\d\\d?|2[0-4]\\d|25[0-5])\\."
-    "([01]?\\d\\d?|2[0-4]\\d|25[0-5])$"};
-constexpr absl::string_view kIpv6PatternString{
-    "^([01]?\\d\\d?|2[0-4]\\d|25[0-5])\\."
-    "([01]?\\d\\d?|2[0-4]\\d|25[0-5])\\."
-    "([01]?\\d\\d?|2[0-4]\\d|25[0-5])\\."
-    "([01]?\\d\\d?|2[0-4]\\d|25[0-5])\\."
-    "([01]?\\d\\d?|2[0-4]\\d|25[0-5])\\."
-    "([01]?\\d\\d?|2[0-4]\\d|25[0-5])$"};
-constexpr absl::string_view kWifiDirectSsidPatternString{
-    "^DIRECT-[a-zA-Z0-9]{2}.*$"};
+// The gateway is a dotted list of decimal octets: four of them for IPv4, or
+// six for what the sender calls IPv6. The SSID of a Wi-Fi Direct group is
+// "DIRECT-" followed by two alphanumeric characters.
+//
+// These are matched by hand rather than with std::regex, which is expensive
+// to build and to run, since the validation runs on the endpoint reader thread.
+constexpr int kIpv4OctetCount = 4;
+constexpr int kIpv6OctetCount = 6;
+constexpr absl::string_view kWifiDirectSsidPrefix{"DIRECT-"};
+constexpr int kWifiDirectSsidRandomLength = 2;
 constexpr int kWifiDirectSsidMaxLength = 32;
 constexpr int kWifiPasswordSsidMinLength = 8;
 constexpr int kWifiPasswordSsidMaxLength = 64;
@@ -70,6 +68,45 @@ inline bool WithinRange(int value, int min, int max) {
   return value >= min && value < max;
 }
 
+// Matches one to three decimal digits with a value of at most 255. Leading
+// zeros are allowed.
+bool ConsumeOctet(absl::string_view& input) {
+  int value = 0;
+  size_t digits = 0;
+  while (digits < 3 && digits < input.size() &&
+         absl::ascii_isdigit(input[digits])) {
+    value = value * 10 + (input[digits] - '0');
+    ++digits;
+  }
+  if (digits == 0 || value > 255) return false;
+  input.remove_prefix(digits);
+  return true;
+}
+
+bool IsDottedOctets(absl::string_view input, int octet_count) {
+  for (int i = 0; i < octet_count; ++i) {
+    if (i > 0 && !absl::ConsumePrefix(&input, ".")) return false;
+    if (!ConsumeOctet(input)) return false;
+  }
+  return input.empty();
+}
+
+bool IsValidGateway(absl::string_view gateway) {
+  return IsDottedOctets(gateway, kIpv4OctetCount) ||
+         IsDottedOctets(gateway, kIpv6OctetCount);
+}
+
+bool IsValidWifiDirectSsid(absl::string_view ssid) {
+  if (ssid.length() >= kWifiDirectSsidMaxLength) return false;
+  if (!absl::ConsumePrefix(&ssid, kWifiDirectSsidPrefix)) return false;
+  if (ssid.length() < kWifiDirectSsidRandomLength) return false;
+  for (int i = 0; i < kWifiDirectSsidRandomLength; ++i) {
+    if (!absl::ascii_isalnum(ssid[i])) return false;
+  }
+  // The rest can be anything but a line break.
+  return ssid.find_first_of("\r\n") == absl::string_view::npos;
+}
+
 Exception EnsureValidConnectionRequestFrame(
     const ConnectionRequestFrame& frame) {
   if (frame.endpoint_id().empty()) return {Exception::kInvalidProtocolBuffer};
@@ -135,7 +172,7 @@ Exception EnsureValidPayloadTransferControlFrame(
   return {Exception::kSuccess};
 }
 
-bool CheckForIllegalCharacters(std::string toBeValidated,
+bool CheckForIllegalCharacters(absl::string_view toBeValidated,
                                const absl::string_view illegalPatterns[],
                                size_t illegalPatternsSize) {
   if (toBeValidated.empty()) {
@@ -144,11 +181,8 @@ bool CheckForIllegalCharacters(std::string toBeValidated,
 
   CHECK_GT(illegalPatternsSize, 0);
 
-  size_t found = 0;
   for (int index = 0; index < illegalPatternsSize; index++) {
-    found = toBeValidated.find(std::string(illegalPatterns[index]));
-
-    if (found != std::string::npos) {
+    if (absl::StrContains(toBeValidated, illegalPatterns[index])) {
       // TODO(jfcarroll): Find a way to issue a log statement here.
       // Currently, this breaks the fuzzer, as a logging dep is not
       // included for it in the BUILD file.
@@ -241,10 +275,7 @@ Exception EnsureValidBandwidthUpgradeWifiHotspotPathAvailableFrame(
     return {Exception::kInvalidProtocolBuffer};
   if (!wifi_hotspot_credentials.has_gateway())
     return {Exception::kInvalidProtocolBuffer};
-  const std::regex ip4_pattern(std::string(kIpv4PatternString).c_str());
-  const std::regex ip6_pattern(std::string(kIpv6PatternString).c_str());
-  if (!(std::regex_match(wifi_hotspot_credentials.gateway(), ip4_pattern) ||
-        std::regex_match(wifi_hotspot_credentials.gateway(), ip6_pattern)))
+  if (!IsValidGateway(wifi_hotspot_credentials.gateway()))
     return {Exception::kInvalidProtocolBuffer};
 
   // For backwards compatibility reasons, no other fields should be null-checked
@@ -278,11 +309,8 @@ Exception EnsureValidBandwidthUpgradeWifiAwarePathAvailableFrame(
 
 Exception EnsureValidBandwidthUpgradeWifiDirectPathAvailableFrame(
     const WifiDirectCredentials& wifi_direct_credentials) {
-  const std::regex ssid_pattern(
-      std::string(kWifiDirectSsidPatternString).c_str());
   if (!wifi_direct_credentials.has_ssid() ||
-      !(wifi_direct_credentials.ssid().length() < kWifiDirectSsidMaxLength &&
-        std::regex_match(wifi_direct_credentials.ssid(), ssid_pattern)))
+      !IsValidWifiDirectSsid(wifi_direct_credentials.ssid()))
     return {Exception::kInvalidProtocolBuffer};
 
   if (!wifi_direct_credentials.has_password() ||
@@ -0,0 +1,157 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks EnsureValidOfflineFrame() on a valid frame of every type the
+// endpoint reader thread validates, one benchmark per frame.
+//
+// Run with
+//   bazel run -c opt \
+//     //connections/implementation:offline_frames_validator_benchmark
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "connections/connection_options.h"
+#include "connections/implementation/offline_frames.h"
+#include "connections/implementation/offline_frames_validator.h"
+#include "connections/implementation/proto/offline_wire_formats.pb.h"
+#include "connections/medium_selector.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+
+namespace nearby {
+namespace connections {
+namespace parser {
+namespace {
+
+using ::location::nearby::connections::LocationHint;
+using ::location::nearby::connections::MediumRole;
+using ::location::nearby::connections::OfflineFrame;
+using ::location::nearby::connections::OsInfo;
+using ::location::nearby::connections::PayloadTransferFrame;
+
+struct CorpusFrame {
+  std::string name;
+  OfflineFrame frame;
+};
+
+std::vector<CorpusFrame> BuildCorpus() {
+  ConnectionInfo connection_info{
+      .local_endpoint_id = "ABCD",
+      .local_endpoint_info = ByteArray(std::string("XYZ")),
+      .nonce = 1234,
+      .supports_5_ghz = true,
+      .bssid = "FF:FF:FF:FF:FF:FF",
+      .ap_frequency = 2412,
+      .ip_address = "8xqT",
+      .supported_mediums = {Medium::BLUETOOTH, Medium::WIFI_HOTSPOT,
+                            Medium::BLE, Medium::WIFI_LAN,
+                            Medium::WIFI_DIRECT, Medium::WEB_RTC},
+      .keep_alive_interval_millis = 1000,
+      .keep_alive_timeout_millis = 5000,
+  };
+
+  PayloadTransferFrame::PayloadHeader bytes_header;
+  bytes_header.set_id(12345);
+  bytes_header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  bytes_header.set_total_size(1024);
+  PayloadTransferFrame::PayloadHeader file_header;
+  file_header.set_id(12346);
+  file_header.set_type(PayloadTransferFrame::PayloadHeader::FILE);
+  file_header.set_total_size(1024 * 1024);
+  file_header.set_file_name("photo.jpg");
+  file_header.set_parent_folder("pictures/holiday");
+  PayloadTransferFrame::ControlMessage control;
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  control.set_offset(512);
+
+  std::vector<std::pair<std::string, ByteArray>> frame_bytes = {
+      {"ConnectionRequest",
+       ForConnectionRequestConnections({}, connection_info)},
+      {"ConnectionResponse",
+       ForConnectionResponse(/*status=*/0, OsInfo(),
+                             /*multiplex_socket_bitmask=*/0)},
+      {"BytesPayload",
+       ForDataPayloadTransfer(bytes_header, /*flags=*/0, /*offset=*/0,
+                              /*index=*/0, std::string(1024, 'a'))},
+      {"FilePayload",
+       ForDataPayloadTransfer(file_header, /*flags=*/0, /*offset=*/0,
+                              /*index=*/0, std::string(64 * 1024, 'a'))},
+      {"PayloadControl", ForControlPayloadTransfer(file_header, control)},
+      {"PayloadAck", ForPayloadAckPayloadTransfer(12345)},
+      {"BwuIntroduction", ForBwuIntroduction("ABCD", true)},
+      {"BwuIntroductionAck", ForBwuIntroductionAck()},
+      {"BwuWifiHotspotPathAvailable",
+       ForBwuWifiHotspotPathAvailable("ssid", "password", 1000, 2412,
+                                      "192.168.1.1", true)},
+      {"BwuWifiLanPathAvailable",
+       ForBwuWifiLanPathAvailable("8xqT", 1000)},
+      {"BwuWifiDirectPathAvailable",
+       ForBwuWifiDirectPathAvailable("DIRECT-A0-0123456789AB",
+                                     "WIFIDIRECT123456", 1000, 2412, true,
+                                     "192.168.1.1")},
+      {"BwuBluetoothPathAvailable",
+       ForBwuBluetoothPathAvailable("service_id", "11:22:33:44:55:66")},
+      {"BwuWebrtcPathAvailable",
+       ForBwuWebrtcPathAvailable("peer_id", LocationHint())},
+      {"BwuPathRequest",
+       ForBwuPathRequest({Medium::WIFI_LAN, Medium::WIFI_HOTSPOT},
+                         MediumRole())},
+      {"BwuLastWrite", ForBwuLastWrite()},
+      {"BwuSafeToClose", ForBwuSafeToClose()},
+      {"KeepAlive", ForKeepAlive(/*ack=*/false, /*seq_num=*/1)},
+      {"Disconnection", ForDisconnection(true, false)},
+      {"AutoReconnectIntroduction", ForAutoReconnectIntroduction("ABCD")},
+      {"AutoReconnectIntroductionAck", ForAutoReconnectIntroductionAck()},
+  };
+
+  std::vector<CorpusFrame> corpus;
+  for (auto& [name, bytes] : frame_bytes) {
+    CorpusFrame corpus_frame{.name = std::move(name)};
+    corpus_frame.frame.ParseFromString(std::string(bytes));
+    corpus.push_back(std::move(corpus_frame));
+  }
+  return corpus;
+}
+
+const std::vector<CorpusFrame>& GetCorpus() {
+  static const std::vector<CorpusFrame>& corpus =
+      *new std::vector<CorpusFrame>(BuildCorpus());
+  return corpus;
+}
+
+void BM_EnsureValidOfflineFrame(benchmark::State& state) {
+  const CorpusFrame& corpus_frame = GetCorpus()[state.range(0)];
+  state.SetLabel(corpus_frame.name);
+  // Only valid frames go through every check.
+  if (!EnsureValidOfflineFrame(corpus_frame.frame).Ok()) {
+    state.SkipWithError("The frame is not valid.");
+    return;
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(EnsureValidOfflineFrame(corpus_frame.frame));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EnsureValidOfflineFrame)
+    ->ArgName("frame")
+    ->DenseRange(0, GetCorpus().size() - 1);
+
+}  // namespace
+}  // namespace parser
+}  // namespace connections
+}  // namespace nearby
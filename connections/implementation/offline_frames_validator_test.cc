@@ -618,6 +618,33 @@ TEST(OfflineFramesValidatorTest,
   EXPECT_FALSE(ret_value.Ok());
 }
 
+TEST(OfflineFramesValidatorTest,
+     ValidatesGatewayInBandwidthUpgradeWifiHotspot) {
+  for (absl::string_view gateway :
+       {"192.168.1.1", "255.255.255.255", "010.0.00.9", "1.2.3.4.5.6"}) {
+    OfflineFrame offline_frame;
+    ByteArray bytes = ForBwuWifiHotspotPathAvailable(
+        std::string(kSsid), std::string(kPassword), kPort, kHotspotFrequency,
+        std::string(gateway), kSupportsDisablingEncryption);
+    offline_frame.ParseFromString(std::string(bytes));
+
+    EXPECT_TRUE(EnsureValidOfflineFrame(offline_frame).Ok()) << gateway;
+  }
+
+  for (absl::string_view gateway :
+       {"", "192.168.1", "192.168.1.256", "192.168.1.1.", "1.2.3.4.5",
+        "1.2.3.4.5.6.7", "192.168.01.0001", "192.168..1", "a.b.c.d",
+        "::1"}) {
+    OfflineFrame offline_frame;
+    ByteArray bytes = ForBwuWifiHotspotPathAvailable(
+        std::string(kSsid), std::string(kPassword), kPort, kHotspotFrequency,
+        std::string(gateway), kSupportsDisablingEncryption);
+    offline_frame.ParseFromString(std::string(bytes));
+
+    EXPECT_FALSE(EnsureValidOfflineFrame(offline_frame).Ok()) << gateway;
+  }
+}
+
 TEST(OfflineFramesValidatorTest, ValidatesAsOkBandwidthUpgradeWifiDirect) {
   OfflineFrame offline_frame;
 
@@ -687,6 +714,31 @@ TEST(OfflineFramesValidatorTest,
   EXPECT_FALSE(ret_value.Ok());
 }
 
+TEST(OfflineFramesValidatorTest, ValidatesSsidInBandwidthUpgradeWifiDirect) {
+  for (absl::string_view ssid : {"DIRECT-a0", "DIRECT-Zz any thing *"}) {
+    OfflineFrame offline_frame;
+    ByteArray bytes = ForBwuWifiDirectPathAvailable(
+        std::string(ssid), std::string(kWifiDirectPassword), kPort,
+        kWifiDirectFrequency, kSupportsDisablingEncryption,
+        std::string(kGateway));
+    offline_frame.ParseFromString(std::string(bytes));
+
+    EXPECT_TRUE(EnsureValidOfflineFrame(offline_frame).Ok()) << ssid;
+  }
+
+  for (absl::string_view ssid :
+       {"", "DIRECT-", "DIRECT-a", "direct-a0", "XDIRECT-a0", "DIRECT-a0\n"}) {
+    OfflineFrame offline_frame;
+    ByteArray bytes = ForBwuWifiDirectPathAvailable(
+        std::string(ssid), std::string(kWifiDirectPassword), kPort,
+        kWifiDirectFrequency, kSupportsDisablingEncryption,
+        std::string(kGateway));
+    offline_frame.ParseFromString(std::string(bytes));
+
+    EXPECT_FALSE(EnsureValidOfflineFrame(offline_frame).Ok()) << ssid;
+  }
+}
+
 TEST(OfflineFramesValidatorTest,
      ValidatesAsFailWithInvalidPasswordInBandwidthUpgradeWifiDirect) {
   OfflineFrame offline_frame_1;
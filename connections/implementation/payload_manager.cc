@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <limits>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -38,6 +39,7 @@
 #include "connections/implementation/flags/nearby_connections_feature_flags.h"
 #include "connections/implementation/internal_payload.h"
 #include "connections/implementation/internal_payload_factory.h"
+#include "connections/implementation/payload_send_scheduler.h"
 #include "connections/implementation/proto/offline_wire_formats.pb.h"
 #include "connections/listeners.h"
 #include "connections/medium_selector.h"
@@ -168,8 +170,39 @@ bool PayloadManager::SendPayloadLoop(
   // happened.
   PayloadTransferFrame::PayloadChunk payload_chunk(CreatePayloadChunk(
       next_chunk_offset - resume_offset, std::move(next_chunk), index));
+  bool is_last_chunk = IsLastChunk(payload_chunk);
+  // Other than the last one, a chunk is completed for each endpoint once it's
+  // actually written to it. That's after SendPayloadChunk() returns if the
+  // chunk is queued behind other writes to the endpoint. The last chunk is
+  // written before it returns, and completed below once acknowledged.
+  EndpointManager::WriteCallback on_write_done;
+  if (!is_last_chunk) {
+    on_write_done = [this, client, payload_header,
+                     payload_chunk_flags = payload_chunk.flags(),
+                     payload_chunk_offset = payload_chunk.offset(),
+                     payload_chunk_body_size = payload_chunk.body().size(),
+                     next_chunk_offset,
+                     guard = write_callback_guard_](
+                        const std::string& endpoint_id, bool succeeded) {
+      MutexLock lock(&guard->mutex);
+      if (guard->is_shutdown) return;
+      if (succeeded) {
+        HandleSuccessfulOutgoingChunk(client, endpoint_id, payload_header,
+                                      payload_chunk_flags, payload_chunk_offset,
+                                      payload_chunk_body_size);
+        return;
+      }
+      LOG(INFO) << "Payload xfer: endpoint failed: payload_id="
+                << payload_header.id() << "; endpoint_id=" << endpoint_id;
+      HandleFinishedOutgoingPayload(
+          client, {endpoint_id}, payload_header, next_chunk_offset,
+          OperationResultCode::CONNECTIVITY_GENERIC_WRITING_CHANNEL_IO_ERROR,
+          PayloadStatus::ENDPOINT_IO_ERROR);
+    };
+  }
   const EndpointIds& failed_endpoint_ids = endpoint_manager_->SendPayloadChunk(
-      payload_header, payload_chunk, available_endpoint_ids, packet_meta_data);
+      payload_header, payload_chunk, available_endpoint_ids, packet_meta_data,
+      on_write_done);
   // Check whether at least one endpoint failed.
   if (!failed_endpoint_ids.empty()) {
     LOG(INFO) << "Payload xfer: endpoints failed: payload_id="
@@ -180,13 +213,13 @@ bool PayloadManager::SendPayloadLoop(
             OperationResultCode::CONNECTIVITY_GENERIC_WRITING_CHANNEL_IO_ERROR,
             PayloadStatus::ENDPOINT_IO_ERROR);
   }
-  bool is_last_chunk = IsLastChunk(payload_chunk);
   // Check whether at least one endpoint succeeded -- if they all failed,
   // we'll just go right back to the top of the loop and break out when
   // availableEndpointIds is re-synced and found to be empty at that point.
   if (failed_endpoint_ids.size() < available_endpoint_ids.size()) {
     for (const auto& endpoint_id : available_endpoint_ids) {
-      if (std::find(failed_endpoint_ids.begin(), failed_endpoint_ids.end(),
+      if (is_last_chunk &&
+          std::find(failed_endpoint_ids.begin(), failed_endpoint_ids.end(),
                     endpoint_id) == failed_endpoint_ids.end()) {
         if (!WaitForReceivedAck(client, endpoint_id, pending_payload,
                                 payload_header, next_chunk_offset,
@@ -368,9 +401,13 @@ PayloadManager::~PayloadManager() {
   DisconnectFromEndpointManager();
   CancelAllPayloads();
   LOG(INFO) << "PayloadManager: turn down payload executors; self=" << this;
-  bytes_payload_executor_.Shutdown();
+  send_scheduler_.Shutdown();
+  {
+    // Chunks still queued in the EndpointManager are not reported anymore.
+    MutexLock lock(&write_callback_guard_->mutex);
+    write_callback_guard_->is_shutdown = true;
+  }
   stream_payload_executor_.Shutdown();
-  file_payload_executor_.Shutdown();
   send_payload_ack_executor_.Shutdown();
 
   CountDownLatch stop_latch(1);
@@ -422,11 +459,13 @@ void PayloadManager::SendPayload(ClientProxy* client,
       break;
   }
 
-  auto executor = GetOutgoingPayloadExecutor(payload.GetType());
-  // The |executor| will be null if the payload is of a type we cannot work
-  // with. This should never be reached since the ServiceControllerRouter has
-  // already checked whether or not we can work with this Payload type.
-  if (!executor) {
+  // This should never be reached for other payload types since the
+  // ServiceControllerRouter has already checked whether or not we can work with
+  // this Payload type.
+  PayloadType payload_type = payload.GetType();
+  if (payload_type != PayloadType::kBytes &&
+      payload_type != PayloadType::kFile &&
+      payload_type != PayloadType::kStream) {
     RecordInvalidPayloadAnalytics(
         client, endpoint_ids, payload.GetId(), payload.GetType(),
         payload.GetOffset(), payload_total_size,
@@ -438,11 +477,6 @@ void PayloadManager::SendPayload(ClientProxy* client,
     return;
   }
 
-  // Each payload is sent in FCFS order within each Payload type, blocking any
-  // other payload of the same type from even starting until this one is
-  // completely done with. If we ever want to provide isolation across
-  // ClientProxy objects this will need to be significantly re-architected.
-  PayloadType payload_type = payload.GetType();
   size_t resume_offset =
       FeatureFlags::GetInstance().GetFlags().enable_send_payload_offset
           ? payload.GetOffset()
@@ -450,55 +484,125 @@ void PayloadManager::SendPayload(ClientProxy* client,
 
   Payload::Id payload_id =
       CreateOutgoingPayload(std::move(payload), endpoint_ids);
-  executor->Execute("send-payload", [this, client, endpoint_ids, payload_id,
-                                     payload_type, resume_offset,
-                                     payload_total_size]() {
-    if (shutdown_.Get()) return;
-    PendingPayloadHandle pending_payload = GetPayload(payload_id);
-    if (!pending_payload) {
-      RecordInvalidPayloadAnalytics(
-          client, endpoint_ids, payload_id, payload_type, resume_offset,
-          payload_total_size,
-          OperationResultCode::
-              NEARBY_GENERIC_OUTGOING_PAYLOAD_CREATION_FAILURE);
-      LOG(INFO)
-          << "PayloadManager failed to create InternalPayload for outgoing "
-             "payload_id="
-          << payload_id << ", payload_type=" << ToString(payload_type)
-          << ", aborting sendPayload().";
-      return;
-    }
-    auto* internal_payload = pending_payload->GetInternalPayload();
-    if (!internal_payload) return;
+  // State of the transfer, shared by its steps and its cancellation.
+  struct SendState {
+    PendingPayloadHandle pending_payload;
+    PayloadTransferFrame::PayloadHeader payload_header;
+    std::int64_t next_chunk_offset = 0;
+    int index = 0;
+  };
+  auto state = std::make_shared<SendState>();
+  // Sends one chunk per call, and returns false once the payload is done.
+  absl::AnyInvocable<bool()> send_step = [this, client, endpoint_ids,
+                                          payload_id, payload_type,
+                                          resume_offset, payload_total_size,
+                                          state]() -> bool {
+    if (!state->pending_payload && !shutdown_.Get()) {
+      state->pending_payload = GetPayload(payload_id);
+      if (!state->pending_payload) {
+        RecordInvalidPayloadAnalytics(
+            client, endpoint_ids, payload_id, payload_type, resume_offset,
+            payload_total_size,
+            OperationResultCode::
+                NEARBY_GENERIC_OUTGOING_PAYLOAD_CREATION_FAILURE);
+        LOG(INFO)
+            << "PayloadManager failed to create InternalPayload for outgoing "
+               "payload_id="
+            << payload_id << ", payload_type=" << ToString(payload_type)
+            << ", aborting sendPayload().";
+        return false;
+      }
+      auto* internal_payload = state->pending_payload->GetInternalPayload();
+      if (!internal_payload) return false;
 
-    RecordPayloadStartedAnalytics(client, endpoint_ids, payload_id,
-                                  payload_type, resume_offset,
-                                  internal_payload->GetTotalSize());
+      RecordPayloadStartedAnalytics(client, endpoint_ids, payload_id,
+                                    payload_type, resume_offset,
+                                    internal_payload->GetTotalSize());
 
-    PayloadTransferFrame::PayloadHeader payload_header{CreatePayloadHeader(
-        *internal_payload, resume_offset, internal_payload->GetParentFolder(),
-        internal_payload->GetFileName())};
+      state->payload_header = CreatePayloadHeader(
+          *internal_payload, resume_offset, internal_payload->GetParentFolder(),
+          internal_payload->GetFileName());
 
-    bool should_continue = true;
-    std::int64_t next_chunk_offset = 0;
-    int index = 0;
+      ThroughputRecorderContainer::GetInstance()
+          .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
+          ->Start(payload_type, PayloadDirection::OUTGOING_PAYLOAD);
+    }
 
-    ThroughputRecorderContainer::GetInstance()
-        .GetTPRecorder(payload_id, PayloadDirection::OUTGOING_PAYLOAD)
-        ->Start(payload_type, PayloadDirection::OUTGOING_PAYLOAD);
-    while (should_continue && !shutdown_.Get()) {
-      should_continue =
-          SendPayloadLoop(client, *pending_payload, payload_header,
-                          next_chunk_offset, resume_offset, index);
-      index++;
+    bool should_continue = false;
+    if (state->pending_payload && !shutdown_.Get()) {
+      should_continue = SendPayloadLoop(
+          client, *state->pending_payload, state->payload_header,
+          state->next_chunk_offset, resume_offset, state->index);
+      state->index++;
     }
+    if (should_continue && !shutdown_.Get()) return true;
 
+    // Also reached when shut down before the first step, so that the pending
+    // payload is released either way.
+    state->pending_payload = PendingPayloadHandle();
+    RunOnStatusUpdateThread("destroy-payload",
+                            [this, payload_id]()
+                                RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
+                                  DestroyPendingPayload(payload_id);
+                                });
+    return false;
+  };
+  // Called instead of the remaining steps if the scheduler is shut down
+  // before the payload is done.
+  absl::AnyInvocable<void()> cancel_send = [this, client, endpoint_ids,
+                                            payload_id, resume_offset,
+                                            state]() {
+    LOG(INFO) << "PayloadManager: send canceled: payload_id=" << payload_id;
+    if (!state->pending_payload) {
+      state->pending_payload = GetPayload(payload_id);
+    }
+    if (state->pending_payload && !state->payload_header.has_id() &&
+        state->pending_payload->GetInternalPayload() != nullptr) {
+      auto* internal_payload = state->pending_payload->GetInternalPayload();
+      state->payload_header = CreatePayloadHeader(
+          *internal_payload, resume_offset, internal_payload->GetParentFolder(),
+          internal_payload->GetFileName());
+    }
+    state->pending_payload = PendingPayloadHandle();
+    if (state->payload_header.has_id()) {
+      SendClientCallbacksForFinishedOutgoingPayload(
+          client, endpoint_ids, state->payload_header,
+          state->next_chunk_offset, PayloadStatus::LOCAL_CANCELLATION,
+          OperationResultCode::CLIENT_CANCELLATION_LOCAL_CANCEL_PAYLOAD);
+    }
     RunOnStatusUpdateThread("destroy-payload",
                             [this, payload_id]()
                                 RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
                                   DestroyPendingPayload(payload_id);
                                 });
-  });
+  };
+
+  switch (payload_type) {
+    case PayloadType::kBytes:
+      // Bytes payloads are usually small control messages; they go ahead of
+      // file chunks, and are sent in FCFS order within each client.
+      send_scheduler_.Schedule(
+          "send-payload", PayloadSendScheduler::Priority::kHigh,
+          client->GetClientId(), "bytes", std::move(send_step),
+          std::move(cancel_send));
+      break;
+    case PayloadType::kFile:
+      // Concurrent files interleave their chunks.
+      send_scheduler_.Schedule(
+          "send-payload", PayloadSendScheduler::Priority::kNormal,
+          client->GetClientId(), absl::StrCat("file:", payload_id),
+          std::move(send_step), std::move(cancel_send));
+      break;
+    default:
+      // Reading a stream chunk blocks until the app writes to it, so streams
+      // keep a thread of their own instead of holding a scheduler worker.
+      stream_payload_executor_.Execute(
+          "send-payload", [send_step = std::move(send_step)]() mutable {
+            while (send_step()) {
+            }
+          });
+      break;
+  }
   LOG(INFO) << "PayloadManager: xfer scheduled: self=" << this
             << "; payload_id=" << payload_id
             << ", payload_type=" << ToString(payload_type);
@@ -730,27 +834,15 @@ PayloadProgressInfo::Status PayloadManager::PayloadStatusToTransferUpdateStatus(
   }
 }
 
-SingleThreadExecutor* PayloadManager::GetOutgoingPayloadExecutor(
-    PayloadType payload_type) {
-  switch (payload_type) {
-    case PayloadType::kBytes:
-      return &bytes_payload_executor_;
-    case PayloadType::kFile:
-      return &file_payload_executor_;
-    case PayloadType::kStream:
-      return &stream_payload_executor_;
-    default:
-      return nullptr;
-  }
-}
-
 int PayloadManager::GetOptimalChunkSize(EndpointIds endpoint_ids) {
-  int minChunkSize = std::numeric_limits<int>::max();
+  // EndpointManager splits the chunk for the endpoints that can't carry it
+  // whole, so the chunk is sized for the fastest endpoint.
+  int max_chunk_size = 0;
   for (const auto& endpoint_id : endpoint_ids) {
-    minChunkSize = std::min(
-        minChunkSize, endpoint_manager_->GetMaxTransmitPacketSize(endpoint_id));
+    max_chunk_size = std::max(
+        max_chunk_size, endpoint_manager_->GetMaxTransmitPacketSize(endpoint_id));
   }
-  return minChunkSize;
+  return max_chunk_size;
 }
 
 PayloadTransferFrame::PayloadHeader PayloadManager::CreatePayloadHeader(
@@ -1584,6 +1676,18 @@ void PayloadManager::SetCustomSavePath(ClientProxy* client,
   custom_save_path_ = path;
 }
 
+std::string PayloadManager::Dump() {
+  PayloadSendScheduler::Counters counters = send_scheduler_.GetCounters();
+  std::stringstream sstream;
+  sstream << "Payload Send Scheduler" << std::endl;
+  sstream << "  Queue Depth: " << counters.queue_depth << std::endl;
+  sstream << "  Active Jobs: " << counters.active_jobs << std::endl;
+  sstream << "  Steps Run: " << counters.steps_run << std::endl;
+  sstream << "  Last Wait Time: " << counters.last_wait_time << std::endl;
+  sstream << "  Max Wait Time: " << counters.max_wait_time << std::endl;
+  return sstream.str();
+}
+
 ///////////////////////////////// EndpointInfo
 ////////////////////////////////////
 
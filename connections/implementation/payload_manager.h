@@ -30,6 +30,7 @@
 #include "connections/implementation/client_proxy.h"
 #include "connections/implementation/endpoint_manager.h"
 #include "connections/implementation/internal_payload.h"
+#include "connections/implementation/payload_send_scheduler.h"
 #include "connections/listeners.h"
 #include "connections/payload.h"
 #include "connections/payload_type.h"
@@ -81,7 +82,16 @@ class PayloadManager : public EndpointManager::FrameProcessor {
 
   void SetCustomSavePath(ClientProxy* client, const std::string& path);
 
+  // Returns the state of the scheduler sending the outgoing payloads, for
+  // debugging.
+  std::string Dump();
+
  private:
+  // Number of worker threads sending bytes and file payloads. The scheduler
+  // keeps one more for bytes payloads, which file payloads blocked in a write
+  // or waiting for an ack can't hold up.
+  static constexpr int kNumSendPayloadWorkers = 2;
+
   // Information about an endpoint for a particular payload.
   struct EndpointInfo {
     // Status set for the endpoint out-of-band via a ControlMessage.
@@ -308,6 +318,8 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   static PayloadProgressInfo::Status PayloadStatusToTransferUpdateStatus(
       location::nearby::proto::connections::PayloadStatus status);
 
+  // Returns the size of the next chunk to read for `endpoint_ids`, which is
+  // the largest packet size supported by any of them.
   int GetOptimalChunkSize(EndpointIds endpoint_ids);
 
   location::nearby::connections::PayloadTransferFrame::PayloadHeader
@@ -426,8 +438,6 @@ class PayloadManager : public EndpointManager::FrameProcessor {
       const PayloadProgressInfo& payload_transfer_update)
       RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD();
 
-  SingleThreadExecutor* GetOutgoingPayloadExecutor(PayloadType payload_type);
-
   void RunOnStatusUpdateThread(const std::string& name,
                                absl::AnyInvocable<void()> runnable);
   bool NotifyShutdown() ABSL_LOCKS_EXCLUDED(mutex_);
@@ -460,14 +470,24 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   AtomicBoolean shutdown_{false};
   std::unique_ptr<CountDownLatch> shutdown_barrier_;
   int send_payload_count_ = 0;
-  SingleThreadExecutor bytes_payload_executor_;
-  SingleThreadExecutor file_payload_executor_;
+  // Sends bytes and file payloads, interleaving the chunks of concurrent
+  // payloads.
+  PayloadSendScheduler send_scheduler_{kNumSendPayloadWorkers};
   SingleThreadExecutor stream_payload_executor_;
   SingleThreadExecutor payload_status_update_executor_;
   SingleThreadExecutor send_payload_ack_executor_;
   PendingPayloads pending_payloads_;
   EndpointManager* endpoint_manager_;
 
+  // Shared with the callbacks of the chunks queued in the EndpointManager,
+  // which may run on an endpoint's writer thread after we're destroyed.
+  struct WriteCallbackGuard {
+    Mutex mutex;
+    bool is_shutdown ABSL_GUARDED_BY(mutex) = false;
+  };
+  std::shared_ptr<WriteCallbackGuard> write_callback_guard_ =
+      std::make_shared<WriteCallbackGuard>();
+
   // When callback processing cannot keep the speed of callback update, the
   // callback thread will be lag to the real transfer. In order to keep sync
   // between callback and sending/receiving threads, we will skip
@@ -18,6 +18,7 @@
 #include <string>
 #include <utility>
 
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -43,6 +44,8 @@ using ::location::nearby::connections::OfflineFrame;
 using ::location::nearby::connections::PayloadTransferFrame;
 using ::nearby::analytics::PacketMetaData;
 using ::location::nearby::proto::connections::Medium;
+using ::testing::ContainsRegex;
+using ::testing::HasSubstr;
 
 constexpr size_t kChunkSize = 64 * 1024;
 constexpr absl::string_view kServiceId = "service-id";
@@ -133,6 +136,8 @@ class PayloadSimulationUser : public SimulationUser {
     return client_.IsConnectedToEndpoint(discovered_.endpoint_id);
   }
 
+  std::string DumpPayloadManager() { return pm_.Dump(); }
+
  protected:
   Payload::Id sender_payload_id_ = 0;
 };
@@ -200,6 +205,26 @@ TEST_P(PayloadManagerTest, CanSendBytePayload) {
   env_.Stop();
 }
 
+TEST_P(PayloadManagerTest, DumpReportsSendSchedulerCounters) {
+  env_.Start();
+  PayloadSimulationUser user_a(kDeviceA, GetParam());
+  PayloadSimulationUser user_b(kDeviceB, GetParam());
+  ASSERT_TRUE(SetupConnection(user_a, user_b));
+  EXPECT_THAT(user_b.DumpPayloadManager(), HasSubstr("Steps Run: 0\n"));
+
+  user_a.ExpectPayload(payload_latch_);
+  user_b.SendPayload(Payload(ByteArray{std::string(kMessage)}));
+  EXPECT_TRUE(payload_latch_.Await(kDefaultTimeout).result());
+
+  std::string dump = user_b.DumpPayloadManager();
+  EXPECT_THAT(dump, HasSubstr("Payload Send Scheduler"));
+  EXPECT_THAT(dump, ContainsRegex("Steps Run: [1-9]"));
+
+  user_a.Stop();
+  user_b.Stop();
+  env_.Stop();
+}
+
 TEST_P(PayloadManagerTest, PayloadId0IsError) {
   env_.Start();
   PayloadSimulationUser user_a(kDeviceA, GetParam());
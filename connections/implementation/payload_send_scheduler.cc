@@ -0,0 +1,187 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_send_scheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/time/time.h"
+#include "internal/platform/implementation/system_clock.h"
+#include "internal/platform/logging.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace nearby {
+namespace connections {
+
+PayloadSendScheduler::PayloadSendScheduler(int num_workers)
+    : executor_(num_workers) {}
+
+PayloadSendScheduler::~PayloadSendScheduler() { Shutdown(); }
+
+void PayloadSendScheduler::Schedule(const std::string& name, Priority priority,
+                                    std::int64_t client_id,
+                                    const std::string& queue_id,
+                                    absl::AnyInvocable<bool()> step,
+                                    absl::AnyInvocable<void()> on_cancel) {
+  {
+    MutexLock lock(&mutex_);
+    if (!is_shutdown_) {
+      JobQueue& queue = levels_[static_cast<int>(priority)]
+                            .clients[client_id]
+                            .queues[queue_id];
+      queue.jobs.push_back({.name = name,
+                            .step = std::move(step),
+                            .on_cancel = std::move(on_cancel)});
+      counters_.active_jobs++;
+      // A queue with other jobs is either running or already ready.
+      if (!queue.running && queue.jobs.size() == 1) {
+        MarkReadyLocked(priority, client_id, queue_id);
+      }
+      return;
+    }
+  }
+  LOG(WARNING) << "PayloadSendScheduler is shut down, canceling " << name;
+  if (on_cancel) on_cancel();
+}
+
+void PayloadSendScheduler::Shutdown() {
+  PriorityLevel canceled_levels[2];
+  {
+    MutexLock lock(&mutex_);
+    if (is_shutdown_) return;
+    is_shutdown_ = true;
+  }
+  executor_.Shutdown();
+  high_priority_executor_.Shutdown();
+  {
+    MutexLock lock(&mutex_);
+    std::swap(canceled_levels, levels_);
+  }
+  // Cancel the remaining jobs outside of the lock.
+  for (PriorityLevel& level : canceled_levels) {
+    for (auto& [client_id, client] : level.clients) {
+      for (auto& [queue_id, queue] : client.queues) {
+        for (Job& job : queue.jobs) {
+          LOG(INFO) << "PayloadSendScheduler: job canceled: " << job.name;
+          if (job.on_cancel) job.on_cancel();
+        }
+        MutexLock lock(&mutex_);
+        counters_.active_jobs -= queue.jobs.size();
+      }
+    }
+  }
+}
+
+PayloadSendScheduler::Counters PayloadSendScheduler::GetCounters() const {
+  MutexLock lock(&mutex_);
+  return counters_;
+}
+
+void PayloadSendScheduler::MarkReadyLocked(Priority priority,
+                                           std::int64_t client_id,
+                                           const std::string& queue_id) {
+  PriorityLevel& level = levels_[static_cast<int>(priority)];
+  ClientQueues& client = level.clients[client_id];
+  client.queues[queue_id].ready_time = SystemClock::ElapsedRealtime();
+  if (client.ready_queue_ids.empty()) {
+    level.ready_client_ids.push_back(client_id);
+  }
+  client.ready_queue_ids.push_back(queue_id);
+  counters_.queue_depth++;
+  // There is exactly one shared worker task per ready queue, but it runs
+  // whichever step is picked by the policy at the time it runs. kHigh queues
+  // get a task on the reserved worker as well; whichever of the two runs
+  // second may find nothing to do.
+  executor_.Execute("payload-send-step",
+                    [this]() { RunNextStep(Priority::kNormal); });
+  if (priority == Priority::kHigh) {
+    high_priority_executor_.Execute(
+        "payload-send-step", [this]() { RunNextStep(Priority::kHigh); });
+  }
+}
+
+void PayloadSendScheduler::RunNextStep(Priority lowest_priority) {
+  Priority priority;
+  std::int64_t client_id;
+  std::string queue_id;
+  std::optional<Job> job;
+  {
+    MutexLock lock(&mutex_);
+    if (is_shutdown_) return;
+    for (int i = 0; i <= static_cast<int>(lowest_priority); ++i) {
+      PriorityLevel& level = levels_[i];
+      if (level.ready_client_ids.empty()) continue;
+
+      priority = static_cast<Priority>(i);
+      client_id = level.ready_client_ids.front();
+      level.ready_client_ids.pop_front();
+      ClientQueues& client = level.clients[client_id];
+      queue_id = client.ready_queue_ids.front();
+      client.ready_queue_ids.pop_front();
+      if (!client.ready_queue_ids.empty()) {
+        level.ready_client_ids.push_back(client_id);
+      }
+
+      JobQueue& queue = client.queues[queue_id];
+      job.emplace(std::move(queue.jobs.front()));
+      queue.jobs.pop_front();
+      queue.running = true;
+
+      absl::Duration wait_time =
+          SystemClock::ElapsedRealtime() - queue.ready_time;
+      counters_.queue_depth--;
+      counters_.steps_run++;
+      counters_.last_wait_time = wait_time;
+      counters_.max_wait_time = std::max(counters_.max_wait_time, wait_time);
+      break;
+    }
+  }
+  if (!job.has_value()) return;
+
+  bool has_more_steps = job->step();
+  if (!has_more_steps) {
+    NEARBY_VLOG(1) << "PayloadSendScheduler: job done: " << job->name;
+    job.reset();
+  }
+
+  MutexLock lock(&mutex_);
+  if (!has_more_steps) counters_.active_jobs--;
+  PriorityLevel& level = levels_[static_cast<int>(priority)];
+  ClientQueues& client = level.clients[client_id];
+  JobQueue& queue = client.queues[queue_id];
+  queue.running = false;
+  if (has_more_steps) {
+    // Resume the job after the other ready jobs had their turn. Once shut
+    // down, Shutdown() cancels it instead.
+    queue.jobs.push_front(std::move(*job));
+  }
+  if (is_shutdown_) return;
+
+  if (!queue.jobs.empty()) {
+    MarkReadyLocked(priority, client_id, queue_id);
+    return;
+  }
+  client.queues.erase(queue_id);
+  if (client.queues.empty()) {
+    level.clients.erase(client_id);
+  }
+}
+
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,139 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_PAYLOAD_SEND_SCHEDULER_H_
+#define CORE_INTERNAL_PAYLOAD_SEND_SCHEDULER_H_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/time/time.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/single_thread_executor.h"
+
+namespace nearby {
+namespace connections {
+
+// Runs outgoing payload transfers on a small pool of worker threads,
+// interleaving their chunks.
+//
+// A job is a step function that sends one chunk per call, and returns false
+// once the payload is done. After each step the job goes back to the end of
+// its queue, so concurrent payloads share the workers instead of waiting for
+// each other to complete.
+//
+// Jobs are picked by:
+//  - priority: ready jobs of a higher priority always run first. On top of
+//    the shared workers, one worker only runs kHigh jobs, so that they are
+//    never stuck behind kNormal steps blocked in a write;
+//  - client: clients with ready jobs take turns;
+//  - queue: within a client, queues with ready jobs take turns. Jobs in the
+//    same queue run one after the other, in the order they were scheduled.
+class PayloadSendScheduler {
+ public:
+  enum class Priority {
+    kHigh = 0,
+    kNormal = 1,
+  };
+
+  struct Counters {
+    // Number of jobs ready to run a step, waiting for a worker.
+    int queue_depth = 0;
+    // Number of scheduled jobs that are not done yet.
+    int active_jobs = 0;
+    // Number of steps run so far.
+    std::int64_t steps_run = 0;
+    // Time the last step spent waiting for a worker once ready.
+    absl::Duration last_wait_time = absl::ZeroDuration();
+    // Longest time a step spent waiting for a worker once ready.
+    absl::Duration max_wait_time = absl::ZeroDuration();
+  };
+
+  // `num_workers` is the number of workers shared by all priorities, not
+  // counting the one reserved for kHigh jobs.
+  explicit PayloadSendScheduler(int num_workers);
+  ~PayloadSendScheduler();
+  PayloadSendScheduler(const PayloadSendScheduler&) = delete;
+  PayloadSendScheduler& operator=(const PayloadSendScheduler&) = delete;
+
+  // Schedules `step` to be called repeatedly, until it returns false. If the
+  // scheduler is shut down before that, `on_cancel` is called instead of the
+  // remaining steps.
+  void Schedule(const std::string& name, Priority priority,
+                std::int64_t client_id, const std::string& queue_id,
+                absl::AnyInvocable<bool()> step,
+                absl::AnyInvocable<void()> on_cancel = nullptr)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Stops the workers, waiting for the running steps to complete, then
+  // cancels the jobs not done yet, on the calling thread. Jobs scheduled
+  // afterwards are canceled right away.
+  void Shutdown();
+
+  Counters GetCounters() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Job {
+    std::string name;
+    absl::AnyInvocable<bool()> step;
+    absl::AnyInvocable<void()> on_cancel;
+  };
+
+  struct JobQueue {
+    std::deque<Job> jobs;
+    // True while a step of the front job is running. The job is taken out of
+    // `jobs` while it runs.
+    bool running = false;
+    // The time the job at the front of the queue became ready to run a step.
+    absl::Time ready_time = absl::InfinitePast();
+  };
+
+  struct ClientQueues {
+    absl::flat_hash_map<std::string, JobQueue> queues;
+    // Queues whose front job is ready to run a step.
+    std::deque<std::string> ready_queue_ids;
+  };
+
+  struct PriorityLevel {
+    absl::flat_hash_map<std::int64_t, ClientQueues> clients;
+    // Clients with ready queues. Each client is listed at most once.
+    std::deque<std::int64_t> ready_client_ids;
+  };
+
+  // Marks the front job of the queue as ready, and posts a worker task for
+  // it.
+  void MarkReadyLocked(Priority priority, std::int64_t client_id,
+                       const std::string& queue_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Runs one step of the ready job picked by the scheduling policy, among the
+  // jobs of `lowest_priority` or higher.
+  void RunNextStep(Priority lowest_priority) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  mutable Mutex mutex_;
+  PriorityLevel levels_[2] ABSL_GUARDED_BY(mutex_);
+  Counters counters_ ABSL_GUARDED_BY(mutex_);
+  bool is_shutdown_ ABSL_GUARDED_BY(mutex_) = false;
+  MultiThreadExecutor executor_;
+  SingleThreadExecutor high_priority_executor_;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_INTERNAL_PAYLOAD_SEND_SCHEDULER_H_
@@ -0,0 +1,213 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "connections/implementation/payload_send_scheduler.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/mutex_lock.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::testing::ElementsAre;
+using Priority = PayloadSendScheduler::Priority;
+
+constexpr absl::Duration kTimeout = absl::Seconds(5);
+
+class PayloadSendSchedulerTest : public ::testing::Test {
+ protected:
+  // Returns a step function that records `name` `num_steps` times, then
+  // counts down `done`.
+  absl::AnyInvocable<bool()> RecordingStep(const std::string& name,
+                                           int num_steps,
+                                           CountDownLatch& done) {
+    return [this, name, num_steps, &done, steps = 0]() mutable {
+      {
+        MutexLock lock(&mutex_);
+        steps_.push_back(name);
+      }
+      if (++steps < num_steps) return true;
+      done.CountDown();
+      return false;
+    };
+  }
+
+  // Occupies the only worker of `scheduler_` until `release` is counted down.
+  void BlockWorker(CountDownLatch& release) {
+    scheduler_.Schedule("blocker", Priority::kNormal, /*client_id=*/0,
+                        "blocker", [&release]() {
+                          release.Await();
+                          return false;
+                        });
+  }
+
+  std::vector<std::string> GetSteps() {
+    MutexLock lock(&mutex_);
+    return steps_;
+  }
+
+  PayloadSendScheduler scheduler_{1};
+  Mutex mutex_;
+  std::vector<std::string> steps_;
+};
+
+TEST_F(PayloadSendSchedulerTest, HighPriorityJobRunsFirst) {
+  CountDownLatch release(1);
+  CountDownLatch done(2);
+  BlockWorker(release);
+
+  scheduler_.Schedule("file", Priority::kNormal, /*client_id=*/1, "file",
+                      RecordingStep("file", 2, done));
+  scheduler_.Schedule("bytes", Priority::kHigh, /*client_id=*/1, "bytes",
+                      RecordingStep("bytes", 1, done));
+  release.CountDown();
+
+  ASSERT_TRUE(done.Await(kTimeout).result());
+  EXPECT_THAT(GetSteps(), ElementsAre("bytes", "file", "file"));
+}
+
+TEST_F(PayloadSendSchedulerTest, HighPriorityJobRunsWhileWorkersAreBlocked) {
+  CountDownLatch release(1);
+  CountDownLatch done(1);
+  BlockWorker(release);
+
+  scheduler_.Schedule("bytes", Priority::kHigh, /*client_id=*/1, "bytes",
+                      RecordingStep("bytes", 2, done));
+
+  EXPECT_TRUE(done.Await(kTimeout).result());
+  EXPECT_THAT(GetSteps(), ElementsAre("bytes", "bytes"));
+  release.CountDown();
+  // Waits for the blocker to return before `release` goes out of scope.
+  scheduler_.Shutdown();
+}
+
+TEST_F(PayloadSendSchedulerTest, JobsInDifferentQueuesInterleave) {
+  CountDownLatch release(1);
+  CountDownLatch done(2);
+  BlockWorker(release);
+
+  scheduler_.Schedule("a", Priority::kNormal, /*client_id=*/1, "a",
+                      RecordingStep("a", 3, done));
+  scheduler_.Schedule("b", Priority::kNormal, /*client_id=*/1, "b",
+                      RecordingStep("b", 3, done));
+  release.CountDown();
+
+  ASSERT_TRUE(done.Await(kTimeout).result());
+  EXPECT_THAT(GetSteps(), ElementsAre("a", "b", "a", "b", "a", "b"));
+}
+
+TEST_F(PayloadSendSchedulerTest, ClientsTakeTurns) {
+  CountDownLatch release(1);
+  CountDownLatch done(3);
+  BlockWorker(release);
+
+  scheduler_.Schedule("a1", Priority::kNormal, /*client_id=*/1, "a1",
+                      RecordingStep("a1", 2, done));
+  scheduler_.Schedule("a2", Priority::kNormal, /*client_id=*/1, "a2",
+                      RecordingStep("a2", 2, done));
+  scheduler_.Schedule("b", Priority::kNormal, /*client_id=*/2, "b",
+                      RecordingStep("b", 2, done));
+  release.CountDown();
+
+  ASSERT_TRUE(done.Await(kTimeout).result());
+  EXPECT_THAT(GetSteps(), ElementsAre("a1", "b", "a2", "b", "a1", "a2"));
+}
+
+TEST_F(PayloadSendSchedulerTest, JobsInSameQueueRunInOrder) {
+  CountDownLatch release(1);
+  CountDownLatch done(2);
+  BlockWorker(release);
+
+  scheduler_.Schedule("a", Priority::kHigh, /*client_id=*/1, "bytes",
+                      RecordingStep("a", 2, done));
+  scheduler_.Schedule("b", Priority::kHigh, /*client_id=*/1, "bytes",
+                      RecordingStep("b", 2, done));
+  release.CountDown();
+
+  ASSERT_TRUE(done.Await(kTimeout).result());
+  EXPECT_THAT(GetSteps(), ElementsAre("a", "a", "b", "b"));
+}
+
+TEST_F(PayloadSendSchedulerTest, CountersTrackQueuedAndCompletedJobs) {
+  CountDownLatch release(1);
+  CountDownLatch done(1);
+  BlockWorker(release);
+  scheduler_.Schedule("a", Priority::kNormal, /*client_id=*/1, "a",
+                      RecordingStep("a", 3, done));
+
+  PayloadSendScheduler::Counters counters = scheduler_.GetCounters();
+  EXPECT_EQ(counters.active_jobs, 2);
+  release.CountDown();
+  ASSERT_TRUE(done.Await(kTimeout).result());
+  scheduler_.Shutdown();
+
+  counters = scheduler_.GetCounters();
+  EXPECT_EQ(counters.active_jobs, 0);
+  EXPECT_EQ(counters.queue_depth, 0);
+  EXPECT_EQ(counters.steps_run, 4);
+  EXPECT_GE(counters.max_wait_time, counters.last_wait_time);
+}
+
+TEST_F(PayloadSendSchedulerTest, ShutdownCancelsJobsNotDone) {
+  CountDownLatch started(1);
+  CountDownLatch done(1);
+  int canceled = 0;
+  // Never done, so the job behind it in the same queue never runs.
+  scheduler_.Schedule(
+      "endless", Priority::kNormal, /*client_id=*/1, "queue",
+      [&started]() {
+        started.CountDown();
+        absl::SleepFor(absl::Milliseconds(1));
+        return true;
+      },
+      [&canceled]() { canceled++; });
+  scheduler_.Schedule("queued", Priority::kNormal, /*client_id=*/1, "queue",
+                      RecordingStep("queued", 1, done),
+                      [&canceled]() { canceled++; });
+  ASSERT_TRUE(started.Await(kTimeout).result());
+
+  scheduler_.Shutdown();
+
+  EXPECT_EQ(canceled, 2);
+  EXPECT_TRUE(GetSteps().empty());
+  EXPECT_EQ(scheduler_.GetCounters().active_jobs, 0);
+}
+
+TEST_F(PayloadSendSchedulerTest, ScheduleAfterShutdownIsCanceled) {
+  CountDownLatch done(1);
+  bool canceled = false;
+  scheduler_.Shutdown();
+
+  scheduler_.Schedule("a", Priority::kNormal, /*client_id=*/1, "a",
+                      RecordingStep("a", 1, done),
+                      [&canceled]() { canceled = true; });
+
+  EXPECT_TRUE(canceled);
+  EXPECT_EQ(scheduler_.GetCounters().active_jobs, 0);
+  EXPECT_TRUE(GetSteps().empty());
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
@@ -0,0 +1,601 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the connections stack running in-process over
+// MediumEnvironment: payload throughput per medium, payload type, payload
+// size and number of receiving endpoints, connection establishment latency,
+// the cost of writing a DATA frame through an endpoint channel with and
+// without encryption, and the cost of framing it on the write side alone.
+//
+// Run with
+//   bazel run -c opt //connections/implementation:payload_throughput_benchmark
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>  // NOLINT
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "securegcm/ukey2_handshake.h"
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "connections/implementation/base_endpoint_channel.h"
+#include "connections/implementation/client_proxy.h"
+#include "connections/implementation/encryption_runner.h"
+#include "connections/implementation/endpoint_channel.h"
+#include "connections/implementation/offline_frames.h"
+#include "connections/implementation/offline_simulation_user.h"
+#include "connections/implementation/proto/offline_wire_formats.pb.h"
+#include "connections/listeners.h"
+#include "connections/medium_selector.h"
+#include "connections/payload.h"
+#include "connections/status.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/count_down_latch.h"
+#include "internal/platform/file.h"
+#include "internal/platform/input_stream.h"
+#include "internal/platform/medium_environment.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/mutex_lock.h"
+#include "internal/platform/output_stream.h"
+#include "internal/platform/pipe.h"
+#include "internal/platform/single_thread_executor.h"
+#include "proto/connections_enums.pb.h"
+
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::connections::PayloadTransferFrame;
+using ::location::nearby::proto::connections::Medium;
+using EncryptionContext = BaseEndpointChannel::EncryptionContext;
+
+constexpr absl::string_view kServiceId = "benchmark-service-id";
+constexpr absl::Duration kTimeout = absl::Seconds(30);
+constexpr size_t kChunkSize = 64 * 1024;
+
+struct BenchmarkMedium {
+  absl::string_view name;
+  BooleanMediumSelector allowed;
+};
+
+// The mediums MediumEnvironment can connect on its own. The first argument of
+// the payload and connection benchmarks is an index into this array.
+constexpr BenchmarkMedium kMediums[] = {
+    {"Bluetooth", BooleanMediumSelector{.bluetooth = true}},
+    {"Ble", BooleanMediumSelector{.ble = true}},
+    {"WifiLan", BooleanMediumSelector{.wifi_lan = true}},
+};
+constexpr int kNumMediums = sizeof(kMediums) / sizeof(kMediums[0]);
+
+// OfflineSimulationUser which can be connected to more than one endpoint.
+class BenchmarkUser : public OfflineSimulationUser {
+ public:
+  using OfflineSimulationUser::OfflineSimulationUser;
+
+  // Advertises, and counts down `initiated_latch` for every incoming
+  // connection, and `accepted_latch` once both sides have accepted it.
+  Status StartAdvertising(CountDownLatch* initiated_latch,
+                          CountDownLatch* accepted_latch) {
+    service_id_ = std::string(kServiceId);
+    ConnectionListener listener = {
+        .initiated_cb =
+            [this, initiated_latch](const std::string& endpoint_id,
+                                    const ConnectionResponseInfo& info) {
+              {
+                MutexLock lock(&endpoints_mutex_);
+                endpoint_ids_.push_back(endpoint_id);
+              }
+              initiated_latch->CountDown();
+            },
+        .accepted_cb =
+            [accepted_latch](const std::string& endpoint_id) {
+              accepted_latch->CountDown();
+            },
+    };
+    return ctrl_.StartAdvertising(&client_, service_id_, advertising_options_,
+                                  {
+                                      .endpoint_info = info_,
+                                      .listener = std::move(listener),
+                                  });
+  }
+
+  // Accepts all the connections initiated so far.
+  void AcceptConnections() {
+    for (const std::string& endpoint_id : GetEndpointIds()) {
+      ctrl_.AcceptConnection(&client_, endpoint_id, PayloadListener());
+    }
+  }
+
+  void SendPayloadToAll(Payload payload) {
+    ctrl_.SendPayload(&client_, GetEndpointIds(), std::move(payload));
+  }
+
+  void SetCustomSavePath(const std::string& path) {
+    ctrl_.SetCustomSavePath(&client_, path);
+  }
+
+  bool WaitForPayloadReceived(Payload::Id payload_id) {
+    return WaitForProgress(
+        [payload_id](const PayloadProgressInfo& info) {
+          return info.payload_id == payload_id &&
+                 info.status == PayloadProgressInfo::Status::kSuccess;
+        },
+        kTimeout);
+  }
+
+ private:
+  std::vector<std::string> GetEndpointIds() {
+    MutexLock lock(&endpoints_mutex_);
+    return endpoint_ids_;
+  }
+
+  Mutex endpoints_mutex_;
+  std::vector<std::string> endpoint_ids_ ABSL_GUARDED_BY(endpoints_mutex_);
+};
+
+// One advertising sender, and receivers which discover it and connect to it.
+class Cluster {
+ public:
+  Cluster(const BooleanMediumSelector& allowed, int num_receivers)
+      : found_latch_(num_receivers),
+        initiated_latch_(num_receivers),
+        accepted_latch_(num_receivers),
+        sender_initiated_latch_(num_receivers),
+        sender_accepted_latch_(num_receivers),
+        sender_("sender", allowed) {
+    for (int i = 0; i < num_receivers; ++i) {
+      receivers_.push_back(
+          std::make_unique<BenchmarkUser>(absl::StrCat("receiver-", i),
+                                          allowed));
+    }
+  }
+
+  ~Cluster() {
+    for (auto& receiver : receivers_) receiver->Stop();
+    sender_.Stop();
+  }
+
+  // Can only be called once.
+  bool Connect() {
+    if (!sender_
+             .StartAdvertising(&sender_initiated_latch_,
+                               &sender_accepted_latch_)
+             .Ok()) {
+      return false;
+    }
+    for (auto& receiver : receivers_) {
+      receiver->StartDiscovery(std::string(kServiceId), &found_latch_);
+    }
+    if (!found_latch_.Await(kTimeout).result()) return false;
+    for (auto& receiver : receivers_) {
+      receiver->StopDiscovery();
+      receiver->RequestConnection(&initiated_latch_);
+    }
+    if (!initiated_latch_.Await(kTimeout).result() ||
+        !sender_initiated_latch_.Await(kTimeout).result()) {
+      return false;
+    }
+    sender_.AcceptConnections();
+    for (auto& receiver : receivers_) {
+      receiver->AcceptConnection(&accepted_latch_);
+    }
+    return accepted_latch_.Await(kTimeout).result() &&
+           sender_accepted_latch_.Await(kTimeout).result();
+  }
+
+  BenchmarkUser& sender() { return sender_; }
+  std::vector<std::unique_ptr<BenchmarkUser>>& receivers() {
+    return receivers_;
+  }
+
+ private:
+  // Declared first, so that they outlive the users which count them down.
+  CountDownLatch found_latch_;
+  CountDownLatch initiated_latch_;
+  CountDownLatch accepted_latch_;
+  CountDownLatch sender_initiated_latch_;
+  CountDownLatch sender_accepted_latch_;
+  BenchmarkUser sender_;
+  std::vector<std::unique_ptr<BenchmarkUser>> receivers_;
+};
+
+// Payload benchmarks take the medium index, the payload size and the number
+// of receiving endpoints as arguments.
+void PayloadArguments(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"medium", "size", "endpoints"});
+  for (int medium = 0; medium < kNumMediums; ++medium) {
+    for (int64_t size : {1 << 10, 64 << 10, 1 << 20, 8 << 20}) {
+      for (int endpoints : {1, 2, 4}) {
+        benchmark->Args({medium, size, endpoints});
+      }
+    }
+  }
+  benchmark->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+void SetPayloadCounters(benchmark::State& state) {
+  const BenchmarkMedium& medium = kMediums[state.range(0)];
+  state.SetLabel(std::string(medium.name));
+  state.SetBytesProcessed(state.iterations() * state.range(1) *
+                          state.range(2));
+  state.SetItemsProcessed(state.iterations() * state.range(2));
+}
+
+void BM_BytesPayload(benchmark::State& state) {
+  const BenchmarkMedium& medium = kMediums[state.range(0)];
+  const size_t size = state.range(1);
+  MediumEnvironment::Instance().Start();
+  {
+    Cluster cluster(medium.allowed, state.range(2));
+    if (!cluster.Connect()) {
+      state.SkipWithError("Failed to connect.");
+    } else {
+      const ByteArray bytes(size);
+      for (auto _ : state) {
+        Payload payload(bytes);
+        Payload::Id payload_id = payload.GetId();
+        cluster.sender().SendPayloadToAll(std::move(payload));
+        for (auto& receiver : cluster.receivers()) {
+          if (!receiver->WaitForPayloadReceived(payload_id)) {
+            state.SkipWithError("Bytes payload was not received.");
+            break;
+          }
+        }
+      }
+      SetPayloadCounters(state);
+    }
+  }
+  MediumEnvironment::Instance().Stop();
+}
+BENCHMARK(BM_BytesPayload)->Apply(PayloadArguments);
+
+void BM_FilePayload(benchmark::State& state) {
+  const BenchmarkMedium& medium = kMediums[state.range(0)];
+  const int64_t size = state.range(1);
+  const std::filesystem::path root =
+      std::filesystem::temp_directory_path() / "payload_throughput_benchmark";
+  const std::filesystem::path source = root / "source.bin";
+  std::filesystem::create_directories(root);
+  {
+    OutputFile file(source.string());
+    file.Write(ByteArray(size));
+    file.Close();
+  }
+  MediumEnvironment::Instance().Start();
+  {
+    Cluster cluster(medium.allowed, state.range(2));
+    std::vector<std::filesystem::path> save_paths;
+    for (int i = 0; i < cluster.receivers().size(); ++i) {
+      std::filesystem::path save_path = root / absl::StrCat("receiver-", i);
+      std::filesystem::create_directories(save_path);
+      cluster.receivers()[i]->SetCustomSavePath(save_path.string());
+      save_paths.push_back(save_path);
+    }
+    if (!cluster.Connect()) {
+      state.SkipWithError("Failed to connect.");
+    } else {
+      for (auto _ : state) {
+        Payload payload(Payload::GenerateId(),
+                        InputFile(source.string(), size));
+        Payload::Id payload_id = payload.GetId();
+        cluster.sender().SendPayloadToAll(std::move(payload));
+        for (auto& receiver : cluster.receivers()) {
+          if (!receiver->WaitForPayloadReceived(payload_id)) {
+            state.SkipWithError("File payload was not received.");
+            break;
+          }
+        }
+        // Received files would otherwise be renamed to not overwrite the
+        // previous ones.
+        state.PauseTiming();
+        for (const std::filesystem::path& save_path : save_paths) {
+          for (const auto& entry :
+               std::filesystem::directory_iterator(save_path)) {
+            std::filesystem::remove_all(entry.path());
+          }
+        }
+        state.ResumeTiming();
+      }
+      SetPayloadCounters(state);
+    }
+  }
+  MediumEnvironment::Instance().Stop();
+  std::filesystem::remove_all(root);
+}
+BENCHMARK(BM_FilePayload)->Apply(PayloadArguments);
+
+void BM_StreamPayload(benchmark::State& state) {
+  const BenchmarkMedium& medium = kMediums[state.range(0)];
+  const size_t size = state.range(1);
+  const int num_receivers = state.range(2);
+  MediumEnvironment::Instance().Start();
+  {
+    Cluster cluster(medium.allowed, num_receivers);
+    if (!cluster.Connect()) {
+      state.SkipWithError("Failed to connect.");
+    } else {
+      const ByteArray piece(std::min(size, kChunkSize));
+      for (auto _ : state) {
+        auto [input, output] = CreatePipe();
+        CountDownLatch arrived_latch(num_receivers);
+        for (auto& receiver : cluster.receivers()) {
+          receiver->ExpectPayload(arrived_latch);
+        }
+        Payload payload(std::move(input));
+        Payload::Id payload_id = payload.GetId();
+        cluster.sender().SendPayloadToAll(std::move(payload));
+        // The receivers are drained concurrently: the sender reads each chunk
+        // once for all of them, so it can only move on once every receiver
+        // made room for it.
+        CountDownLatch drained_latch(num_receivers);
+        MultiThreadExecutor drainers(num_receivers);
+        {
+          SingleThreadExecutor writer;
+          writer.Execute([&output = output, &piece, size]() {
+            for (size_t written = 0; written < size;
+                 written += piece.size()) {
+              if (output->Write(piece).Raised()) break;
+            }
+            output->Close();
+          });
+          if (!arrived_latch.Await(kTimeout).result()) {
+            state.SkipWithError("Stream payload did not arrive.");
+            output->Close();
+            break;
+          }
+          for (auto& receiver : cluster.receivers()) {
+            InputStream* stream = receiver->GetPayload().AsStream();
+            drainers.Execute([stream, size, &drained_latch]() {
+              size_t read = 0;
+              while (stream != nullptr && read < size) {
+                ExceptionOr<ByteArray> bytes = stream->Read(kChunkSize);
+                if (!bytes.ok() || bytes.result().Empty()) break;
+                read += bytes.result().size();
+              }
+              drained_latch.CountDown();
+            });
+          }
+        }
+        if (!drained_latch.Await(kTimeout).result()) {
+          state.SkipWithError("Stream payload was not drained.");
+          break;
+        }
+        for (auto& receiver : cluster.receivers()) {
+          if (!receiver->WaitForPayloadReceived(payload_id)) {
+            state.SkipWithError("Stream payload was not received.");
+            break;
+          }
+        }
+      }
+      SetPayloadCounters(state);
+    }
+  }
+  MediumEnvironment::Instance().Stop();
+}
+BENCHMARK(BM_StreamPayload)->Apply(PayloadArguments);
+
+// Time from starting to advertise until both sides accepted the connection.
+void BM_ConnectionEstablishment(benchmark::State& state) {
+  const BenchmarkMedium& medium = kMediums[state.range(0)];
+  MediumEnvironment::Instance().Start();
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto cluster = std::make_unique<Cluster>(medium.allowed, 1);
+    state.ResumeTiming();
+    if (!cluster->Connect()) {
+      state.SkipWithError("Failed to connect.");
+      break;
+    }
+    state.PauseTiming();
+    cluster.reset();
+    state.ResumeTiming();
+  }
+  state.SetLabel(std::string(medium.name));
+  MediumEnvironment::Instance().Stop();
+}
+BENCHMARK(BM_ConnectionEstablishment)
+    ->ArgName("medium")
+    ->DenseRange(0, kNumMediums - 1)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+class BenchmarkEndpointChannel : public BaseEndpointChannel {
+ public:
+  BenchmarkEndpointChannel(InputStream* input, OutputStream* output)
+      : BaseEndpointChannel(std::string(kServiceId), "channel", input,
+                            output) {}
+
+  Medium GetMedium() const override { return Medium::UNKNOWN_MEDIUM; }
+
+ private:
+  void CloseImpl() override {}
+};
+
+// Runs the UKEY2 handshake between the two channels, and returns the
+// resulting contexts, or nullptrs if it failed.
+std::pair<std::shared_ptr<EncryptionContext>,
+          std::shared_ptr<EncryptionContext>>
+DoKeyExchange(EndpointChannel* client_channel,
+              EndpointChannel* server_channel) {
+  std::shared_ptr<EncryptionContext> client_context;
+  std::shared_ptr<EncryptionContext> server_context;
+  EncryptionRunner client_runner;
+  EncryptionRunner server_runner;
+  ClientProxy client_proxy;
+  ClientProxy server_proxy;
+  CountDownLatch latch(2);
+  auto make_listener = [&latch](std::shared_ptr<EncryptionContext>& context) {
+    return EncryptionRunner::ResultListener{
+        .on_success_cb =
+            [&latch, &context](
+                const std::string& endpoint_id,
+                std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+                const std::string& auth_token,
+                const ByteArray& raw_auth_token) {
+              if (ukey2->VerifyHandshake()) {
+                context = ukey2->ToConnectionContext();
+              }
+              latch.CountDown();
+            },
+        .on_failure_cb =
+            [&latch](const std::string& endpoint_id,
+                     EndpointChannel* channel) { latch.CountDown(); },
+    };
+  };
+  client_runner.StartClient(&client_proxy, "endpoint_id", client_channel,
+                            make_listener(client_context));
+  server_runner.StartServer(&server_proxy, "endpoint_id", server_channel,
+                            make_listener(server_context));
+  if (!latch.Await(kTimeout).result()) return {};
+  return {std::move(client_context), std::move(server_context)};
+}
+
+// CPU spent to write a DATA frame of the given chunk size through an endpoint
+// channel, and to read it on the other end, with and without encryption.
+void BM_EndpointChannelDataFrame(benchmark::State& state) {
+  const bool encrypted = state.range(0) != 0;
+  const size_t chunk_size = state.range(1);
+  auto [sender_input, receiver_output] = CreatePipe();
+  auto [receiver_input, sender_output] = CreatePipe();
+  BenchmarkEndpointChannel sender(sender_input.get(), sender_output.get());
+  BenchmarkEndpointChannel receiver(receiver_input.get(),
+                                    receiver_output.get());
+  if (encrypted) {
+    auto [sender_context, receiver_context] =
+        DoKeyExchange(&sender, &receiver);
+    if (sender_context == nullptr || receiver_context == nullptr) {
+      state.SkipWithError("Key exchange failed.");
+      return;
+    }
+    sender.EnableEncryption(sender_context);
+    receiver.EnableEncryption(receiver_context);
+  }
+
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(Payload::GenerateId());
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(chunk_size);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_offset(0);
+  chunk.set_flags(0);
+  chunk.set_body(std::string(chunk_size, 'x'));
+  const ByteArray frame = parser::ForDataPayloadTransfer(header, chunk);
+
+  {
+    SingleThreadExecutor reader;
+    reader.Execute([&receiver]() {
+      while (receiver.Read().ok()) {
+      }
+    });
+    for (auto _ : state) {
+      if (sender.Write(frame).Raised()) {
+        state.SkipWithError("Write failed.");
+        break;
+      }
+    }
+    // Lets the reader run out of frames.
+    sender_output->Close();
+  }
+  state.SetBytesProcessed(state.iterations() * chunk_size);
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(encrypted ? "encrypted" : "unencrypted");
+}
+BENCHMARK(BM_EndpointChannelDataFrame)
+    ->ArgNames({"encrypted", "chunk_size"})
+    ->ArgsProduct({{0, 1}, {1 << 10, 32 << 10, 64 << 10, 512 << 10}})
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
+
+// Discards everything written to it, counting the calls and the bytes.
+class CountingOutputStream : public OutputStream {
+ public:
+  Exception Write(const ByteArray& data) override {
+    ++writes_;
+    bytes_ += data.size();
+    benchmark::DoNotOptimize(data.data());
+    return {Exception::kSuccess};
+  }
+  Exception Flush() override { return {Exception::kSuccess}; }
+  Exception Close() override { return {Exception::kSuccess}; }
+
+  int64_t writes() const { return writes_; }
+  int64_t bytes() const { return bytes_; }
+
+ private:
+  int64_t writes_ = 0;
+  int64_t bytes_ = 0;
+};
+
+// Cost of framing a DATA frame of the given chunk size, and encrypting it if
+// enabled, without the cost of a transport or a reader. Reports the writes
+// and bytes handed to the output stream per frame.
+void BM_EndpointChannelWrite(benchmark::State& state) {
+  const bool encrypted = state.range(0) != 0;
+  const size_t chunk_size = state.range(1);
+  auto [input, unused_output] = CreatePipe();
+  CountingOutputStream output;
+  BenchmarkEndpointChannel channel(input.get(), &output);
+  if (encrypted) {
+    auto [sender_input, receiver_output] = CreatePipe();
+    auto [receiver_input, sender_output] = CreatePipe();
+    BenchmarkEndpointChannel sender(sender_input.get(), sender_output.get());
+    BenchmarkEndpointChannel receiver(receiver_input.get(),
+                                      receiver_output.get());
+    auto [sender_context, receiver_context] =
+        DoKeyExchange(&sender, &receiver);
+    if (sender_context == nullptr) {
+      state.SkipWithError("Key exchange failed.");
+      return;
+    }
+    channel.EnableEncryption(sender_context);
+  }
+
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(Payload::GenerateId());
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(chunk_size);
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_offset(0);
+  chunk.set_flags(0);
+  chunk.set_body(std::string(chunk_size, 'x'));
+  const ByteArray frame = parser::ForDataPayloadTransfer(header, chunk);
+
+  for (auto _ : state) {
+    if (channel.Write(frame).Raised()) {
+      state.SkipWithError("Write failed.");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * chunk_size);
+  state.SetItemsProcessed(state.iterations());
+  state.counters["writes_per_frame"] = benchmark::Counter(
+      output.writes(), benchmark::Counter::kAvgIterations);
+  state.counters["bytes_per_frame"] = benchmark::Counter(
+      output.bytes(), benchmark::Counter::kAvgIterations);
+  state.SetLabel(encrypted ? "encrypted" : "unencrypted");
+}
+BENCHMARK(BM_EndpointChannelWrite)
+    ->ArgNames({"encrypted", "chunk_size"})
+    ->ArgsProduct({{0, 1}, {1 << 10, 32 << 10, 64 << 10, 512 << 10}});
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
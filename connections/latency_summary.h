@@ -0,0 +1,51 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_LATENCY_SUMMARY_H_
+#define CORE_LATENCY_SUMMARY_H_
+
+#include <cstdint>
+
+#include "absl/time/time.h"
+#include "connections/medium_selector.h"
+#include "connections/payload_type.h"
+
+namespace nearby {
+namespace connections {
+
+// The latencies of one stage that the payload frames go through, on one medium
+// and in one direction, as returned by Core::GetLatencyStats().
+struct LatencySummary {
+  enum class Stage {
+    kFileIo = 0,
+    kEncryption = 1,
+    kSocketIo = 2,
+  };
+
+  Medium medium;
+  PayloadDirection direction;
+  Stage stage;
+  // The number of frames for which the stage was measured.
+  int64_t count = 0;
+  absl::Duration mean;
+  absl::Duration p50;
+  absl::Duration p90;
+  absl::Duration p99;
+  absl::Duration max;
+};
+
+}  // namespace connections
+}  // namespace nearby
+
+#endif  // CORE_LATENCY_SUMMARY_H_
@@ -52,6 +52,13 @@ class DataSet {
       absl::AnyInvocable<void(bool, std::unique_ptr<std::vector<T>>) &&>
           callback) = 0;
 
+  // Asynchronously loads the entries whose key starts with `prefix`, in key
+  // order, and invokes `callback` when complete.
+  virtual void LoadEntriesWithPrefix(
+      absl::string_view prefix,
+      absl::AnyInvocable<void(bool, std::unique_ptr<KeyEntryVector>) &&>
+          callback) = 0;
+
   // Asynchronously loads an entry from the database with key `key` and invokes
   // `callback` when complete.
   virtual void LoadEntry(
@@ -59,9 +66,9 @@ class DataSet {
       absl::AnyInvocable<void(bool, std::unique_ptr<T>) &&> callback) = 0;
 
   // Asynchronously saves `entries_to_save` and deletes entries from
-  // `keys_to_remove` from the database. `callback` will be invoked on the
-  // calling thread when complete. `entries_to_save` and `keys_to_remove` must
-  // be non-null.
+  // `keys_to_remove` from the database, as a single atomic update. `callback`
+  // will be invoked on the calling thread when complete. `entries_to_save` and
+  // `keys_to_remove` must be non-null.
   virtual void UpdateEntries(
       std::unique_ptr<KeyEntryVector> entries_to_save,
       std::unique_ptr<std::vector<std::string>> keys_to_remove,
@@ -22,12 +22,15 @@
 #include <vector>
 
 #include "absl/functional/any_invocable.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "third_party/leveldb/include/db.h"
 #include "third_party/leveldb/include/iterator.h"
 #include "third_party/leveldb/include/options.h"
 #include "third_party/leveldb/include/slice.h"
 #include "third_party/leveldb/include/status.h"
+#include "third_party/leveldb/include/write_batch.h"
 #include "internal/data/data_set.h"
 #include "internal/platform/logging.h"
 #include "google/protobuf/message_lite.h"
@@ -58,12 +61,29 @@ class LeveldbDataSet : public DataSet<T> {
           void(bool,
                std::unique_ptr<std::vector<std::pair<std::string, T>>>) &&>
           callback);
+  void LoadEntriesWithPrefix(
+      absl::string_view prefix,
+      absl::AnyInvocable<void(bool, std::unique_ptr<KeyEntryVector>) &&>
+          callback) override;
+  // Calls `visitor` for each entry whose key starts with `prefix`, in key
+  // order, without keeping the entries in memory. `key` and `value` are only
+  // valid during the call. Returns false if the database couldn't be read.
+  bool VisitEntries(
+      absl::string_view prefix,
+      absl::FunctionRef<void(absl::string_view key, const T& value)> visitor);
   void UpdateEntries(std::unique_ptr<KeyEntryVector> entries_to_save,
                      std::unique_ptr<std::vector<std::string>> keys_to_remove,
                      absl::AnyInvocable<void(bool) &&> callback) override;
   void Destroy(absl::AnyInvocable<void(bool) &&> callback) override;
 
  private:
+  // Calls `callback` with the key and the serialized value of each entry whose
+  // key starts with `prefix`, without copying them out of the iterator.
+  bool ForEachSerializedEntry(
+      absl::string_view prefix,
+      absl::FunctionRef<void(absl::string_view key,
+                             absl::string_view serialized)>
+          callback);
   void Serialize(T const& value, std::string& str);
   void Deserialize(absl::string_view str, T& value);
 
@@ -111,16 +131,13 @@ void LeveldbDataSet<T, isMessageLite>::LoadEntries(
     return;
   }
 
-  std::unique_ptr<leveldb::Iterator> it(
-      db_->NewIterator(leveldb::ReadOptions()));
-
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    T value;
-    Deserialize(it->value().ToString(), value);
-    result->push_back(value);
-  }
+  bool success = ForEachSerializedEntry(
+      /*prefix=*/"",
+      [this, &result](absl::string_view key, absl::string_view serialized) {
+        Deserialize(serialized, result->emplace_back());
+      });
 
-  if (it->status().ok()) {
+  if (success) {
     LOG(INFO) << "Loaded " << result->size() << " entries from database.";
     std::move(callback)(true, std::move(result));
   } else {
@@ -165,16 +182,14 @@ void LeveldbDataSet<T, isMessageLite>::LoadEntriesWithKeys(
     return;
   }
 
-  std::unique_ptr<leveldb::Iterator> it(
-      db_->NewIterator(leveldb::ReadOptions()));
-
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    T value;
-    Deserialize(it->value().ToString(), value);
-    result->push_back({it->key().ToString(), value});
-  }
+  bool success = ForEachSerializedEntry(
+      /*prefix=*/"",
+      [this, &result](absl::string_view key, absl::string_view serialized) {
+        Deserialize(serialized,
+                    result->emplace_back(std::string(key), T()).second);
+      });
 
-  if (it->status().ok()) {
+  if (success) {
     LOG(INFO) << "Loaded " << result->size() << " entries from database.";
     std::move(callback)(true, std::move(result));
   } else {
@@ -184,6 +199,78 @@ void LeveldbDataSet<T, isMessageLite>::LoadEntriesWithKeys(
   }
 }
 
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+void LeveldbDataSet<T, isMessageLite>::LoadEntriesWithPrefix(
+    absl::string_view prefix,
+    absl::AnyInvocable<void(bool, std::unique_ptr<KeyEntryVector>) &&>
+        callback) {
+  auto result = std::make_unique<KeyEntryVector>();
+  if (status_ != InitStatus::kOK) {
+    std::move(callback)(false, std::move(result));
+    return;
+  }
+
+  bool success = ForEachSerializedEntry(
+      prefix,
+      [this, &result](absl::string_view key, absl::string_view serialized) {
+        Deserialize(serialized,
+                    result->emplace_back(std::string(key), T()).second);
+      });
+
+  if (success) {
+    LOG(INFO) << "Loaded " << result->size()
+              << " entries from database with prefix: " << prefix;
+    std::move(callback)(true, std::move(result));
+  } else {
+    LOG(INFO) << "Failed to load entries from database with prefix: "
+              << prefix;
+    result->clear();
+    std::move(callback)(false, std::move(result));
+  }
+}
+
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+bool LeveldbDataSet<T, isMessageLite>::VisitEntries(
+    absl::string_view prefix,
+    absl::FunctionRef<void(absl::string_view key, const T& value)> visitor) {
+  if (status_ != InitStatus::kOK) {
+    return false;
+  }
+
+  // Values are parsed into a reused message.
+  T value;
+  return ForEachSerializedEntry(
+      prefix, [this, &value, &visitor](absl::string_view key,
+                                       absl::string_view serialized) {
+        value.Clear();
+        Deserialize(serialized, value);
+        visitor(key, value);
+      });
+}
+
+template <typename T,
+          std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
+              isMessageLite>
+bool LeveldbDataSet<T, isMessageLite>::ForEachSerializedEntry(
+    absl::string_view prefix,
+    absl::FunctionRef<void(absl::string_view key, absl::string_view serialized)>
+        callback) {
+  std::unique_ptr<leveldb::Iterator> it(
+      db_->NewIterator(leveldb::ReadOptions()));
+  for (it->Seek(leveldb::Slice(prefix.data(), prefix.size())); it->Valid();
+       it->Next()) {
+    absl::string_view key(it->key().data(), it->key().size());
+    // Keys are sorted, so the entries with the prefix are contiguous.
+    if (!absl::StartsWith(key, prefix)) break;
+    callback(key, absl::string_view(it->value().data(), it->value().size()));
+  }
+  return it->status().ok();
+}
+
 template <typename T,
           std::enable_if_t<std::is_base_of<proto2::MessageLite, T>::value, bool>
               isMessageLite>
@@ -197,21 +284,28 @@ void LeveldbDataSet<T, isMessageLite>::UpdateEntries(
     return;
   }
 
+  // Commit all changes in one write, so that they are applied atomically and
+  // the log is only appended once.
+  leveldb::WriteBatch batch;
   if (entries_to_save != nullptr) {
+    std::string str;
     for (const auto& [key, value] : *entries_to_save) {
-      std::string str;
       Serialize(value, str);
-      db_->Put(leveldb::WriteOptions(), key, leveldb::Slice(str));
+      batch.Put(key, leveldb::Slice(str));
     }
   }
 
   if (keys_to_remove != nullptr) {
     for (const auto& it : *keys_to_remove) {
-      db_->Delete(leveldb::WriteOptions(), it);
+      batch.Delete(it);
     }
   }
 
-  std::move(callback)(true);
+  leveldb::Status status = db_->Write(leveldb::WriteOptions(), &batch);
+  if (!status.ok()) {
+    LOG(INFO) << "Failed to update entries in database.";
+  }
+  std::move(callback)(status.ok());
 }
 
 template <typename T,
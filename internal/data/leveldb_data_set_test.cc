@@ -29,6 +29,7 @@
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "internal/data/data_set.h"
@@ -37,6 +38,7 @@
 namespace nearby::data {
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::SizeIs;
 
 // Generate a unique directory under temp directory for leveldb storage
@@ -283,5 +285,102 @@ TEST(LeveldbDataSet, RemoveEntriesDiceRoll) {
   EXPECT_EQ(result["id4"].nickname(), diceroll4.nickname());
 }
 
+TEST(LeveldbDataSet, LoadEntriesWithPrefixDiceRoll) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  InitializeAndWait(diceroll_set);
+
+  auto entries = LeveldbDataSet<DiceRoll>::KeyEntryVector(
+      {{"a/1", GenerateDiceRoll(2)},
+       {"b/1", GenerateDiceRoll(12)},
+       {"b/2", GenerateDiceRoll(5)},
+       {"c/1", GenerateDiceRoll(7)}});
+  auto data =
+      std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>(entries);
+  UpdateEntriesAndWait(diceroll_set, std::move(data), nullptr);
+
+  bool success = false;
+  std::unique_ptr<LeveldbDataSet<DiceRoll>::KeyEntryVector> result;
+  absl::Notification notification;
+  diceroll_set->LoadEntriesWithPrefix(
+      "b/",
+      [&success, &result, &notification](
+          bool res,
+          std::unique_ptr<LeveldbDataSet<DiceRoll>::KeyEntryVector> loaded) {
+        success = res;
+        result = std::move(loaded);
+        notification.Notify();
+      });
+  notification.WaitForNotificationWithTimeout(absl::Seconds(5));
+  WipeCleanAndWait(diceroll_set, path);
+
+  EXPECT_TRUE(success);
+  ASSERT_THAT(*result, SizeIs(2));
+  EXPECT_EQ((*result)[0].first, "b/1");
+  EXPECT_EQ((*result)[0].second.value(), 12);
+  EXPECT_EQ((*result)[1].first, "b/2");
+  EXPECT_EQ((*result)[1].second.value(), 5);
+}
+
+TEST(LeveldbDataSet, VisitEntriesDiceRoll) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  InitializeAndWait(diceroll_set);
+
+  auto entries = LeveldbDataSet<DiceRoll>::KeyEntryVector(
+      {{"id1", GenerateDiceRoll(2)}, {"id2", GenerateDiceRoll(7)}});
+  auto data =
+      std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>(entries);
+  UpdateEntriesAndWait(diceroll_set, std::move(data), nullptr);
+
+  std::vector<std::string> keys;
+  std::vector<int> values;
+  bool success = diceroll_set->VisitEntries(
+      /*prefix=*/"", [&keys, &values](absl::string_view key,
+                                      const DiceRoll& value) {
+        keys.push_back(std::string(key));
+        values.push_back(value.value());
+      });
+  WipeCleanAndWait(diceroll_set, path);
+
+  EXPECT_TRUE(success);
+  EXPECT_THAT(keys, ElementsAre("id1", "id2"));
+  EXPECT_THAT(values, ElementsAre(2, 7));
+}
+
+TEST(LeveldbDataSet, UpdateEntriesSavesAndRemovesInOneUpdate) {
+  std::filesystem::path path = GenerateLeveldbPath();
+  std::unique_ptr<LeveldbDataSet<DiceRoll>> diceroll_set =
+      CreateDataSet<DiceRoll>(path);
+
+  InitializeAndWait(diceroll_set);
+
+  auto entries = LeveldbDataSet<DiceRoll>::KeyEntryVector(
+      {{"id1", GenerateDiceRoll(2)}});
+  auto data =
+      std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>(entries);
+  UpdateEntriesAndWait(diceroll_set, std::move(data), nullptr);
+
+  // Replacing an entry and removing it in the same update removes it.
+  auto replacement = std::make_unique<LeveldbDataSet<DiceRoll>::KeyEntryVector>(
+      LeveldbDataSet<DiceRoll>::KeyEntryVector(
+          {{"id1", GenerateDiceRoll(3)}, {"id2", GenerateDiceRoll(4)}}));
+  auto keys_to_remove = std::make_unique<std::vector<std::string>>(
+      std::vector<std::string>({"id1"}));
+  bool success = UpdateEntriesAndWait(diceroll_set, std::move(replacement),
+                                      std::move(keys_to_remove));
+
+  auto result = LoadEntriesWithKeysAndWait(diceroll_set);
+  WipeCleanAndWait(diceroll_set, path);
+
+  EXPECT_TRUE(success);
+  EXPECT_THAT(result, SizeIs(1));
+  EXPECT_EQ(result["id2"].value(), 4);
+}
+
 }  // namespace
 }  // namespace nearby::data
@@ -15,14 +15,21 @@
 #ifndef PLATFORM_PUBLIC_ARRAY_BLOCKING_QUEUE_H_
 #define PLATFORM_PUBLIC_ARRAY_BLOCKING_QUEUE_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <optional>
-#include <queue>
+#include <utility>
+#include <vector>
 
+#include "absl/base/optimization.h"
+#include "absl/time/time.h"
 #include "internal/platform/condition_variable.h"
-#include "internal/platform/logging.h"
 #include "internal/platform/mutex.h"
 #include "internal/platform/mutex_lock.h"
+#include "internal/platform/system_clock.h"
 
 namespace nearby {
 
@@ -31,72 +38,235 @@ namespace nearby {
  * ArrayBlockingQueue before sending to ensure each client has equal chance to
  * send its data. Since C++ doesn't provide ArrayBlockingQueue as Java, we
  * implement one here.
+ *
+ * The elements live in a fixed ring of |capacity| slots, each with a sequence
+ * number telling whether it is ready to be written or read, so Try*() calls
+ * never take a lock. Blocking calls only lock to sleep while the queue is
+ * full or empty, and are woken up by the calls on the other side. Elements
+ * are moved in and out of the queue, so T may be move-only.
  */
 template <typename T>
 class ArrayBlockingQueue {
  public:
-  explicit ArrayBlockingQueue(size_t capacity) : capacity_(capacity) {}
+  explicit ArrayBlockingQueue(size_t capacity)
+      : capacity_(std::max<size_t>(capacity, 1)),
+        slots_(std::make_unique<Slot[]>(capacity_)) {
+    for (size_t i = 0; i < capacity_; ++i) {
+      slots_[i].sequence.store(2 * i, std::memory_order_relaxed);
+    }
+  }
+  ArrayBlockingQueue(const ArrayBlockingQueue&) = delete;
+  ArrayBlockingQueue& operator=(const ArrayBlockingQueue&) = delete;
 
-  void Put(const T& value) {
-    MutexLock lock(&queue_mutex_);
-    if (queue_.size() >= capacity_) {
-      has_space_.Wait();
+  // Blocks while the queue is full.
+  void Put(const T& value) { Put(T(value)); }
+  void Put(T&& value) {
+    if (TryPut(std::move(value))) return;
+    {
+      MutexLock lock(&mutex_);
+      put_waiters_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while (!TryEnqueue(value)) {
+        has_space_.Wait();
+      }
+      put_waiters_.fetch_sub(1, std::memory_order_relaxed);
     }
-    queue_.push(value);
-    NEARBY_LOGS(INFO) << "ArrayBlockingQueue::Put()";
-    has_data_.Notify();
+    NotifyTakers();
   }
 
+  // Blocks while the queue is empty.
   T Take() {
-    MutexLock lock(&queue_mutex_);
-    if (queue_.empty()) {
-      has_data_.Wait();
+    std::optional<T> value = TryTake();
+    if (value.has_value()) return *std::move(value);
+    {
+      MutexLock lock(&mutex_);
+      take_waiters_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while (!(value = TryDequeue()).has_value()) {
+        has_data_.Wait();
+      }
+      take_waiters_.fetch_sub(1, std::memory_order_relaxed);
     }
-    T front = queue_.front();
-    queue_.pop();
-    NEARBY_LOGS(INFO) << "ArrayBlockingQueue::Take()";
-    has_space_.Notify();
-    return front;
+    NotifyPutters();
+    return *std::move(value);
   }
 
-  bool TryPut(const T& value) {
-    MutexLock lock(&queue_mutex_);
-    if (queue_.size() < capacity_) {
-      queue_.push(value);
-      has_data_.Notify();
-      return true;
+  // Returns false if the queue is full. |value| is only moved from on
+  // success.
+  bool TryPut(const T& value) { return TryPut(T(value)); }
+  bool TryPut(T&& value) {
+    if (!TryEnqueue(value)) return false;
+    NotifyTakers();
+    return true;
+  }
+
+  // Same as TryPut(), but waits up to |timeout| for space in the queue.
+  bool TryPut(T&& value, absl::Duration timeout) {
+    if (TryPut(std::move(value))) return true;
+    absl::Time deadline = SystemClock::ElapsedRealtime() + timeout;
+    bool enqueued = false;
+    {
+      MutexLock lock(&mutex_);
+      put_waiters_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while (!(enqueued = TryEnqueue(value))) {
+        absl::Duration remaining = deadline - SystemClock::ElapsedRealtime();
+        if (remaining <= absl::ZeroDuration()) break;
+        has_space_.Wait(remaining);
+      }
+      put_waiters_.fetch_sub(1, std::memory_order_relaxed);
     }
-    return false;
+    if (enqueued) NotifyTakers();
+    return enqueued;
   }
 
   // Returns std::nullopt if the queue is empty.
   std::optional<T> TryTake() {
-    MutexLock lock(&queue_mutex_);
-    if (!queue_.empty()) {
-      T front = queue_.front();
-      queue_.pop();
-      has_space_.Notify();
-      return front;
+    std::optional<T> value = TryDequeue();
+    if (value.has_value()) NotifyPutters();
+    return value;
+  }
+
+  // Same as TryTake(), but waits up to |timeout| for an element.
+  std::optional<T> TryTake(absl::Duration timeout) {
+    std::optional<T> value = TryTake();
+    if (value.has_value()) return value;
+    absl::Time deadline = SystemClock::ElapsedRealtime() + timeout;
+    {
+      MutexLock lock(&mutex_);
+      take_waiters_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      while (!(value = TryDequeue()).has_value()) {
+        absl::Duration remaining = deadline - SystemClock::ElapsedRealtime();
+        if (remaining <= absl::ZeroDuration()) break;
+        has_data_.Wait(remaining);
+      }
+      take_waiters_.fetch_sub(1, std::memory_order_relaxed);
     }
-    return std::nullopt;
+    if (value.has_value()) NotifyPutters();
+    return value;
   }
 
-  size_t Size() const {
-    MutexLock lock(&queue_mutex_);
-    return queue_.size();
+  // Takes up to |max_count| elements without blocking, in queue order.
+  std::vector<T> TakeUpTo(size_t max_count) {
+    std::vector<T> values;
+    while (values.size() < max_count) {
+      std::optional<T> value = TryDequeue();
+      if (!value.has_value()) break;
+      values.push_back(*std::move(value));
+    }
+    if (!values.empty()) NotifyPutters();
+    return values;
   }
 
-  bool Empty() const {
-    MutexLock lock(&queue_mutex_);
-    return queue_.empty();
+  // Takes all the elements currently in the queue without blocking.
+  std::vector<T> TakeAll() { return TakeUpTo(capacity_); }
+
+  // The result may be stale by the time it is used if other threads are
+  // accessing the queue.
+  size_t Size() const {
+    size_t dequeue_pos = dequeue_pos_.load(std::memory_order_acquire);
+    size_t enqueue_pos = enqueue_pos_.load(std::memory_order_acquire);
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
   }
 
+  bool Empty() const { return Size() == 0; }
+
  private:
-  std::queue<T> queue_;
-  mutable Mutex queue_mutex_;
-  ConditionVariable has_data_{&queue_mutex_};
-  ConditionVariable has_space_{&queue_mutex_};
+  struct Slot {
+    // Equals 2 * the position of the next Put() into this slot when it is
+    // free, and that + 1 once the element is written. Doubling the position
+    // keeps the two states apart when the capacity is 1.
+    std::atomic<size_t> sequence;
+    std::optional<T> value;
+  };
+
+  // Moves |value| into the queue unless it's full.
+  bool TryEnqueue(T& value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos % capacity_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(2 * pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The slot still holds the element written |capacity_| Put()s ago.
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value.emplace(std::move(value));
+    slot->sequence.store(2 * pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves the oldest element out of the queue unless it's empty.
+  std::optional<T> TryDequeue() {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[pos % capacity_];
+      size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) -
+                      static_cast<intptr_t>(2 * pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The element for this position has not been written yet.
+        return std::nullopt;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    std::optional<T> value = std::move(slot->value);
+    slot->value.reset();
+    slot->sequence.store(2 * (pos + capacity_), std::memory_order_release);
+    return value;
+  }
+
+  // Wakes up the blocked Take() calls, if any. The fence pairs with the one
+  // in the blocking calls, so that either they see the new element, or we see
+  // them waiting.
+  void NotifyTakers() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (take_waiters_.load(std::memory_order_relaxed) > 0) {
+      MutexLock lock(&mutex_);
+      has_data_.Notify();
+    }
+  }
+
+  void NotifyPutters() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (put_waiters_.load(std::memory_order_relaxed) > 0) {
+      MutexLock lock(&mutex_);
+      has_space_.Notify();
+    }
+  }
+
   const size_t capacity_;
+  const std::unique_ptr<Slot[]> slots_;
+  // Kept on separate cache lines, so that producers and consumers don't slow
+  // each other down.
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<size_t> enqueue_pos_{0};
+  alignas(ABSL_CACHELINE_SIZE) std::atomic<size_t> dequeue_pos_{0};
+
+  // Only used by the blocking calls, to sleep while the queue is full or
+  // empty.
+  alignas(ABSL_CACHELINE_SIZE) Mutex mutex_;
+  ConditionVariable has_data_{&mutex_};
+  ConditionVariable has_space_{&mutex_};
+  std::atomic<int> put_waiters_{0};
+  std::atomic<int> take_waiters_{0};
 };
 
 }  // namespace nearby
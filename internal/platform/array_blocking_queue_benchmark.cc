@@ -0,0 +1,80 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks the throughput of ArrayBlockingQueue, uncontended and with a
+// growing number of producers feeding a fixed number of consumers.
+//
+// Run with
+//   bazel run -c opt //internal/platform:array_blocking_queue_benchmark
+
+#include <cstdint>
+#include <optional>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "internal/platform/array_blocking_queue.h"
+
+namespace nearby {
+namespace {
+
+constexpr int kCapacity = 16;
+constexpr int kNumConsumers = 4;
+constexpr int kElementsPerProducer = 20000;
+
+void BM_TryPutTryTake(benchmark::State& state) {
+  ArrayBlockingQueue<int> queue(kCapacity);
+
+  for (auto _ : state) {
+    queue.TryPut(1);
+    benchmark::DoNotOptimize(queue.TryTake());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TryPutTryTake);
+
+void BM_PutTakeContended(benchmark::State& state) {
+  const int num_producers = state.range(0);
+  const int total = num_producers * kElementsPerProducer;
+
+  for (auto _ : state) {
+    ArrayBlockingQueue<int> queue(kCapacity);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < num_producers; ++p) {
+      threads.emplace_back([&queue]() {
+        for (int i = 0; i < kElementsPerProducer; ++i) {
+          queue.Put(i);
+        }
+      });
+    }
+    for (int c = 0; c < kNumConsumers; ++c) {
+      threads.emplace_back([&queue, c, total]() {
+        for (int i = c; i < total; i += kNumConsumers) {
+          benchmark::DoNotOptimize(queue.Take());
+        }
+      });
+    }
+    for (std::thread& thread : threads) thread.join();
+  }
+  state.SetItemsProcessed(state.iterations() * total);
+}
+BENCHMARK(BM_PutTakeContended)
+    ->ArgName("producers")
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(16)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace nearby
@@ -0,0 +1,176 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/array_blocking_queue.h"
+
+#include <memory>
+#include <optional>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace nearby {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(ArrayBlockingQueueTest, TakesInPutOrder) {
+  ArrayBlockingQueue<int> queue(3);
+
+  queue.Put(1);
+  queue.Put(2);
+  queue.Put(3);
+
+  EXPECT_EQ(queue.Size(), 3);
+  EXPECT_EQ(queue.Take(), 1);
+  EXPECT_EQ(queue.Take(), 2);
+  EXPECT_EQ(queue.Take(), 3);
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(ArrayBlockingQueueTest, TryPutFailsWhenFull) {
+  ArrayBlockingQueue<int> queue(2);
+
+  EXPECT_TRUE(queue.TryPut(1));
+  EXPECT_TRUE(queue.TryPut(2));
+  EXPECT_FALSE(queue.TryPut(3));
+  EXPECT_EQ(queue.TryTake(), 1);
+  EXPECT_TRUE(queue.TryPut(3));
+  EXPECT_THAT(queue.TakeAll(), ElementsAre(2, 3));
+}
+
+TEST(ArrayBlockingQueueTest, TryTakeReturnsNulloptWhenEmpty) {
+  ArrayBlockingQueue<int> queue(2);
+
+  EXPECT_EQ(queue.TryTake(), std::nullopt);
+}
+
+TEST(ArrayBlockingQueueTest, SupportsMoveOnlyElements) {
+  ArrayBlockingQueue<std::unique_ptr<int>> queue(1);
+
+  queue.Put(std::make_unique<int>(1));
+  std::unique_ptr<int> value = std::make_unique<int>(2);
+  EXPECT_FALSE(queue.TryPut(std::move(value)));
+  // A failed TryPut() leaves the value alone.
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(*value, 2);
+
+  EXPECT_EQ(*queue.Take(), 1);
+  EXPECT_TRUE(queue.TryPut(std::move(value)));
+  EXPECT_EQ(*queue.TryTake().value(), 2);
+}
+
+TEST(ArrayBlockingQueueTest, TakeUpToTakesAtMostCount) {
+  ArrayBlockingQueue<int> queue(4);
+  for (int i = 0; i < 4; ++i) queue.Put(i);
+
+  EXPECT_THAT(queue.TakeUpTo(3), ElementsAre(0, 1, 2));
+  EXPECT_THAT(queue.TakeUpTo(3), ElementsAre(3));
+  EXPECT_THAT(queue.TakeUpTo(3), IsEmpty());
+}
+
+TEST(ArrayBlockingQueueTest, TimedTryTakeTimesOut) {
+  ArrayBlockingQueue<int> queue(1);
+  absl::Time start = absl::Now();
+
+  EXPECT_EQ(queue.TryTake(absl::Milliseconds(50)), std::nullopt);
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(50));
+}
+
+TEST(ArrayBlockingQueueTest, TimedTryPutTimesOut) {
+  ArrayBlockingQueue<int> queue(1);
+  queue.Put(1);
+  absl::Time start = absl::Now();
+
+  EXPECT_FALSE(queue.TryPut(2, absl::Milliseconds(50)));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(50));
+  EXPECT_EQ(queue.Take(), 1);
+}
+
+TEST(ArrayBlockingQueueTest, TimedTryTakeWakesUpOnPut) {
+  ArrayBlockingQueue<int> queue(1);
+  std::thread producer([&queue]() {
+    absl::SleepFor(absl::Milliseconds(20));
+    queue.Put(1);
+  });
+
+  EXPECT_EQ(queue.TryTake(absl::Seconds(5)), 1);
+  producer.join();
+}
+
+TEST(ArrayBlockingQueueTest, PutBlocksUntilTake) {
+  ArrayBlockingQueue<int> queue(1);
+  queue.Put(1);
+  std::thread producer([&queue]() { queue.Put(2); });
+
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_EQ(queue.Size(), 1);
+  EXPECT_EQ(queue.Take(), 1);
+  EXPECT_EQ(queue.Take(), 2);
+  producer.join();
+}
+
+// Throughput under contention is measured by array_blocking_queue_benchmark.
+TEST(ArrayBlockingQueueTest, ConcurrentPutAndTakeDeliverEveryElementOnce) {
+  constexpr int kNumConsumers = 4;
+  constexpr int kElementsPerProducer = 10000;
+  constexpr int kNumProducers = 4;
+  ArrayBlockingQueue<int> queue(16);
+  std::vector<std::vector<int>> taken(kNumConsumers);
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kNumProducers; ++p) {
+    threads.emplace_back([&queue, p]() {
+      for (int i = 0; i < kElementsPerProducer; ++i) {
+        queue.Put(p * kElementsPerProducer + i);
+      }
+    });
+  }
+  const int total = kNumProducers * kElementsPerProducer;
+  for (int c = 0; c < kNumConsumers; ++c) {
+    threads.emplace_back([&queue, &taken, c, total]() {
+      // Consumers take turns on the elements, so that each of them knows
+      // how many to take.
+      for (int i = c; i < total; i += kNumConsumers) {
+        taken[c].push_back(queue.Take());
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  std::vector<int> counts(total);
+  for (const std::vector<int>& values : taken) {
+    // Each consumer sees the elements of a producer in the order they were
+    // put.
+    std::vector<int> last_taken(kNumProducers, -1);
+    for (int value : values) {
+      counts[value]++;
+      int producer = value / kElementsPerProducer;
+      ASSERT_GT(value, last_taken[producer]);
+      last_taken[producer] = value;
+    }
+  }
+  for (int value = 0; value < total; ++value) {
+    ASSERT_EQ(counts[value], 1) << "value " << value;
+  }
+  EXPECT_TRUE(queue.Empty());
+}
+
+}  // namespace
+}  // namespace nearby
@@ -111,6 +111,10 @@ class ByteArray {
     return absl::string_view(data(), size());
   }
 
+  // Returns a reference to the internal representation, for APIs that take a
+  // `const std::string&` and would otherwise force a copy of the data.
+  const std::string& AsString() const { return data_; }
+
   // Hashable
   template <typename H>
   friend H AbslHashValue(H h, const ByteArray& m) {
@@ -103,6 +103,13 @@ TEST(ByteArrayTest, CreateFromAbslStringReturnsTheSame) {
   EXPECT_EQ(bytes.AsStringView(), kTestString);
 }
 
+TEST(ByteArrayTest, AsStringReferencesInternalData) {
+  ByteArray bytes{std::string("Test String")};
+
+  EXPECT_EQ(bytes.AsString(), "Test String");
+  EXPECT_EQ(bytes.AsString().data(), bytes.data());
+}
+
 TEST(ByteArrayTest, IteratorTypes) {
   static_assert(std::same_as<decltype(std::declval<ByteArray>().begin()),
                              ByteArray::iterator>);
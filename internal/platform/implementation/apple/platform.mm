@@ -134,7 +134,10 @@ std::unique_ptr<OutputFile> ImplementationPlatform::CreateOutputFile(PayloadId p
 }
 
 std::unique_ptr<OutputFile> ImplementationPlatform::CreateOutputFile(const std::string& file_path) {
-  return shared::IOFile::CreateOutputFile(file_path);
+  // Incoming payloads arrive in small chunks; batch them into fewer writes.
+  return shared::IOFile::CreateOutputFile(
+      file_path,
+      {.buffer_size = 512 * 1024, .fsync_policy = shared::IOFile::FsyncPolicy::kNever});
 }
 
 // Java-like Executors
@@ -173,7 +173,10 @@ std::unique_ptr<OutputFile> ImplementationPlatform::CreateOutputFile(
       return nullptr;
     }
   }
-  return shared::IOFile::CreateOutputFile(file_path);
+  // Incoming payloads arrive in small chunks; batch them into fewer writes.
+  return shared::IOFile::CreateOutputFile(
+      file_path, {.buffer_size = 512 * 1024,
+                  .fsync_policy = shared::IOFile::FsyncPolicy::kNever});
 }
 
 std::unique_ptr<LogMessage> ImplementationPlatform::CreateLogMessage(
@@ -19,10 +19,12 @@
 #include <optional>
 #include <utility>
 
+#include "absl/functional/any_invocable.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "internal/platform/implementation/cancelable.h"
+#include "internal/platform/implementation/shared/timer_wheel.h"
 #include "internal/platform/medium_environment.h"
 #include "internal/platform/runnable.h"
 #include "internal/test/fake_clock.h"
@@ -37,11 +39,18 @@ class ScheduledCancelable : public api::Cancelable {
   bool Cancel() override {
     Status expected = kNotRun;
     if (status_.compare_exchange_strong(expected, kCanceled)) {
+      if (on_cancel_) on_cancel_();
       return true;
     }
     return false;
   }
 
+  // Sets a callback to release the task once canceled. Must be called before
+  // the Cancelable is shared.
+  void SetOnCancel(absl::AnyInvocable<void()> on_cancel) {
+    on_cancel_ = std::move(on_cancel);
+  }
+
   bool IsCanceled() const { return status_ == kCanceled; }
 
   bool MarkExecuted() {
@@ -61,6 +70,7 @@ class ScheduledCancelable : public api::Cancelable {
     kCanceled,
   };
   std::atomic<Status> status_ = kNotRun;
+  absl::AnyInvocable<void()> on_cancel_;
 };
 
 }  // namespace
@@ -68,6 +78,9 @@ class ScheduledCancelable : public api::Cancelable {
 ScheduledExecutor::ScheduledExecutor() {
   std::optional<FakeClock*> fake_clock =
       MediumEnvironment::Instance().GetSimulatedClock();
+  // The wheel starts at the simulated time, which is close to the real time.
+  simulated_timers_ = std::make_shared<SimulatedTimers>(
+      fake_clock.has_value() ? (*fake_clock)->Now() : absl::UnixEpoch());
   if (fake_clock.has_value()) {
     name_ = absl::StrFormat("G3 scheduled executor %p", this);
     (*fake_clock)->AddObserver(name_, [this]() { RunReadyTasks(); });
@@ -100,9 +113,26 @@ std::shared_ptr<api::Cancelable> ScheduledExecutor::Schedule(
       MediumEnvironment::Instance().GetSimulatedClock();
   if (fake_clock.has_value()) {
     absl::Time trigger_time = (*fake_clock)->Now() + delay;
-    absl::MutexLock lock(&mutex_);
-    tasks_.insert(std::pair<absl::Time, std::unique_ptr<Runnable>>(
-        trigger_time, std::make_unique<Runnable>(std::move(task))));
+    shared::TimerWheel::TimerId timer_id;
+    {
+      absl::MutexLock lock(&simulated_timers_->mutex);
+      timer_id =
+          simulated_timers_->wheel.Add(trigger_time, std::move(task));
+    }
+    // Drop the task as soon as it's canceled, instead of when it's due. The
+    // Cancelable may outlive this executor.
+    scheduled_cancelable->SetOnCancel(
+        [timers = std::weak_ptr<SimulatedTimers>(simulated_timers_),
+         timer_id]() {
+          std::shared_ptr<SimulatedTimers> locked_timers = timers.lock();
+          if (locked_timers == nullptr) return;
+          std::optional<Runnable> canceled_task;
+          {
+            absl::MutexLock lock(&locked_timers->mutex);
+            canceled_task = locked_timers->wheel.Cancel(timer_id);
+          }
+          // `canceled_task` is destroyed outside of the lock.
+        });
   } else {
     executor_.ScheduleAfter(delay, std::move(task));
   }
@@ -119,16 +149,9 @@ void ScheduledExecutor::RunReadyTasks() {
     return;
   }
   absl::Time current_time = (*fake_clock)->Now();
-  absl::MutexLock lock(&mutex_);
-  for (auto it = tasks_.begin(); it != tasks_.end();) {
-    if (it->first <= current_time) {
-      executor_.Execute(
-          [task = std::move(it->second)]() mutable { (*task)(); });
-      it = tasks_.erase(it);
-    } else {
-      // Tasks are sorted. We can stop iterating.
-      break;
-    }
+  absl::MutexLock lock(&simulated_timers_->mutex);
+  for (Runnable& task : simulated_timers_->wheel.Advance(current_time)) {
+    executor_.Execute(std::move(task));
   }
 }
 
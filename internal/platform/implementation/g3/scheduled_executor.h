@@ -20,11 +20,12 @@
 #include <string>
 #include <utility>
 
-#include "absl/container/btree_map.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "internal/platform/implementation/cancelable.h"
 #include "internal/platform/implementation/g3/single_thread_executor.h"
 #include "internal/platform/implementation/scheduled_executor.h"
+#include "internal/platform/implementation/shared/timer_wheel.h"
 #include "internal/platform/runnable.h"
 
 namespace nearby {
@@ -45,12 +46,19 @@ class ScheduledExecutor final : public api::ScheduledExecutor {
   void Shutdown() override { executor_.Shutdown(); }
 
  private:
+  // Tasks scheduled on the simulated clock. Shared with the returned
+  // Cancelables, which remove their task when canceled.
+  struct SimulatedTimers {
+    explicit SimulatedTimers(absl::Time start) : wheel(start) {}
+
+    absl::Mutex mutex;
+    shared::TimerWheel wheel ABSL_GUARDED_BY(mutex);
+  };
+
   void RunReadyTasks();
   SingleThreadExecutor executor_;
   std::string name_;
-  absl::Mutex mutex_;
-  absl::btree_multimap<absl::Time, std::unique_ptr<Runnable>> tasks_
-      ABSL_GUARDED_BY(mutex_);
+  std::shared_ptr<SimulatedTimers> simulated_timers_;
 };
 
 }  // namespace g3
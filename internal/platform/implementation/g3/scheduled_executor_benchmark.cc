@@ -0,0 +1,70 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks scheduling and canceling an alarm with a growing number of
+// alarms already pending. On the simulated clock the alarms are kept in a
+// shared::TimerWheel, on the real clock they go through the thread pool's
+// ScheduleAfter.
+//
+// Run with
+//   bazel run -c opt \
+//     //internal/platform/implementation/g3:scheduled_executor_benchmark
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/time/time.h"
+#include "internal/platform/implementation/cancelable.h"
+#include "internal/platform/implementation/g3/scheduled_executor.h"
+#include "internal/platform/medium_environment.h"
+
+namespace nearby {
+namespace g3 {
+namespace {
+
+// Far enough out that no alarm fires while the benchmark runs.
+constexpr absl::Duration kPendingDelay = absl::Hours(1);
+constexpr absl::Duration kDelay = absl::Minutes(10);
+
+void BM_ScheduleAndCancel(benchmark::State& state) {
+  bool use_simulated_clock = state.range(0) != 0;
+  MediumEnvironment::Instance().Start(
+      {.use_simulated_clock = use_simulated_clock});
+  {
+    ScheduledExecutor executor;
+    std::vector<std::shared_ptr<api::Cancelable>> pending;
+    for (int i = 0; i < state.range(1); ++i) {
+      pending.push_back(executor.Schedule([]() {}, kPendingDelay + i * kDelay));
+    }
+
+    for (auto _ : state) {
+      std::shared_ptr<api::Cancelable> cancelable =
+          executor.Schedule([]() {}, kDelay);
+      cancelable->Cancel();
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    for (auto& cancelable : pending) cancelable->Cancel();
+    executor.Shutdown();
+  }
+  MediumEnvironment::Instance().Stop();
+}
+BENCHMARK(BM_ScheduleAndCancel)
+    ->ArgNames({"simulated_clock", "pending"})
+    ->ArgsProduct({{0, 1}, {0, 1000, 100000}});
+
+}  // namespace
+}  // namespace g3
+}  // namespace nearby
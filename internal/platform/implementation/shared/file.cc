@@ -14,10 +14,14 @@
 
 #include "internal/platform/implementation/shared/file.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <cstddef>
 #include <ios>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
@@ -41,14 +45,22 @@ IOFile::IOFile(const absl::string_view file_path, size_t size)
 }
 
 std::unique_ptr<IOFile> IOFile::CreateOutputFile(const absl::string_view path) {
-  return std::unique_ptr<IOFile>(new IOFile(path));
+  return CreateOutputFile(path, WriteOptions());
+}
+
+std::unique_ptr<IOFile> IOFile::CreateOutputFile(const absl::string_view path,
+                                                 const WriteOptions& options) {
+  return absl::WrapUnique(new IOFile(path, options));
 }
 
-IOFile::IOFile(const absl::string_view file_path)
-    : file_(), path_(file_path), total_size_(0) {
+IOFile::IOFile(const absl::string_view file_path, const WriteOptions& options)
+    : file_(), path_(file_path), total_size_(0), write_options_(options) {
   file_.open(path_, std::ios::binary | std::ios::out);
+  write_buffer_.reserve(write_options_.buffer_size);
 }
 
+IOFile::~IOFile() { Close(); }
+
 ExceptionOr<ByteArray> IOFile::Read(std::int64_t size) {
   if (!file_.is_open()) {
     return ExceptionOr<ByteArray>{Exception::kIo};
@@ -62,22 +74,29 @@ ExceptionOr<ByteArray> IOFile::Read(std::int64_t size) {
     return ExceptionOr<ByteArray>{Exception::kIo};
   }
 
-  ByteArray bytes(size);
-  std::unique_ptr<char[]> read_bytes{new char[size]};
-  file_.read(read_bytes.get(), static_cast<ptrdiff_t>(size));
+  // Read straight into the storage of the returned ByteArray.
+  std::string read_bytes(size, '\0');
+  file_.read(read_bytes.data(), static_cast<ptrdiff_t>(size));
   auto num_bytes_read = file_.gcount();
   if (num_bytes_read == 0) {
     return ExceptionOr<ByteArray>{Exception::kIo};
   }
 
-  return ExceptionOr<ByteArray>(ByteArray(read_bytes.get(), num_bytes_read));
+  read_bytes.resize(num_bytes_read);
+  return ExceptionOr<ByteArray>(ByteArray(std::move(read_bytes)));
 }
 
 Exception IOFile::Close() {
-  if (file_.is_open()) {
-    file_.close();
+  if (!file_.is_open()) {
+    return {Exception::kSuccess};
   }
-  return {Exception::kSuccess};
+  bool success = WriteBuffer();
+  file_.close();
+  success = !file_.fail() && success;
+  if (success && write_options_.fsync_policy != FsyncPolicy::kNever) {
+    success = Fsync();
+  }
+  return {success ? Exception::kSuccess : Exception::kIo};
 }
 
 Exception IOFile::Write(const ByteArray& data) {
@@ -89,14 +108,55 @@ Exception IOFile::Write(const ByteArray& data) {
     return {Exception::kIo};
   }
 
+  if (write_buffer_.size() + data.size() <= write_options_.buffer_size) {
+    write_buffer_.append(data.data(), data.size());
+    return {Exception::kSuccess};
+  }
+
+  // The chunk doesn't fit, write out what is buffered so far. A chunk that is
+  // at least as large as the buffer is not worth copying.
+  if (!WriteBuffer()) {
+    return {Exception::kIo};
+  }
+  if (data.size() < write_options_.buffer_size) {
+    write_buffer_.append(data.data(), data.size());
+    return {Exception::kSuccess};
+  }
   file_.write(data.data(), data.size());
   file_.flush();
   return {file_.good() ? Exception::kSuccess : Exception::kIo};
 }
 
 Exception IOFile::Flush() {
+  bool success = WriteBuffer();
   file_.flush();
-  return {file_.good() ? Exception::kSuccess : Exception::kIo};
+  success = file_.good() && success;
+  if (success && write_options_.fsync_policy == FsyncPolicy::kOnFlush) {
+    success = Fsync();
+  }
+  return {success ? Exception::kSuccess : Exception::kIo};
+}
+
+bool IOFile::WriteBuffer() {
+  if (write_buffer_.empty()) {
+    return true;
+  }
+  file_.write(write_buffer_.data(), write_buffer_.size());
+  file_.flush();
+  write_buffer_.clear();
+  return file_.good();
+}
+
+bool IOFile::Fsync() {
+  // std::fstream doesn't expose its file descriptor; fsync() through a new
+  // one flushes the same file.
+  int fd = ::open(path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool success = ::fsync(fd) == 0;
+  ::close(fd);
+  return success;
 }
 
 }  // namespace shared
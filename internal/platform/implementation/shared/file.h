@@ -17,6 +17,7 @@
 
 #include <cstdint>
 #include <fstream>
+#include <memory>
 #include <string>
 
 #include "absl/strings/string_view.h"
@@ -29,10 +30,32 @@ namespace shared {
 
 class IOFile final : public api::InputFile, public api::OutputFile {
  public:
+  // When to fsync() an output file.
+  enum class FsyncPolicy {
+    kNever,
+    // On Close().
+    kOnClose,
+    // On every Flush() and on Close().
+    kOnFlush,
+  };
+
+  struct WriteOptions {
+    // Data passed to Write() is kept in memory until this many bytes are
+    // buffered, or until Flush() or Close() is called. 0 writes every chunk
+    // through to the file.
+    size_t buffer_size = 0;
+    FsyncPolicy fsync_policy = FsyncPolicy::kNever;
+  };
+
   static std::unique_ptr<IOFile> CreateInputFile(
       const absl::string_view file_path, size_t size);
 
   static std::unique_ptr<IOFile> CreateOutputFile(const absl::string_view path);
+  static std::unique_ptr<IOFile> CreateOutputFile(const absl::string_view path,
+                                                  const WriteOptions& options);
+
+  // Closes the file, so data that is still buffered is not lost.
+  ~IOFile() override;
 
   ExceptionOr<ByteArray> Read(std::int64_t size) override;
 
@@ -46,11 +69,17 @@ class IOFile final : public api::InputFile, public api::OutputFile {
 
  private:
   explicit IOFile(const absl::string_view file_path, size_t size);
-  explicit IOFile(const absl::string_view file_path);
+  IOFile(const absl::string_view file_path, const WriteOptions& options);
+
+  // Writes the buffered data to the file.
+  bool WriteBuffer();
+  bool Fsync();
 
   std::fstream file_;
   std::string path_;
   std::int64_t total_size_;
+  WriteOptions write_options_;
+  std::string write_buffer_;
 };
 
 }  // namespace shared
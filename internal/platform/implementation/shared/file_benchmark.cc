@@ -0,0 +1,76 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks writing an incoming file payload through IOFile, chunk by chunk
+// as PayloadManager does, with and without a write buffer and for each fsync
+// policy.
+//
+// Run with
+//   bazel run -c opt //internal/platform/implementation/shared:file_benchmark
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "file/util/temp_path.h"
+#include "benchmark/benchmark.h"
+#include "internal/platform/byte_array.h"
+#include "internal/platform/exception.h"
+#include "internal/platform/implementation/shared/file.h"
+
+namespace nearby {
+namespace shared {
+namespace {
+
+constexpr size_t kChunkSize = 64 * 1024;
+constexpr int64_t kFileSize = 8 * 1024 * 1024;
+
+void BM_WriteFile(benchmark::State& state) {
+  IOFile::WriteOptions options = {
+      .buffer_size = static_cast<size_t>(state.range(0)),
+      .fsync_policy = static_cast<IOFile::FsyncPolicy>(state.range(1))};
+  TempPath temp_path(TempPath::Local);
+  std::string path = temp_path.path() + "/file.bin";
+  ByteArray chunk(std::string(kChunkSize, 'a'));
+
+  for (auto _ : state) {
+    std::unique_ptr<IOFile> file = IOFile::CreateOutputFile(path, options);
+    for (int64_t written = 0; written < kFileSize; written += kChunkSize) {
+      if (!file->Write(chunk).Ok() ||
+          (options.fsync_policy == IOFile::FsyncPolicy::kOnFlush &&
+           !file->Flush().Ok())) {
+        state.SkipWithError("Failed to write the file.");
+        return;
+      }
+    }
+    if (!file->Close().Ok()) {
+      state.SkipWithError("Failed to close the file.");
+      return;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kFileSize);
+}
+BENCHMARK(BM_WriteFile)
+    ->ArgNames({"buffer_size", "fsync_policy"})
+    ->ArgsProduct(
+        {{0, 512 * 1024},
+         {static_cast<int64_t>(IOFile::FsyncPolicy::kNever),
+          static_cast<int64_t>(IOFile::FsyncPolicy::kOnClose),
+          static_cast<int64_t>(IOFile::FsyncPolicy::kOnFlush)}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
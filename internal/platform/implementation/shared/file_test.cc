@@ -145,5 +145,64 @@ TEST_F(FileTest, IOFile_CloseOutput) {
   EXPECT_EQ(io_file->Write(bytes), Exception{Exception::kIo});
 }
 
+TEST_F(FileTest, IOFile_BufferedWriteIsDeferredUntilFlush) {
+  auto io_file_output = shared::IOFile::CreateOutputFile(
+      path_, {.buffer_size = 4});
+  EXPECT_EQ(io_file_output->Write(ByteArray("ab")),
+            Exception{Exception::kSuccess});
+  EXPECT_EQ(io_file_output->Write(ByteArray("c")),
+            Exception{Exception::kSuccess});
+  auto io_file_input = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEmpty(io_file_input->Read(kMaxSize));
+
+  EXPECT_EQ(io_file_output->Flush(), Exception{Exception::kSuccess});
+  io_file_input = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEquals(io_file_input->Read(kMaxSize), "abc");
+}
+
+TEST_F(FileTest, IOFile_BufferedWriteIsWrittenWhenBufferIsFull) {
+  auto io_file_output = shared::IOFile::CreateOutputFile(
+      path_, {.buffer_size = 4});
+  EXPECT_EQ(io_file_output->Write(ByteArray("abc")),
+            Exception{Exception::kSuccess});
+  EXPECT_EQ(io_file_output->Write(ByteArray("de")),
+            Exception{Exception::kSuccess});
+  auto io_file_input = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEquals(io_file_input->Read(kMaxSize), "abc");
+  AssertEmpty(io_file_input->Read(kMaxSize));
+}
+
+TEST_F(FileTest, IOFile_BufferedWriteOfLargeChunkIsWrittenThrough) {
+  auto io_file_output = shared::IOFile::CreateOutputFile(
+      path_, {.buffer_size = 2});
+  EXPECT_EQ(io_file_output->Write(ByteArray("a")),
+            Exception{Exception::kSuccess});
+  EXPECT_EQ(io_file_output->Write(ByteArray("bcd")),
+            Exception{Exception::kSuccess});
+  auto io_file_input = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEquals(io_file_input->Read(4), "abcd");
+}
+
+TEST_F(FileTest, IOFile_CloseWritesBufferedData) {
+  auto io_file_output = shared::IOFile::CreateOutputFile(
+      path_, {.buffer_size = 1024,
+              .fsync_policy = shared::IOFile::FsyncPolicy::kOnClose});
+  EXPECT_EQ(io_file_output->Write(ByteArray("abc")),
+            Exception{Exception::kSuccess});
+  EXPECT_EQ(io_file_output->Close(), Exception{Exception::kSuccess});
+  auto io_file_input = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEquals(io_file_input->Read(kMaxSize), "abc");
+}
+
+TEST_F(FileTest, IOFile_DestructorWritesBufferedData) {
+  auto io_file_output = shared::IOFile::CreateOutputFile(
+      path_, {.buffer_size = 1024});
+  EXPECT_EQ(io_file_output->Write(ByteArray("abc")),
+            Exception{Exception::kSuccess});
+  io_file_output.reset();
+  auto io_file_input = shared::IOFile::CreateInputFile(path_, GetSize());
+  AssertEquals(io_file_input->Read(kMaxSize), "abc");
+}
+
 }  // namespace shared
 }  // namespace nearby
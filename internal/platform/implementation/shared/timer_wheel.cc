@@ -0,0 +1,159 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/timer_wheel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "internal/platform/runnable.h"
+
+namespace nearby {
+namespace shared {
+
+TimerWheel::TimerWheel(absl::Time start, absl::Duration resolution)
+    : start_(start), resolution_(resolution) {}
+
+TimerWheel::TimerId TimerWheel::Add(absl::Time deadline, Runnable task) {
+  std::int64_t tick = 0;
+  if (deadline > start_) {
+    absl::Duration remainder;
+    tick = absl::IDivDuration(deadline - start_, resolution_, &remainder);
+    if (remainder > absl::ZeroDuration()) ++tick;
+  }
+  TimerId id = next_id_++;
+  timers_.emplace(id, Timer{.deadline = deadline,
+                            .tick = tick,
+                            .task = std::move(task)});
+  Place(id, tick);
+  return id;
+}
+
+std::optional<Runnable> TimerWheel::Cancel(TimerId id) {
+  auto it = timers_.find(id);
+  if (it == timers_.end()) return std::nullopt;
+  Runnable task = std::move(it->second.task);
+  timers_.erase(it);
+  return task;
+}
+
+std::vector<Runnable> TimerWheel::Advance(absl::Time now) {
+  std::int64_t target_tick = 0;
+  if (now > start_) {
+    absl::Duration remainder;
+    target_tick = absl::IDivDuration(now - start_, resolution_, &remainder);
+  }
+  std::vector<std::tuple<absl::Time, TimerId, Runnable>> expired;
+  auto expire = [this, &expired](std::vector<TimerId>& ids) {
+    for (TimerId id : ids) {
+      auto it = timers_.find(id);
+      if (it == timers_.end()) continue;
+      expired.emplace_back(it->second.deadline, id, std::move(it->second.task));
+      timers_.erase(it);
+    }
+    ids.clear();
+  };
+
+  expire(due_);
+  while (current_tick_ < target_tick) {
+    if (timers_.empty()) {
+      // Only cancelled ids are left in the slots; skip the empty ticks.
+      current_tick_ = target_tick;
+      break;
+    }
+    if (level0_size_ == 0) {
+      // No timer of the first level is pending, so nothing happens before the
+      // next slot of an upper level cascades; jump straight to it.
+      current_tick_ = std::min(target_tick, GetNextCascadeTick());
+    } else {
+      ++current_tick_;
+    }
+    // Once the lower levels have gone all the way around, move the timers of
+    // the next slot of the level above down to the level that now covers them.
+    for (int level = 1; level < kLevels; ++level) {
+      int shift = kSlotBits * level;
+      if ((current_tick_ & ((std::int64_t{1} << shift) - 1)) != 0) break;
+      std::vector<TimerId> ids;
+      ids.swap(slots_[level][(current_tick_ >> shift) & (kSlots - 1)]);
+      for (TimerId id : ids) {
+        auto it = timers_.find(id);
+        if (it != timers_.end()) Place(id, it->second.tick);
+      }
+    }
+    std::vector<TimerId>& slot = slots_[0][current_tick_ & (kSlots - 1)];
+    level0_size_ -= slot.size();
+    expire(slot);
+    expire(due_);
+  }
+
+  // Timers in the same tick may have different deadlines, and timers added
+  // after their deadline are expired in the order they were added.
+  std::sort(expired.begin(), expired.end(),
+            [](const auto& a, const auto& b) {
+              return std::tie(std::get<0>(a), std::get<1>(a)) <
+                     std::tie(std::get<0>(b), std::get<1>(b));
+            });
+  std::vector<Runnable> tasks;
+  tasks.reserve(expired.size());
+  for (auto& timer : expired) {
+    tasks.push_back(std::move(std::get<2>(timer)));
+  }
+  return tasks;
+}
+
+std::int64_t TimerWheel::GetNextCascadeTick() const {
+  std::int64_t next_tick = std::numeric_limits<std::int64_t>::max();
+  for (int level = 1; level < kLevels; ++level) {
+    int shift = kSlotBits * level;
+    std::int64_t block = current_tick_ >> shift;
+    for (std::int64_t i = 1; i <= kSlots; ++i) {
+      if (!slots_[level][(block + i) & (kSlots - 1)].empty()) {
+        next_tick = std::min(next_tick, (block + i) << shift);
+        break;
+      }
+    }
+  }
+  return next_tick;
+}
+
+void TimerWheel::Place(TimerId id, std::int64_t tick) {
+  if (tick <= current_tick_) {
+    due_.push_back(id);
+    return;
+  }
+  std::int64_t delta = tick - current_tick_;
+  for (int level = 0; level < kLevels; ++level) {
+    int shift = kSlotBits * level;
+    if (delta < (std::int64_t{1} << (shift + kSlotBits))) {
+      slots_[level][(tick >> shift) & (kSlots - 1)].push_back(id);
+      if (level == 0) ++level0_size_;
+      return;
+    }
+  }
+  // Beyond the range of the wheel. Park the timer in the last slot of the top
+  // level; it's placed again with its real tick when that slot cascades.
+  int shift = kSlotBits * (kLevels - 1);
+  std::int64_t last_tick =
+      current_tick_ + (std::int64_t{1} << (shift + kSlotBits)) - 1;
+  slots_[kLevels - 1][(last_tick >> shift) & (kSlots - 1)].push_back(id);
+}
+
+}  // namespace shared
+}  // namespace nearby
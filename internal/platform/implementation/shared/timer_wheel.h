@@ -0,0 +1,97 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_SHARED_TIMER_WHEEL_H_
+#define PLATFORM_IMPL_SHARED_TIMER_WHEEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "internal/platform/runnable.h"
+
+namespace nearby {
+namespace shared {
+
+// A hierarchical timer wheel.
+//
+// Adding and cancelling a timer take constant time, whatever the number of
+// pending timers. Time only moves when Advance() is called, which returns the
+// tasks of all the timers that expired since the previous call.
+//
+// Not thread safe.
+class TimerWheel {
+ public:
+  using TimerId = std::uint64_t;
+
+  // Deadlines are rounded up to a multiple of `resolution` after `start`.
+  explicit TimerWheel(absl::Time start,
+                      absl::Duration resolution = absl::Milliseconds(1));
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Adds a timer that expires at `deadline`. A timer whose deadline has
+  // already passed expires on the next Advance().
+  TimerId Add(absl::Time deadline, Runnable task);
+
+  // Removes a pending timer and returns its task. Returns nullopt if the timer
+  // has expired or has been cancelled already.
+  std::optional<Runnable> Cancel(TimerId id);
+
+  // Moves the wheel forward to `now`, and returns the tasks of the expired
+  // timers, ordered by deadline.
+  std::vector<Runnable> Advance(absl::Time now);
+
+  // Returns the number of pending timers.
+  size_t size() const { return timers_.size(); }
+
+ private:
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlots = 1 << kSlotBits;
+  static constexpr int kLevels = 4;
+
+  struct Timer {
+    absl::Time deadline;
+    std::int64_t tick;
+    Runnable task;
+  };
+
+  // Returns the first tick after the current one at which a non-empty slot
+  // of an upper level cascades. Takes constant time.
+  std::int64_t GetNextCascadeTick() const;
+
+  // Puts the timer in the slot of the level that covers its tick, or in
+  // `due_` if its tick has been reached.
+  void Place(TimerId id, std::int64_t tick);
+
+  absl::Time start_;
+  absl::Duration resolution_;
+  std::int64_t current_tick_ = 0;
+  TimerId next_id_ = 1;
+  absl::flat_hash_map<TimerId, Timer> timers_;
+  // Slots hold timer ids. Cancelled ids are left in their slot and skipped
+  // when the slot expires or cascades, which keeps Cancel() constant time.
+  std::vector<TimerId> slots_[kLevels][kSlots];
+  // Number of ids in the slots of the first level.
+  size_t level0_size_ = 0;
+  std::vector<TimerId> due_;
+};
+
+}  // namespace shared
+}  // namespace nearby
+
+#endif  // PLATFORM_IMPL_SHARED_TIMER_WHEEL_H_
@@ -0,0 +1,158 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/platform/implementation/shared/timer_wheel.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "internal/platform/runnable.h"
+
+namespace nearby {
+namespace shared {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+constexpr absl::Time kStart = absl::FromUnixSeconds(1000);
+
+void RunAll(std::vector<Runnable> tasks) {
+  for (auto& task : tasks) task();
+}
+
+TEST(TimerWheelTest, ExpiresTimersInDeadlineOrder) {
+  TimerWheel wheel(kStart);
+  std::vector<int> fired;
+  wheel.Add(kStart + absl::Milliseconds(30), [&fired]() { fired.push_back(3); });
+  wheel.Add(kStart + absl::Milliseconds(10), [&fired]() { fired.push_back(1); });
+  wheel.Add(kStart + absl::Milliseconds(20), [&fired]() { fired.push_back(2); });
+
+  RunAll(wheel.Advance(kStart + absl::Milliseconds(9)));
+  EXPECT_THAT(fired, IsEmpty());
+  RunAll(wheel.Advance(kStart + absl::Milliseconds(25)));
+  EXPECT_THAT(fired, ElementsAre(1, 2));
+  RunAll(wheel.Advance(kStart + absl::Seconds(1)));
+  EXPECT_THAT(fired, ElementsAre(1, 2, 3));
+  EXPECT_EQ(wheel.size(), 0);
+}
+
+TEST(TimerWheelTest, DeadlineIsNotRoundedDown) {
+  TimerWheel wheel(kStart, absl::Milliseconds(10));
+  bool fired = false;
+  wheel.Add(kStart + absl::Milliseconds(15), [&fired]() { fired = true; });
+
+  RunAll(wheel.Advance(kStart + absl::Milliseconds(14)));
+  EXPECT_FALSE(fired);
+  RunAll(wheel.Advance(kStart + absl::Milliseconds(20)));
+  EXPECT_TRUE(fired);
+}
+
+TEST(TimerWheelTest, PastDeadlineExpiresOnNextAdvance) {
+  TimerWheel wheel(kStart);
+  RunAll(wheel.Advance(kStart + absl::Seconds(1)));
+  bool fired = false;
+  wheel.Add(kStart, [&fired]() { fired = true; });
+
+  RunAll(wheel.Advance(kStart + absl::Seconds(1)));
+  EXPECT_TRUE(fired);
+}
+
+TEST(TimerWheelTest, CancelReleasesTask) {
+  TimerWheel wheel(kStart);
+  auto state = std::make_shared<int>(0);
+  TimerWheel::TimerId id =
+      wheel.Add(kStart + absl::Seconds(1), [state]() { ++*state; });
+  EXPECT_EQ(state.use_count(), 2);
+
+  EXPECT_TRUE(wheel.Cancel(id).has_value());
+  EXPECT_EQ(state.use_count(), 1);
+  EXPECT_FALSE(wheel.Cancel(id).has_value());
+  RunAll(wheel.Advance(kStart + absl::Seconds(2)));
+  EXPECT_EQ(*state, 0);
+}
+
+TEST(TimerWheelTest, CancelAfterExpiryFails) {
+  TimerWheel wheel(kStart);
+  TimerWheel::TimerId id = wheel.Add(kStart + absl::Seconds(1), []() {});
+
+  EXPECT_EQ(wheel.Advance(kStart + absl::Seconds(1)).size(), 1);
+  EXPECT_FALSE(wheel.Cancel(id).has_value());
+}
+
+TEST(TimerWheelTest, TimerBeyondWheelRangeExpiresOnTime) {
+  TimerWheel wheel(kStart);
+  bool fired = false;
+  wheel.Add(kStart + absl::Hours(5), [&fired]() { fired = true; });
+
+  RunAll(wheel.Advance(kStart + absl::Hours(5) - absl::Milliseconds(1)));
+  EXPECT_FALSE(fired);
+  RunAll(wheel.Advance(kStart + absl::Hours(5)));
+  EXPECT_TRUE(fired);
+}
+
+TEST(TimerWheelTest, AdvanceSkipsIdleTimeAtOnce) {
+  // Started at the epoch, the wheel is about 2^40 ticks behind a realistic
+  // clock. Advancing must not walk those ticks one slot at a time.
+  TimerWheel wheel(absl::UnixEpoch());
+  absl::Time now = absl::FromUnixSeconds(1700000000);
+  bool fired = false;
+  wheel.Add(now + absl::Seconds(1), [&fired]() { fired = true; });
+
+  RunAll(wheel.Advance(now + absl::Seconds(1) - absl::Milliseconds(1)));
+  EXPECT_FALSE(fired);
+  RunAll(wheel.Advance(now + absl::Seconds(2)));
+  EXPECT_TRUE(fired);
+  EXPECT_EQ(wheel.size(), 0);
+}
+
+TEST(TimerWheelTest, ManyTimersExpireOnceAndNotEarly) {
+  TimerWheel wheel(kStart);
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<int> delay_ms(0, 10 * 60 * 1000);
+  constexpr int kTimers = 10000;
+  std::vector<absl::Time> deadlines(kTimers);
+  std::vector<int> fire_counts(kTimers);
+  std::vector<TimerWheel::TimerId> ids(kTimers);
+  absl::Time now = kStart;
+  for (int i = 0; i < kTimers; ++i) {
+    deadlines[i] = kStart + absl::Milliseconds(delay_ms(prng));
+    ids[i] = wheel.Add(deadlines[i], [&, i]() {
+      EXPECT_LE(deadlines[i], now);
+      ++fire_counts[i];
+    });
+  }
+  for (int i = 0; i < kTimers; i += 2) {
+    EXPECT_TRUE(wheel.Cancel(ids[i]).has_value());
+  }
+
+  std::uniform_int_distribution<int> step_ms(1, 5000);
+  while (now < kStart + absl::Minutes(11)) {
+    now += absl::Milliseconds(step_ms(prng));
+    RunAll(wheel.Advance(now));
+  }
+
+  EXPECT_EQ(wheel.size(), 0);
+  for (int i = 0; i < kTimers; ++i) {
+    EXPECT_EQ(fire_counts[i], i % 2 == 0 ? 0 : 1) << i;
+  }
+}
+
+}  // namespace
+}  // namespace shared
+}  // namespace nearby
@@ -14,13 +14,15 @@
 
 #include "internal/platform/pipe.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
+#include <cstring>
 #include <memory>
 #include <utility>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/types/span.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/condition_variable.h"
 #include "internal/platform/exception.h"
@@ -32,18 +34,29 @@
 namespace nearby {
 
 namespace {
+// Initial size of the ring buffer, so that pipes carrying little data stay
+// small.
+constexpr size_t kInitialBufferSize = 4 * 1024;
+
 class Pipe {
  public:
-  Pipe() = default;
+  explicit Pipe(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
 
-  class PipeInputStream : public InputStream {
+  class PipeInputStreamImpl : public PipeInputStream {
    public:
-    explicit PipeInputStream(std::shared_ptr<Pipe> pipe) : pipe_(pipe) {}
-    ~PipeInputStream() override { DoClose(); }
+    explicit PipeInputStreamImpl(std::shared_ptr<Pipe> pipe) : pipe_(pipe) {}
+    ~PipeInputStreamImpl() override { DoClose(); }
 
     ExceptionOr<ByteArray> Read(std::int64_t size) override {
       return pipe_->Read(size);
     }
+    ExceptionOr<size_t> ReadV(
+        absl::Span<const absl::Span<char>> buffers) override {
+      return pipe_->ReadV(buffers);
+    }
+    ExceptionOr<size_t> Skip(size_t offset) override {
+      return pipe_->Skip(offset);
+    }
     Exception Close() override { return DoClose(); }
 
    private:
@@ -75,111 +88,199 @@ class Pipe {
 
  private:
   ExceptionOr<ByteArray> Read(size_t size) ABSL_LOCKS_EXCLUDED(mutex_);
-  Exception Write(const ByteArray& data) ABSL_LOCKS_EXCLUDED(mutex_);
+  ExceptionOr<size_t> ReadV(absl::Span<const absl::Span<char>> buffers)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  ExceptionOr<size_t> Skip(size_t offset) ABSL_LOCKS_EXCLUDED(mutex_);
+  Exception Write(const ByteArray& data)
+      ABSL_LOCKS_EXCLUDED(write_mutex_, mutex_);
 
   void MarkInputStreamClosed() ABSL_LOCKS_EXCLUDED(mutex_);
   void MarkOutputStreamClosed() ABSL_LOCKS_EXCLUDED(mutex_);
 
-  Exception WriteLocked(const ByteArray& data)
+  // Waits until there are bytes to read, or the end of stream is reached.
+  Exception WaitForDataLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Copies up to `size` bytes from the front of the buffer to `dest`, and
+  // returns the number of bytes copied. `dest` may be null to drop them.
+  size_t ConsumeLocked(char* dest, size_t size)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Makes room for at least `size` more bytes in the buffer, without going
+  // over `capacity_`.
+  void GrowLocked(size_t size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
-  bool input_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
-  bool output_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
-  bool read_all_chunks_ ABSL_GUARDED_BY(mutex_) = false;
+  const size_t capacity_;
 
-  std::deque<ByteArray> ABSL_GUARDED_BY(mutex_) buffer_;
+  // Serializes Write() calls, so that the bytes of a write are not interleaved
+  // with those of another one when the writes block.
+  Mutex write_mutex_ ABSL_ACQUIRED_BEFORE(mutex_);
   // Order of declaration matters:
   // - mutex must be defined before condvar;
   Mutex mutex_;
+  // Notified when bytes are written or read, and when either end is closed.
   ConditionVariable cond_{&mutex_};
+  bool input_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
+  bool output_stream_closed_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // The ring buffer. The bytes to read start at `read_pos_`, and wrap around
+  // at the end of `buffer_`.
+  std::unique_ptr<char[]> buffer_ ABSL_GUARDED_BY(mutex_);
+  size_t buffer_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t read_pos_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t data_size_ ABSL_GUARDED_BY(mutex_) = 0;
 };
 
 ExceptionOr<ByteArray> Pipe::Read(size_t size) {
   MutexLock lock(&mutex_);
-
-  // We're done reading all the chunks that were written before the OutputStream
-  // was closed, so there's nothing to do here other than return an empty chunk
-  // to serve as an EOF indication to callers.
-  if (read_all_chunks_) {
+  Exception wait_exception = WaitForDataLocked();
+  if (wait_exception.Raised()) {
+    return ExceptionOr<ByteArray>{wait_exception};
+  }
+  // An empty chunk serves as an EOF indication to callers.
+  if (data_size_ == 0 || size == 0) {
     return ExceptionOr<ByteArray>{ByteArray{}};
   }
 
-  while (buffer_.empty() && !input_stream_closed_) {
-    Exception wait_exception = cond_.Wait();
+  ByteArray result(std::min(size, data_size_));
+  ConsumeLocked(result.data(), result.size());
+  return ExceptionOr<ByteArray>{std::move(result)};
+}
 
-    if (wait_exception.Raised()) {
-      return ExceptionOr<ByteArray>{wait_exception};
-    }
+ExceptionOr<size_t> Pipe::ReadV(absl::Span<const absl::Span<char>> buffers) {
+  MutexLock lock(&mutex_);
+  Exception wait_exception = WaitForDataLocked();
+  if (wait_exception.Raised()) {
+    return ExceptionOr<size_t>{wait_exception};
   }
 
-  // If we received our sentinel chunk, mark the fact that there cannot
-  // possibly be any more chunks to read here on in, and return an empty chunk
-  // to serve as an EOF indication to callers.
-  if (buffer_.empty() || buffer_.front().Empty()) {
-    read_all_chunks_ = true;
-    return ExceptionOr<ByteArray>{ByteArray{}};
+  size_t bytes_read = 0;
+  for (absl::Span<char> buffer : buffers) {
+    if (data_size_ == 0) break;
+    bytes_read += ConsumeLocked(buffer.data(), buffer.size());
   }
+  return ExceptionOr<size_t>{bytes_read};
+}
 
-  ByteArray first_chunk{buffer_.front()};
-  buffer_.pop_front();
-
-  // If first_chunk is small enough to not overshoot the requested 'size', just
-  // return that.
-  if (first_chunk.size() <= size) {
-    return ExceptionOr<ByteArray>{first_chunk};
-  } else {
-    // Break first_chunk into 2 parts -- the first one of which (next_chunk)
-    // will be 'size' bytes long, and will be returned, and the second one of
-    // which (overflow_chunk) will be re-inserted into buffer_, at the head of
-    // the queue, to be served up in the next call to read().
-    ByteArray next_chunk(first_chunk.data(), size);
-    buffer_.push_front(
-        ByteArray(first_chunk.data() + size, first_chunk.size() - size));
-    return ExceptionOr<ByteArray>{next_chunk};
+ExceptionOr<size_t> Pipe::Skip(size_t offset) {
+  MutexLock lock(&mutex_);
+  size_t bytes_skipped = 0;
+  while (bytes_skipped < offset) {
+    Exception wait_exception = WaitForDataLocked();
+    if (wait_exception.Raised()) {
+      return ExceptionOr<size_t>{wait_exception};
+    }
+    if (data_size_ == 0) break;
+    bytes_skipped += ConsumeLocked(nullptr, offset - bytes_skipped);
   }
+  return ExceptionOr<size_t>{bytes_skipped};
 }
 
 Exception Pipe::Write(const ByteArray& data) {
+  MutexLock write_lock(&write_mutex_);
   MutexLock lock(&mutex_);
 
-  return WriteLocked(data);
+  if (input_stream_closed_ || output_stream_closed_) {
+    return {Exception::kIo};
+  }
+  const char* src = data.data();
+  size_t bytes_left = data.size();
+  while (bytes_left > 0) {
+    // Wait for the reader to make room, unless it's gone.
+    while (!input_stream_closed_ && !output_stream_closed_ &&
+           data_size_ == capacity_) {
+      Exception wait_exception = cond_.Wait();
+      if (wait_exception.Raised()) {
+        return wait_exception;
+      }
+    }
+    if (input_stream_closed_ || output_stream_closed_) {
+      return {Exception::kIo};
+    }
+
+    GrowLocked(bytes_left);
+    size_t write_pos = (read_pos_ + data_size_) % buffer_size_;
+    size_t length = std::min(bytes_left, buffer_size_ - data_size_);
+    size_t first_length = std::min(length, buffer_size_ - write_pos);
+    std::memcpy(buffer_.get() + write_pos, src, first_length);
+    std::memcpy(buffer_.get(), src + first_length, length - first_length);
+    data_size_ += length;
+    src += length;
+    bytes_left -= length;
+    // Trigger cond_ to unblock a potentially-blocked call to read(), now that
+    // there's more data for it to consume.
+    cond_.Notify();
+  }
+  return {Exception::kSuccess};
 }
 
 void Pipe::MarkInputStreamClosed() {
   MutexLock lock(&mutex_);
   if (input_stream_closed_) return;
   input_stream_closed_ = true;
-  // Trigger cond_ to unblock a potentially-blocked call to read(), and to let
-  // it know to return Exception::IO.
+  // Trigger cond_ to unblock a potentially-blocked call to read(), and a
+  // potentially-blocked call to write() to let it know to return
+  // Exception::IO.
   cond_.Notify();
 }
 
 void Pipe::MarkOutputStreamClosed() {
   MutexLock lock(&mutex_);
   if (output_stream_closed_) return;
-  // Write a sentinel null chunk before marking output_stream_closed as true.
-  WriteLocked(ByteArray{});
   output_stream_closed_ = true;
+  // Let a potentially-blocked call to read() return the EOF indication once
+  // the remaining bytes are read.
+  cond_.Notify();
 }
 
-Exception Pipe::WriteLocked(const ByteArray& data) {
-  if (input_stream_closed_ || output_stream_closed_) {
-    return {Exception::kIo};
+Exception Pipe::WaitForDataLocked() {
+  while (data_size_ == 0 && !input_stream_closed_ && !output_stream_closed_) {
+    Exception wait_exception = cond_.Wait();
+    if (wait_exception.Raised()) {
+      return wait_exception;
+    }
   }
-
-  buffer_.push_back(data);
-  // Trigger cond_ to unblock a potentially-blocked call to read(), now that
-  // there's more data for it to consume.
-  cond_.Notify();
   return {Exception::kSuccess};
 }
 
+size_t Pipe::ConsumeLocked(char* dest, size_t size) {
+  size_t length = std::min(size, data_size_);
+  if (dest != nullptr) {
+    size_t first_length = std::min(length, buffer_size_ - read_pos_);
+    std::memcpy(dest, buffer_.get() + read_pos_, first_length);
+    std::memcpy(dest + first_length, buffer_.get(), length - first_length);
+  }
+  data_size_ -= length;
+  // Rewind when empty, so that the next bytes are written contiguously.
+  read_pos_ = data_size_ == 0 ? 0 : (read_pos_ + length) % buffer_size_;
+  if (length > 0) {
+    // Trigger cond_ to unblock a potentially-blocked call to write(), now that
+    // there's room for more data.
+    cond_.Notify();
+  }
+  return length;
+}
+
+void Pipe::GrowLocked(size_t size) {
+  if (buffer_size_ - data_size_ >= size || buffer_size_ == capacity_) return;
+  size_t new_size = std::max(buffer_size_ * 2, kInitialBufferSize);
+  new_size = std::min(std::max(new_size, data_size_ + size), capacity_);
+  auto new_buffer = std::make_unique<char[]>(new_size);
+  if (data_size_ > 0) {
+    // Unwrap the bytes to read at the start of the new buffer.
+    size_t first_length = std::min(data_size_, buffer_size_ - read_pos_);
+    std::memcpy(new_buffer.get(), buffer_.get() + read_pos_, first_length);
+    std::memcpy(new_buffer.get() + first_length, buffer_.get(),
+                data_size_ - first_length);
+  }
+  buffer_ = std::move(new_buffer);
+  buffer_size_ = new_size;
+  read_pos_ = 0;
+}
+
 }  // namespace
 
-std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
-CreatePipe() {
-  auto pipe = std::make_shared<Pipe>();
-  return std::make_pair(std::make_unique<Pipe::PipeInputStream>(pipe),
+std::pair<std::unique_ptr<PipeInputStream>, std::unique_ptr<OutputStream>>
+CreatePipe(size_t capacity) {
+  auto pipe = std::make_shared<Pipe>(capacity);
+  return std::make_pair(std::make_unique<Pipe::PipeInputStreamImpl>(pipe),
                         std::make_unique<Pipe::PipeOutputStream>(pipe));
 }
 }  // namespace nearby
@@ -15,14 +15,37 @@
 #ifndef PLATFORM_PUBLIC_PIPE_H_
 #define PLATFORM_PUBLIC_PIPE_H_
 
+#include <cstddef>
+#include <limits>
 #include <memory>
 #include <utility>
 
+#include "absl/types/span.h"
+#include "internal/platform/exception.h"
 #include "internal/platform/input_stream.h"
 #include "internal/platform/output_stream.h"
 
 namespace nearby {
 
+// Capacity of the pipes created by CreatePipe() without an explicit one.
+inline constexpr size_t kDefaultPipeCapacity = 1024 * 1024;
+
+// Capacity of a pipe whose writes never block. For pipes written from a thread
+// that must not stall on a slow reader, such as the reader thread of an
+// endpoint.
+inline constexpr size_t kUnboundedPipeCapacity =
+    std::numeric_limits<size_t>::max();
+
+// The reading end of a pipe.
+class PipeInputStream : public InputStream {
+ public:
+  // Reads at most the total size of `buffers` bytes, filling them in order,
+  // like readv(2). Blocks until at least one byte is available. Returns the
+  // number of bytes read, which is 0 at end of stream.
+  virtual ExceptionOr<size_t> ReadV(
+      absl::Span<const absl::Span<char>> buffers) = 0;
+};
+
 // Creates a pipe for streaming data between threads.
 // ```
 //  auto [input, output] = CreatePipe();
@@ -30,8 +53,12 @@ namespace nearby {
 //  WriterThread(std::move(output));
 //  ```
 //  Pipe stays valid as long as either `input` or `output` exist.
-std::pair<std::unique_ptr<InputStream>, std::unique_ptr<OutputStream>>
-CreatePipe();
+//
+// The bytes written are kept in a ring buffer until read. It grows as needed
+// up to `capacity` bytes, after which writes block until enough bytes are read
+// or the input is closed.
+std::pair<std::unique_ptr<PipeInputStream>, std::unique_ptr<OutputStream>>
+CreatePipe(size_t capacity = kDefaultPipeCapacity);
 
 }  // namespace nearby
 
@@ -26,6 +26,9 @@
 
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "internal/platform/byte_array.h"
 #include "internal/platform/exception.h"
 #include "internal/platform/input_stream.h"
@@ -177,6 +180,104 @@ class Thread {
   Runnable runnable_;
 };
 
+TEST(PipeTest, ReadVFillsBuffersInOrder) {
+  auto [input_stream, output_stream] = CreatePipe();
+  EXPECT_TRUE(output_stream->Write(ByteArray("ABCDEFG")).Ok());
+
+  char first[3];
+  char second[3];
+  std::vector<absl::Span<char>> buffers = {absl::MakeSpan(first),
+                                           absl::MakeSpan(second)};
+  ExceptionOr<size_t> bytes_read = input_stream->ReadV(buffers);
+
+  ASSERT_TRUE(bytes_read.ok());
+  EXPECT_EQ(bytes_read.result(), 6);
+  EXPECT_EQ(std::string(first, 3), "ABC");
+  EXPECT_EQ(std::string(second, 3), "DEF");
+  EXPECT_EQ(std::string(input_stream->Read(kChunkSize).result()), "G");
+}
+
+TEST(PipeTest, ReadVReturnsZeroAtEndOfStream) {
+  auto [input_stream, output_stream] = CreatePipe();
+  output_stream->Close();
+
+  char buffer[3];
+  std::vector<absl::Span<char>> buffers = {absl::MakeSpan(buffer)};
+  ExceptionOr<size_t> bytes_read = input_stream->ReadV(buffers);
+
+  ASSERT_TRUE(bytes_read.ok());
+  EXPECT_EQ(bytes_read.result(), 0);
+}
+
+TEST(PipeTest, SkipDropsBytes) {
+  auto [input_stream, output_stream] = CreatePipe();
+  EXPECT_TRUE(output_stream->Write(ByteArray("ABCD")).Ok());
+  EXPECT_TRUE(output_stream->Write(ByteArray("EFGH")).Ok());
+  output_stream->Close();
+
+  EXPECT_EQ(input_stream->Skip(6).result(), 6);
+  EXPECT_EQ(std::string(input_stream->Read(kChunkSize).result()), "GH");
+  EXPECT_EQ(input_stream->Skip(6).result(), 0);
+}
+
+TEST(PipeTest, ReadsAcrossWrapAround) {
+  auto [input_stream, output_stream] = CreatePipe(/*capacity=*/4);
+  EXPECT_TRUE(output_stream->Write(ByteArray("ABC")).Ok());
+  EXPECT_EQ(std::string(input_stream->Read(2).result()), "AB");
+  EXPECT_TRUE(output_stream->Write(ByteArray("DEF")).Ok());
+
+  EXPECT_EQ(std::string(input_stream->Read(kChunkSize).result()), "CDEF");
+}
+
+TEST(PipeTest, WriteBlocksWhileFull) {
+  auto [input_stream, output_stream] = CreatePipe(/*capacity=*/4);
+  EXPECT_TRUE(output_stream->Write(ByteArray("ABCD")).Ok());
+  std::atomic_bool write_done = false;
+
+  Thread writer_thread;
+  writer_thread.Start([&output_stream = output_stream, &write_done]() {
+    EXPECT_TRUE(output_stream->Write(ByteArray("EF")).Ok());
+    write_done = true;
+  });
+  absl::SleepFor(absl::Milliseconds(100));
+  EXPECT_FALSE(write_done);
+
+  EXPECT_EQ(std::string(input_stream->Read(2).result()), "AB");
+  writer_thread.Join();
+  EXPECT_TRUE(write_done);
+  EXPECT_EQ(std::string(input_stream->Read(kChunkSize).result()), "CDEF");
+}
+
+TEST(PipeTest, BlockedWriteFailsWhenInputStreamClosed) {
+  auto [input_stream, output_stream] = CreatePipe(/*capacity=*/4);
+  EXPECT_TRUE(output_stream->Write(ByteArray("ABCD")).Ok());
+
+  Thread writer_thread;
+  writer_thread.Start([&output_stream = output_stream]() {
+    EXPECT_TRUE(output_stream->Write(ByteArray("EF")).Raised(Exception::kIo));
+  });
+  absl::SleepFor(absl::Milliseconds(100));
+  input_stream->Close();
+  writer_thread.Join();
+}
+
+TEST(PipeTest, WriteLargerThanCapacity) {
+  auto [input_stream, output_stream] = CreatePipe(/*capacity=*/16);
+  std::string data;
+  for (int i = 0; i < 1000; ++i) data += static_cast<char>('A' + i % 26);
+
+  Thread writer_thread;
+  writer_thread.Start([&output_stream = output_stream, &data]() {
+    EXPECT_TRUE(output_stream->Write(ByteArray(data)).Ok());
+    EXPECT_TRUE(output_stream->Close().Ok());
+  });
+  ExceptionOr<ByteArray> read_data = input_stream->ReadExactly(data.size());
+  writer_thread.Join();
+
+  ASSERT_TRUE(read_data.ok());
+  EXPECT_EQ(std::string(read_data.result()), data);
+}
+
 TEST(PipeTest, ReadBlockedUntilWrite) {
   using CrossThreadBool = std::atomic_bool;
 
@@ -14,6 +14,7 @@
 
 #include "internal/weave/base_socket.h"
 
+#include <algorithm>
 #include <deque>
 #include <string>
 #include <utility>
@@ -54,7 +55,7 @@ BaseSocket::BaseSocket(const Connection& connection, SocketCallback&& callback)
                return;
              }
              absl::StatusOr<Packet> packet{
-                 Packet::FromBytes(ByteArray(message))};
+                 Packet::FromBytes(ByteArray(std::move(message)))};
              if (!packet.ok()) {
                DisconnectInternal(packet.status());
                return;
@@ -77,6 +78,7 @@ BaseSocket::BaseSocket(const Connection& connection, SocketCallback&& callback)
            },
        .on_disconnected_cb = [this]() { DisconnectQuietly(); }});
   max_packet_size_ = connection_.GetMaxPacketSize();
+  max_packets_in_flight_ = std::max(connection_.GetMaxPacketsInFlight(), 1);
 }
 
 BaseSocket::~BaseSocket() {
@@ -104,9 +106,11 @@ void BaseSocket::TryWriteNextControl() {
   // one of three packets. ConnectionRequest, ConnectionConfirm, or Error.
   // In any case, we should not have any messages in the queue from the previous
   // connection.
-  current_message_ = nullptr;
-  message_request_queue_.clear();
-  WritePacket(current_control_->NextPacket(max_packet_size_));
+  ClearMessages();
+  in_flight_packets_.push_back(InFlightPacket::kControl);
+  if (!WritePacket(current_control_->NextPacket(max_packet_size_))) {
+    in_flight_packets_.pop_back();
+  }
 }
 
 void BaseSocket::TryWriteNextMessage() {
@@ -122,26 +126,61 @@ void BaseSocket::TryWriteNextMessage() {
   }
   bool connected = IsConnected();
   MutexLock lock(&mutex_);
-  if (current_message_ == nullptr) {
-    if (!message_request_queue_.empty()) {
-      current_message_ = &message_request_queue_.front();
-    }
-  }
-  if (current_message_ == nullptr || current_message_->IsFinished() ||
-      !connected) {
+  if (!connected) {
     return;
   }
-  WritePacket(current_message_->NextPacket(max_packet_size_));
+  // Keep up to max_packets_in_flight_ packets transmitted, so the connection
+  // doesn't sit idle while waiting for each write result.
+  while (in_flight_packets_.size() <
+         static_cast<size_t>(max_packets_in_flight_)) {
+    if (current_message_ == nullptr) {
+      if (sent_message_count_ >= message_request_queue_.size()) {
+        return;
+      }
+      current_message_ = &message_request_queue_[sent_message_count_];
+    }
+    if (current_message_->IsFinished()) {
+      return;
+    }
+    absl::StatusOr<Packet> packet =
+        current_message_->NextPacket(max_packet_size_);
+    if (current_message_->IsFinished()) {
+      in_flight_packets_.push_back(InFlightPacket::kMessageEnd);
+      current_message_ = nullptr;
+      ++sent_message_count_;
+    } else {
+      in_flight_packets_.push_back(InFlightPacket::kMessage);
+    }
+    if (!WritePacket(std::move(packet))) {
+      in_flight_packets_.pop_back();
+      return;
+    }
+  }
 }
 
-void BaseSocket::WritePacket(absl::StatusOr<Packet> packet) {
+bool BaseSocket::WritePacket(absl::StatusOr<Packet> packet) {
   if (!packet.ok()) {
     NEARBY_LOGS(WARNING) << "Packet status:" << packet.status();
-    return;
+    return false;
   }
   CHECK_OK(packet->SetPacketCounter(packet_counter_generator_.Next()));
   NEARBY_LOGS(INFO) << "transmitting packet";
-  connection_.Transmit(packet->GetBytes());
+  connection_.Transmit(std::move(*packet).GetBytes());
+  return true;
+}
+
+void BaseSocket::ClearMessages() {
+  current_message_ = nullptr;
+  sent_message_count_ = 0;
+  message_request_queue_.clear();
+  // The write results of these packets are still to come, but no longer
+  // complete a message.
+  for (InFlightPacket& in_flight_packet : in_flight_packets_) {
+    if (in_flight_packet == InFlightPacket::kMessage ||
+        in_flight_packet == InFlightPacket::kMessageEnd) {
+      in_flight_packet = InFlightPacket::kDropped;
+    }
+  }
 }
 
 void BaseSocket::OnWriteRequestWriteComplete(absl::Status status) {
@@ -151,20 +190,23 @@ void BaseSocket::OnWriteRequestWriteComplete(absl::Status status) {
           ABSL_LOCKS_EXCLUDED(mutex_) mutable {
             {
               MutexLock lock(&mutex_);
-              if (current_control_ != nullptr) {
-                current_control_ = nullptr;
-                control_request_queue_.pop_front();
-              } else if (current_message_ != nullptr) {
-                NEARBY_LOGS(INFO) << "OnWriteResult current is not null";
-                if (current_message_->IsFinished()) {
-                  NEARBY_LOGS(INFO) << "OnWriteResult current finished";
-                  current_message_->SetWriteStatus(status);
-                  if (!message_request_queue_.empty() &&
-                      current_message_ == &message_request_queue_.front()) {
-                    NEARBY_LOGS(INFO) << "remove message";
-                    message_request_queue_.pop_front();
-                    current_message_ = nullptr;
+              if (in_flight_packets_.empty()) {
+                // The packet was transmitted before the socket was reset.
+                NEARBY_LOGS(INFO) << "OnWriteResult no packet in flight";
+              } else {
+                InFlightPacket in_flight_packet = in_flight_packets_.front();
+                in_flight_packets_.pop_front();
+                if (in_flight_packet == InFlightPacket::kControl) {
+                  current_control_ = nullptr;
+                  if (!control_request_queue_.empty()) {
+                    control_request_queue_.pop_front();
                   }
+                } else if (in_flight_packet == InFlightPacket::kMessageEnd &&
+                           sent_message_count_ > 0) {
+                  NEARBY_LOGS(INFO) << "OnWriteResult message finished";
+                  message_request_queue_.front().SetWriteStatus(status);
+                  message_request_queue_.pop_front();
+                  --sent_message_count_;
                 }
               }
             }
@@ -196,8 +238,7 @@ void BaseSocket::Disconnect() {
       WriteControlPacket(Packet::CreateErrorPacket());
       {
         MutexLock lock(&mutex_);
-        current_message_ = nullptr;
-        message_request_queue_.clear();
+        ClearMessages();
         state_ = SocketConnectionState::kDisconnecting;
       }
       DisconnectQuietly();
@@ -225,10 +266,10 @@ void BaseSocket::DisconnectQuietly() {
                           // Dump message and control queue.
                           {
                             MutexLock lock(&mutex_);
-                            message_request_queue_.clear();
+                            ClearMessages();
                             control_request_queue_.clear();
                             current_control_ = nullptr;
-                            current_message_ = nullptr;
+                            in_flight_packets_.clear();
                             state_ = SocketConnectionState::kDisconnected;
                           }
                           NEARBY_LOGS(INFO) << "Socket now disconnected.";
@@ -247,11 +288,12 @@ void BaseSocket::OnReceiveDataPacket(Packet packet) {
     DisconnectInternal(message.status());
     return;
   }
-  socket_callback_.on_receive_cb(message->string_data());
+  socket_callback_.on_receive_cb(std::string(std::move(*message)));
 }
 
 nearby::Future<absl::Status> BaseSocket::Write(ByteArray message) {
-  MessageWriteRequest request = MessageWriteRequest(message.string_data());
+  MessageWriteRequest request =
+      MessageWriteRequest(std::string(std::move(message)));
   nearby::Future<absl::Status> ret = request.GetWriteStatusFuture();
 
   RunOnSocketThread(
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_NEARBY_INTERNAL_WEAVE_BASE_SOCKET_H_
 #define THIRD_PARTY_NEARBY_INTERNAL_WEAVE_BASE_SOCKET_H_
 
+#include <cstddef>
 #include <deque>
 #include <string>
 #include <utility>
@@ -83,6 +84,16 @@ class BaseSocket {
     kConnected
   };
 
+  // What a transmitted packet, waiting for its write result, was sent for.
+  enum class InFlightPacket {
+    kControl,
+    kMessage,
+    // The last packet of a message.
+    kMessageEnd,
+    // A message packet whose message was dropped from the queue.
+    kDropped
+  };
+
   bool IsRemotePacketCounterExpected(int counter);
   void TryWriteNextControl() ABSL_EXCLUSIVE_LOCKS_REQUIRED(executor_)
       ABSL_LOCKS_EXCLUDED(mutex_);
@@ -90,7 +101,8 @@ class BaseSocket {
       ABSL_LOCKS_EXCLUDED(mutex_);
   void OnWriteRequestWriteComplete(absl::Status status)
       ABSL_LOCKS_EXCLUDED(executor_);
-  void WritePacket(absl::StatusOr<Packet> packet);
+  bool WritePacket(absl::StatusOr<Packet> packet);
+  void ClearMessages() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Mutex mutex_;
   // Messages and controls are in two separate queues to separate their control
@@ -100,7 +112,15 @@ class BaseSocket {
   std::deque<MessageWriteRequest> message_request_queue_
       ABSL_GUARDED_BY(mutex_);
   ControlPacketWriteRequest* current_control_ = nullptr;
+  // The message being split into packets. Messages before it in
+  // message_request_queue_ have all their packets transmitted.
   MessageWriteRequest* current_message_ = nullptr;
+  size_t sent_message_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Transmitted packets in transmit order, popped as their write results come
+  // back. Message packets are only transmitted while there are fewer than
+  // max_packets_in_flight_ of them.
+  std::deque<InFlightPacket> in_flight_packets_ ABSL_GUARDED_BY(mutex_);
+  int max_packets_in_flight_;
   SocketConnectionState state_ ABSL_GUARDED_BY(mutex_) =
       SocketConnectionState::kDisconnected;
   int max_packet_size_;
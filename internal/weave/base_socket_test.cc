@@ -14,7 +14,11 @@
 
 #include "internal/weave/base_socket.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <deque>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -24,7 +28,10 @@
 #include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "internal/platform/byte_array.h"
+#include "internal/platform/future.h"
 #include "internal/platform/logging.h"
 #include "internal/platform/mutex.h"
 #include "internal/platform/mutex_lock.h"
@@ -114,6 +121,81 @@ class FakeSocket : public BaseSocket {
   std::vector<Packet> control_packets_;
 };
 
+// Reports each write result `latency` after the packet was transmitted, with
+// up to `max_packets_in_flight` packets on the way at once.
+class LatencyConnection : public Connection {
+ public:
+  LatencyConnection(int max_packets_in_flight, absl::Duration latency)
+      : max_packets_in_flight_(max_packets_in_flight),
+        latency_(latency),
+        thread_([this]() { ReportWriteResults(); }) {}
+  ~LatencyConnection() override { Shutdown(); }
+
+  void Initialize(ConnectionCallback callback) override {
+    callback_ = std::move(callback);
+  }
+  int GetMaxPacketSize() const override { return 20; }
+  int GetMaxPacketsInFlight() const override { return max_packets_in_flight_; }
+  void Transmit(std::string packet) override {
+    absl::MutexLock lock(&mutex_);
+    packets_written_.push_back(packet);
+    write_deadlines_.push_back(absl::Now() + latency_);
+    max_packets_seen_in_flight_ =
+        std::max(max_packets_seen_in_flight_, write_deadlines_.size());
+  }
+  void Close() override {}
+
+  // Stops reporting write results.
+  void Shutdown() {
+    {
+      absl::MutexLock lock(&mutex_);
+      shutdown_ = true;
+    }
+    if (thread_.joinable()) thread_.join();
+  }
+  std::vector<std::string> GetPacketsWritten() {
+    absl::MutexLock lock(&mutex_);
+    return packets_written_;
+  }
+  size_t GetMaxPacketsSeenInFlight() {
+    absl::MutexLock lock(&mutex_);
+    return max_packets_seen_in_flight_;
+  }
+
+ private:
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return shutdown_ || !write_deadlines_.empty();
+  }
+
+  void ReportWriteResults() {
+    while (true) {
+      absl::Time deadline;
+      {
+        absl::MutexLock lock(&mutex_);
+        mutex_.Await(absl::Condition(this, &LatencyConnection::HasWork));
+        if (shutdown_) return;
+        deadline = write_deadlines_.front();
+      }
+      absl::SleepFor(deadline - absl::Now());
+      {
+        absl::MutexLock lock(&mutex_);
+        write_deadlines_.pop_front();
+      }
+      callback_.on_transmit_cb(absl::OkStatus());
+    }
+  }
+
+  const int max_packets_in_flight_;
+  const absl::Duration latency_;
+  ConnectionCallback callback_;
+  absl::Mutex mutex_;
+  std::vector<std::string> packets_written_ ABSL_GUARDED_BY(mutex_);
+  std::deque<absl::Time> write_deadlines_ ABSL_GUARDED_BY(mutex_);
+  size_t max_packets_seen_in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool shutdown_ ABSL_GUARDED_BY(mutex_) = false;
+  std::thread thread_;
+};
+
 Packet CreateDataPacket(int counter, bool first, bool last, ByteArray data) {
   Packet packet = Packet::CreateDataPacket(first, last, data);
   EXPECT_OK(packet.SetPacketCounter(counter));
@@ -489,6 +571,62 @@ TEST_F(BaseSocketTest, TestDisconnectOnBadDataPacketCounter) {
   EXPECT_FALSE(connected_);
 }
 
+struct WindowedWriteResult {
+  std::vector<std::string> packets_written;
+  size_t max_packets_seen_in_flight;
+};
+
+WindowedWriteResult WriteWithWindow(int max_packets_in_flight,
+                                    const std::string& message) {
+  LatencyConnection connection(max_packets_in_flight, absl::Milliseconds(5));
+  FakeSocket socket(connection, SocketCallback{});
+  socket.OnConnectedProxy(connection.GetMaxPacketSize());
+  nearby::Future<absl::Status> status = socket.Write(ByteArray(message));
+  EXPECT_OK(status.Get().GetResult());
+  connection.Shutdown();
+  return {.packets_written = connection.GetPacketsWritten(),
+          .max_packets_seen_in_flight = connection.GetMaxPacketsSeenInFlight()};
+}
+
+TEST(BaseSocketWindowTest, KeepsWindowOfPacketsInFlight) {
+  constexpr int kPacketCount = 32;
+  // 19 bytes of payload per 20 byte packet.
+  std::string message(kPacketCount * 19, '\x42');
+
+  WindowedWriteResult stop_and_wait = WriteWithWindow(1, message);
+  WindowedWriteResult windowed = WriteWithWindow(8, message);
+
+  EXPECT_EQ(stop_and_wait.max_packets_seen_in_flight, 1);
+  EXPECT_EQ(windowed.max_packets_seen_in_flight, 8);
+  // The same packets go out, in the same order, either way.
+  ASSERT_EQ(windowed.packets_written.size(), kPacketCount);
+  EXPECT_EQ(windowed.packets_written, stop_and_wait.packets_written);
+  for (int i = 0; i < kPacketCount; ++i) {
+    absl::StatusOr<Packet> packet =
+        Packet::FromBytes(ByteArray(windowed.packets_written[i]));
+    ASSERT_OK(packet);
+    EXPECT_EQ(packet->GetPacketCounter(), i % (Packet::kMaxPacketCounter + 1));
+  }
+}
+
+TEST(BaseSocketWindowTest, CompletesEachMessageAfterItsLastPacket) {
+  LatencyConnection connection(4, absl::Milliseconds(1));
+  FakeSocket socket(connection, SocketCallback{});
+  socket.OnConnectedProxy(connection.GetMaxPacketSize());
+
+  std::vector<nearby::Future<absl::Status>> statuses;
+  for (int i = 0; i < 10; ++i) {
+    statuses.push_back(socket.Write(ByteArray(std::string(20 + i, 'a' + i))));
+  }
+  for (nearby::Future<absl::Status>& status : statuses) {
+    EXPECT_OK(status.Get().GetResult());
+  }
+  connection.Shutdown();
+
+  EXPECT_EQ(connection.GetPacketsWritten().size(), 20);
+  EXPECT_LE(connection.GetMaxPacketsSeenInFlight(), 4);
+}
+
 }  // namespace
 }  // namespace weave
 }  // namespace nearby
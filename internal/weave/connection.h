@@ -36,6 +36,10 @@ class Connection {
   virtual ~Connection() = default;
   virtual void Initialize(ConnectionCallback callback) = 0;
   virtual int GetMaxPacketSize() const = 0;
+  // Returns how many packets may be transmitted before the write result of the
+  // first one is reported through `on_transmit_cb`. Write results must be
+  // reported in the order the packets were transmitted.
+  virtual int GetMaxPacketsInFlight() const { return 1; }
   virtual void Transmit(std::string packet) = 0;
   virtual void Close() = 0;
 };
@@ -16,16 +16,16 @@
 
 #include <algorithm>
 #include <string>
+#include <utility>
 
 #include "absl/status/status.h"
+#include "absl/strings/string_view.h"
 
 namespace nearby {
 namespace weave {
 
-MessageWriteRequest::MessageWriteRequest(absl::string_view message) {
-  message_ = std::string(message);
-  position_ = 0;
-}
+MessageWriteRequest::MessageWriteRequest(std::string message)
+    : message_(std::move(message)), position_(0) {}
 
 bool MessageWriteRequest::IsStarted() const { return position_ != 0; }
 
@@ -50,10 +50,10 @@ absl::StatusOr<Packet> MessageWriteRequest::NextPacket(int max_packet_size) {
   bool is_first = !IsStarted();
   int next_packet_len = std::min(max_packet_size - Packet::kPacketHeaderLength,
                                  (int)message_.size() - position_);
-  auto next_packet_bytes = message_.substr(position_, next_packet_len);
+  absl::string_view next_packet_bytes =
+      absl::string_view(message_).substr(position_, next_packet_len);
   position_ += next_packet_len;
-  return Packet::CreateDataPacket(is_first, IsFinished(),
-                                  ByteArray(next_packet_bytes));
+  return Packet::CreateDataPacket(is_first, IsFinished(), next_packet_bytes);
 }
 
 }  // namespace weave
@@ -30,7 +30,7 @@ namespace weave {
 // socket level.
 class MessageWriteRequest {
  public:
-  explicit MessageWriteRequest(absl::string_view message);
+  explicit MessageWriteRequest(std::string message);
   MessageWriteRequest(MessageWriteRequest&& other) = default;
   MessageWriteRequest& operator=(MessageWriteRequest&& other) = default;
 
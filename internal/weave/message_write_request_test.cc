@@ -39,7 +39,7 @@ TEST(MessageWriteRequestTest, WriteRequestIsNotTriviallyConstructible) {
 }
 
 TEST(MessageWriteRequestTest, ShortWriteRequestWorks) {
-  MessageWriteRequest request = MessageWriteRequest(kShortMessage);
+  MessageWriteRequest request = MessageWriteRequest(std::string(kShortMessage));
   EXPECT_FALSE(request.IsFinished());
   EXPECT_FALSE(request.IsStarted());
   Packet packet = request.NextPacket(15).value();
@@ -52,7 +52,7 @@ TEST(MessageWriteRequestTest, ShortWriteRequestWorks) {
 }
 
 TEST(MessageWriteRequestTest, LongWriteRequestWorks) {
-  MessageWriteRequest request = MessageWriteRequest(kLongMessage);
+  MessageWriteRequest request = MessageWriteRequest(std::string(kLongMessage));
   EXPECT_FALSE(request.IsFinished());
   EXPECT_FALSE(request.IsStarted());
   Packet packet = request.NextPacket(15).value();
@@ -71,7 +71,7 @@ TEST(MessageWriteRequestTest, LongWriteRequestWorks) {
 }
 
 TEST(MessageWriteRequestTest, TestResourceExhaustionOnceMessageSent) {
-  MessageWriteRequest request = MessageWriteRequest(kShortMessage);
+  MessageWriteRequest request = MessageWriteRequest(std::string(kShortMessage));
   EXPECT_FALSE(request.IsFinished());
   EXPECT_FALSE(request.IsStarted());
   Packet packet = request.NextPacket(15).value();
@@ -86,7 +86,7 @@ TEST(MessageWriteRequestTest, TestResourceExhaustionOnceMessageSent) {
 }
 
 TEST(MessageWriteRequestTest, TestGetSetFuture) {
-  MessageWriteRequest request = MessageWriteRequest(kShortMessage);
+  MessageWriteRequest request = MessageWriteRequest(std::string(kShortMessage));
   nearby::Future<absl::Status> result = request.GetWriteStatusFuture();
   request.SetWriteStatus(absl::InternalError(""));
   EXPECT_THAT(result.Get().GetResult(),
@@ -94,7 +94,7 @@ TEST(MessageWriteRequestTest, TestGetSetFuture) {
 }
 
 TEST(MessageWriteRequestTest, TestInvalidPacketSize) {
-  MessageWriteRequest request = MessageWriteRequest(kShortMessage);
+  MessageWriteRequest request = MessageWriteRequest(std::string(kShortMessage));
   auto result = request.NextPacket(0);
   EXPECT_THAT(result,
               testing::status::StatusIs(absl::StatusCode::kInvalidArgument));
@@ -103,7 +103,12 @@ class Packet {
     return Packet(std::move(bytes));
   }
   static Packet CreateDataPacket(bool is_first_packet, bool is_last_packet,
-                                 ByteArray payload);
+                                 absl::string_view payload);
+  static Packet CreateDataPacket(bool is_first_packet, bool is_last_packet,
+                                 const ByteArray& payload) {
+    return CreateDataPacket(is_first_packet, is_last_packet,
+                            payload.AsStringView());
+  }
   static absl::StatusOr<Packet> CreateConnectionRequestPacket(
       int16_t min_protocol_version, int16_t max_protocol_version,
       int16_t max_packet_size, absl::string_view extra_data);
@@ -130,8 +135,13 @@ class Packet {
   bool IsDataPacket() const;
   int GetPacketCounter() const;
   ControlPacketType GetControlCommandNumber() const;
-  std::string GetPayload() const { return bytes_.substr(kPacketHeaderLength); }
-  std::string GetBytes() const { return bytes_; }
+  // The payload is a view into this packet and must not outlive it.
+  absl::string_view GetPayload() const {
+    return absl::string_view(bytes_).substr(kPacketHeaderLength);
+  }
+  const std::string& GetBytes() const& { return bytes_; }
+  // Hands the packet bytes over without copying them.
+  std::string GetBytes() && { return std::move(bytes_); }
   absl::Status SetPacketCounter(int packetCounter);
   std::string ToString();
 
@@ -15,12 +15,14 @@
 #include "internal/weave/packet.h"
 
 #include <string>
+#include <utility>
 
 #include "gmock/gmock.h"
 #include "protobuf-matchers/protocol-buffer-matchers.h"
 #include "gtest/gtest.h"
 #include "absl/status/status.h"
 #include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 
 namespace nearby {
 namespace weave {
@@ -111,6 +113,16 @@ TEST(PacketTest, CreateDataPacketTest) {
   EXPECT_EQ(packet.GetPacketCounter(), 0);
 }
 
+TEST(PacketTest, CreateDataPacketFromViewTest) {
+  absl::string_view message = "a longer message";
+  Packet packet = Packet::CreateDataPacket(/*is_first_packet=*/true,
+                                           /*is_last_packet=*/true,
+                                           message.substr(2, 6));
+  EXPECT_TRUE(packet.IsDataPacket());
+  EXPECT_EQ(packet.GetPayload(), "longer");
+  EXPECT_EQ(std::move(packet).GetBytes().substr(1), "longer");
+}
+
 TEST(PacketTest, SetPacketCounterTest) {
   Packet packet = Packet::CreateDataPacket(false, false, ByteArray("sample"));
   EXPECT_OK(packet.SetPacketCounter(1));
@@ -120,8 +120,8 @@ void ClientSocket::OnReceiveControlPacket(Packet packet) {
   OnConnected(max_packet_size);
 
   if (packet.GetPayload().size() > kConnectionConfirmPacketMinLength) {
-    std::string remaining_data =
-        packet.GetPayload().substr(kConnectionConfirmPacketMinLength);
+    std::string remaining_data(
+        packet.GetPayload().substr(kConnectionConfirmPacketMinLength));
     GetSocketCallback().on_receive_cb(remaining_data);
   }
 }
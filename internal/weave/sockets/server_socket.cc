@@ -104,7 +104,7 @@ void ServerSocket::OnReceiveControlPacket(Packet packet) {
         absl::InvalidArgumentError("Unexpected control packet type."));
     return;
   }
-  std::string packet_payload = packet.GetPayload();
+  absl::string_view packet_payload = packet.GetPayload();
   if (packet_payload.size() < kMinimumConnectionRequestLength) {
     GetSocketCallback().on_error_cb(absl::InvalidArgumentError(
         "Insufficient length connection request packet received."));
@@ -132,8 +132,8 @@ void ServerSocket::OnReceiveControlPacket(Packet packet) {
         std::min(GetConnection().GetMaxPacketSize(), client_max_packet_size);
   }
   if (packet_payload.size() > kMinimumConnectionRequestLength) {
-    std::string remaining_data =
-        packet_payload.substr(kMinimumConnectionRequestLength);
+    std::string remaining_data(
+        packet_payload.substr(kMinimumConnectionRequestLength));
     GetSocketCallback().on_receive_cb(remaining_data);
   }
   WriteConnectionConfirm();
@@ -0,0 +1,137 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks decoding an encrypted advertisement with a growing number of
+// credentials, and creating the decoder for those credentials, which is paid
+// every time the credentials are updated. Repeated decodes of the same
+// advertisement are matched by the most recently used credential, the
+// unmatched benchmark shows the cost of trying every credential.
+//
+// Run with
+//   bazel run -c opt \
+//     //presence/implementation:advertisement_decoder_benchmark
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "internal/platform/byte_array.h"
+#include "internal/proto/credential.pb.h"
+#include "presence/implementation/advertisement_decoder_impl.h"
+
+namespace nearby {
+namespace presence {
+namespace {
+
+using ::nearby::internal::IdentityType;
+using ::nearby::internal::SharedCredential;
+
+// A private identity advertisement encrypted with the credential from
+// `GetMatchingCredential()`, see advertisement_decoder_test.cc.
+constexpr char kPrivateAdvertisement[] =
+    "00514142b8412efb0bc657ba514baf4d1b50ddc842cd1c";
+
+SharedCredential GetMatchingCredential() {
+  ByteArray seed({204, 219, 36, 137, 233, 252, 172, 66, 179, 147, 72,
+                  184, 148, 30, 209, 154, 29,  54,  14, 117, 224, 152,
+                  200, 193, 94, 107, 28,  194, 182, 32, 205, 57});
+  ByteArray known_mac({0xB4, 0xC5, 0x9F, 0xA5, 0x99, 0x24, 0x1B, 0x81,
+                       0x75, 0x8D, 0x97, 0x6B, 0x5A, 0x62, 0x1C, 0x05,
+                       0x23, 0x2F, 0xE1, 0xBF, 0x89, 0xAE, 0x59, 0x87,
+                       0xCA, 0x25, 0x4C, 0x35, 0x54, 0xDC, 0xE5, 0x0E});
+  SharedCredential credential;
+  credential.set_key_seed(seed.AsStringView());
+  credential.set_metadata_encryption_key_tag_v0(known_mac.AsStringView());
+  return credential;
+}
+
+// `count` private group credentials. If `matching`, the last of them decrypts
+// `kPrivateAdvertisement`.
+absl::flat_hash_map<IdentityType, std::vector<SharedCredential>>
+CreateCredentials(int count, bool matching = true) {
+  absl::flat_hash_map<IdentityType, std::vector<SharedCredential>> credentials;
+  std::vector<SharedCredential>& private_credentials =
+      credentials[IdentityType::IDENTITY_TYPE_PRIVATE_GROUP];
+  for (int i = 0; i < count; ++i) {
+    SharedCredential credential = GetMatchingCredential();
+    credential.set_id(i);
+    if (!matching || i < count - 1) {
+      credential.set_metadata_encryption_key_tag_v0(std::string(32, i));
+    }
+    private_credentials.push_back(credential);
+  }
+  return credentials;
+}
+
+void BM_DecodePrivateAdvertisement(benchmark::State& state) {
+  absl::flat_hash_map<IdentityType, std::vector<SharedCredential>>
+      credentials = CreateCredentials(state.range(0));
+  AdvertisementDecoderImpl decoder(&credentials);
+  std::string advertisement = absl::HexStringToBytes(kPrivateAdvertisement);
+
+  for (auto _ : state) {
+    absl::StatusOr<Advertisement> result =
+        decoder.DecodeAdvertisement(advertisement);
+    if (!result.ok()) {
+      state.SkipWithError("Failed to decode the advertisement.");
+      return;
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodePrivateAdvertisement)
+    ->ArgName("credentials")
+    ->RangeMultiplier(4)
+    ->Range(1, 256);
+
+// None of the credentials match, so every iteration tries all of them.
+void BM_DecodeUnmatchedPrivateAdvertisement(benchmark::State& state) {
+  absl::flat_hash_map<IdentityType, std::vector<SharedCredential>>
+      credentials = CreateCredentials(state.range(0), /*matching=*/false);
+  AdvertisementDecoderImpl decoder(&credentials);
+  std::string advertisement = absl::HexStringToBytes(kPrivateAdvertisement);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decoder.DecodeAdvertisement(advertisement));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeUnmatchedPrivateAdvertisement)
+    ->ArgName("credentials")
+    ->RangeMultiplier(4)
+    ->Range(1, 256)
+    ->UseRealTime();
+
+void BM_CreateDecoder(benchmark::State& state) {
+  absl::flat_hash_map<IdentityType, std::vector<SharedCredential>>
+      credentials = CreateCredentials(state.range(0));
+
+  for (auto _ : state) {
+    AdvertisementDecoderImpl decoder(&credentials);
+    benchmark::DoNotOptimize(decoder);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CreateDecoder)
+    ->ArgName("credentials")
+    ->RangeMultiplier(4)
+    ->Range(1, 256);
+
+}  // namespace
+}  // namespace presence
+}  // namespace nearby
@@ -14,8 +14,12 @@
 
 #include "presence/implementation/advertisement_decoder_impl.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -26,7 +30,11 @@
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "internal/platform/count_down_latch.h"
 #include "internal/platform/logging.h"
+#include "internal/platform/multi_thread_executor.h"
+#include "internal/platform/mutex.h"
+#include "internal/platform/mutex_lock.h"
 #include "presence/data_element.h"
 #include "presence/implementation/action_factory.h"
 #include "presence/implementation/advertisement_decoder.h"
@@ -47,6 +55,17 @@ constexpr int kEncryptedIdentityAdditionalLength =
     kSaltSize + kBaseMetadataSize;
 constexpr int kEddystoneAdditionalLength = 20;
 
+// Encrypted identities are trial decrypted on the calling thread until there
+// are at least this many credentials for each extra decrypt thread.
+constexpr int kMinCredentialsPerDecryptThread = 32;
+constexpr int kMaxDecryptThreads = 4;
+
+// A credential that decrypted and verified an encrypted identity.
+struct LdtMatch {
+  size_t index;
+  std::string plaintext;
+};
+
 uint8_t GetDataElementType(uint8_t header) { return header & kDataTypeMask; }
 
 size_t GetDataElementLength(uint8_t header) {
@@ -151,6 +170,71 @@ absl::StatusOr<DataElement> ParseDataElement(const absl::string_view input,
                  << absl::BytesToHexString(input.substr(start, length));
   return DataElement(data_type, input.substr(start, length));
 }
+
+// Returns the plaintext if `ldt_credential` decrypts and verifies
+// `encrypted_contents`.
+std::optional<std::string> TryLdtCredential(
+    LdtCredential& ldt_credential, absl::string_view salt,
+    absl::string_view encrypted_contents) {
+  absl::StatusOr<std::string> result =
+      ldt_credential.encryptor.DecryptAndVerify(encrypted_contents, salt);
+  if (!result.ok() || result->size() <= kBaseMetadataSize) {
+    return std::nullopt;
+  }
+  return *std::move(result);
+}
+
+// Finds the credential that decrypts `encrypted_contents`. The first
+// credential is tried on its own, the rest are split between the calling
+// thread and up to `kMaxDecryptThreads - 1` threads of `executor`, which stop
+// as soon as any of them finds a match.
+std::optional<LdtMatch> FindLdtMatch(std::vector<LdtCredential>& credentials,
+                                     MultiThreadExecutor* executor,
+                                     absl::string_view salt,
+                                     absl::string_view encrypted_contents) {
+  if (std::optional<std::string> plaintext =
+          TryLdtCredential(credentials.front(), salt, encrypted_contents)) {
+    return LdtMatch{.index = 0, .plaintext = *std::move(plaintext)};
+  }
+  size_t remaining = credentials.size() - 1;
+  int thread_count = 1;
+  if (executor != nullptr) {
+    thread_count = std::clamp(
+        static_cast<int>(remaining / kMinCredentialsPerDecryptThread), 1,
+        kMaxDecryptThreads);
+  }
+  size_t chunk_size = (remaining + thread_count - 1) / thread_count;
+
+  Mutex mutex;
+  std::optional<LdtMatch> match;
+  std::atomic<bool> found = false;
+  auto try_credentials = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end && !found.load(); ++i) {
+      std::optional<std::string> plaintext =
+          TryLdtCredential(credentials[i], salt, encrypted_contents);
+      if (plaintext.has_value()) {
+        MutexLock lock(&mutex);
+        found = true;
+        if (!match.has_value()) {
+          match = LdtMatch{.index = i, .plaintext = *std::move(plaintext)};
+        }
+        return;
+      }
+    }
+  };
+  CountDownLatch latch(thread_count - 1);
+  for (int thread = 1; thread < thread_count; ++thread) {
+    size_t begin = 1 + thread * chunk_size;
+    size_t end = std::min(begin + chunk_size, credentials.size());
+    executor->Execute("ldt-trial-decrypt", [&, begin, end]() {
+      try_credentials(begin, end);
+      latch.CountDown();
+    });
+  }
+  try_credentials(1, std::min(1 + chunk_size, credentials.size()));
+  latch.Await();
+  return match;
+}
 }  // namespace
 
 void DecodeBaseAction(absl::string_view serialized_action,
@@ -173,33 +257,32 @@ void DecodeBaseAction(absl::string_view serialized_action,
 }
 
 absl::StatusOr<std::string> DecryptLdt(
-    const std::vector<internal::SharedCredential>& credentials,
+    std::vector<LdtCredential>& credentials, MultiThreadExecutor* executor,
     absl::string_view salt, absl::string_view encrypted_contents,
     Advertisement& decoded_advertisement) {
   if (credentials.empty()) {
     return absl::UnavailableError("No credentials");
   }
-  for (const auto& credential : credentials) {
-    absl::StatusOr<LdtEncryptor> encryptor = LdtEncryptor::Create(
-        credential.key_seed(), credential.metadata_encryption_key_tag_v0());
-    if (encryptor.ok()) {
-      absl::StatusOr<std::string> result =
-          encryptor->DecryptAndVerify(encrypted_contents, salt);
-      if (result.ok() && result->size() > kBaseMetadataSize) {
-        decoded_advertisement.public_credential = credential;
-        decoded_advertisement.metadata_key =
-            result->substr(0, kBaseMetadataSize);
-        return result->substr(kBaseMetadataSize);
-      }
-    }
+  std::optional<LdtMatch> match =
+      FindLdtMatch(credentials, executor, salt, encrypted_contents);
+  if (!match.has_value()) {
+    return absl::UnavailableError(
+        "Couldn't decrypt the message with any credentials");
   }
-  return absl::UnavailableError(
-      "Couldn't decrypt the message with any credentials");
+  // Keep the most recently matched credential first, so that the next
+  // advertisement from the same device is matched by a single decryption.
+  auto matched = credentials.begin() + match->index;
+  std::rotate(credentials.begin(), matched, matched + 1);
+  decoded_advertisement.public_credential = credentials.front().credential;
+  decoded_advertisement.metadata_key =
+      match->plaintext.substr(0, kBaseMetadataSize);
+  return match->plaintext.substr(kBaseMetadataSize);
 }
 
-absl::Status DecryptDataElements(
-    const std::vector<internal::SharedCredential>& credentials,
-    const DataElement& elem, Advertisement& decoded_advertisement) {
+absl::Status DecryptDataElements(std::vector<LdtCredential>& credentials,
+                                 MultiThreadExecutor* executor,
+                                 const DataElement& elem,
+                                 Advertisement& decoded_advertisement) {
   if (elem.GetValue().size() <= kEncryptedIdentityAdditionalLength) {
     return absl::OutOfRangeError(absl::StrFormat(
         "Encrypted identity data element is too short - %d bytes",
@@ -210,7 +293,7 @@ absl::Status DecryptDataElements(
                                                    salt);
   absl::string_view encrypted = elem.GetValue().substr(kSaltSize);
   absl::StatusOr<std::string> decrypted =
-      DecryptLdt(credentials, salt, encrypted, decoded_advertisement);
+      DecryptLdt(credentials, executor, salt, encrypted, decoded_advertisement);
   if (!decrypted.ok()) {
     NEARBY_LOGS(WARNING) << "Failed to decrypt advertisement, status: "
                          << decrypted.status();
@@ -234,6 +317,38 @@ absl::Status DecryptDataElements(
   return absl::OkStatus();
 }
 
+AdvertisementDecoderImpl::AdvertisementDecoderImpl(
+    absl::flat_hash_map<nearby::internal::IdentityType,
+                        std::vector<internal::SharedCredential>>*
+        credentials_map)
+    : has_credentials_(credentials_map != nullptr) {
+  if (credentials_map == nullptr) {
+    return;
+  }
+  for (const auto& [identity_type, credentials] : *credentials_map) {
+    std::vector<LdtCredential>& ldt_credentials =
+        ldt_credentials_[identity_type];
+    ldt_credentials.reserve(credentials.size());
+    for (const auto& credential : credentials) {
+      absl::StatusOr<LdtEncryptor> encryptor = LdtEncryptor::Create(
+          credential.key_seed(), credential.metadata_encryption_key_tag_v0());
+      if (!encryptor.ok()) {
+        NEARBY_LOGS(WARNING) << "Failed to create LDT for credential "
+                             << credential.id()
+                             << ", status: " << encryptor.status();
+        continue;
+      }
+      ldt_credentials.push_back(LdtCredential{
+          .credential = credential, .encryptor = *std::move(encryptor)});
+    }
+    if (decrypt_executor_ == nullptr &&
+        ldt_credentials.size() > 2 * kMinCredentialsPerDecryptThread) {
+      decrypt_executor_ =
+          std::make_unique<MultiThreadExecutor>(kMaxDecryptThreads - 1);
+    }
+  }
+}
+
 absl::StatusOr<Advertisement> AdvertisementDecoderImpl::DecodeAdvertisement(
     absl::string_view advertisement) {
   Advertisement decoded_advertisement = Advertisement{};
@@ -263,13 +378,12 @@ absl::StatusOr<Advertisement> AdvertisementDecoderImpl::DecodeAdvertisement(
       decoded_advertisement.identity_type = GetIdentityType(elem->GetType());
     }
     if (IsEncryptedIdentity(elem->GetType())) {
-      if (credentials_map_ == nullptr) {
+      if (!has_credentials_) {
         return absl::FailedPreconditionError("Missing credentials");
       }
-      auto identity_type_specific_creds =
-          (*credentials_map_)[decoded_advertisement.identity_type];
-      absl::Status status = DecryptDataElements(identity_type_specific_creds,
-                                                *elem, decoded_advertisement);
+      absl::Status status = DecryptDataElements(
+          ldt_credentials_[decoded_advertisement.identity_type],
+          decrypt_executor_.get(), *elem, decoded_advertisement);
       if (!status.ok()) {
         return status;
       }
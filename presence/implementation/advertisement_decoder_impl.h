@@ -15,34 +15,54 @@
 #ifndef THIRD_PARTY_NEARBY_PRESENCE_ADVERTISEMENT_DECODER_IMPL_H_
 #define THIRD_PARTY_NEARBY_PRESENCE_ADVERTISEMENT_DECODER_IMPL_H_
 
+#include <memory>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "internal/platform/multi_thread_executor.h"
 #include "internal/proto/credential.pb.h"
 #include "presence/implementation/advertisement_decoder.h"
+#include "presence/implementation/ldt.h"
 
 namespace nearby {
 namespace presence {
 
+// A credential with its LDT keys derived up front.
+struct LdtCredential {
+  internal::SharedCredential credential;
+  LdtEncryptor encryptor;
+};
+
 // Implements the C++ backed parsing and decrypting of advertisement bytes
 class AdvertisementDecoderImpl : public AdvertisementDecoder {
  public:
   AdvertisementDecoderImpl() = default;
+  // Derives the LDT keys of every credential in `credentials_map` once, so
+  // decoding an advertisement only pays for the trial decryptions. The decoder
+  // keeps its own copy of the credentials and has to be recreated when they
+  // change.
+  //
+  // Credentials are tried most recently matched first. Identity types with
+  // many credentials are trial decrypted on several threads.
   explicit AdvertisementDecoderImpl(
       absl::flat_hash_map<nearby::internal::IdentityType,
                           std::vector<internal::SharedCredential>>*
-          credentials_map)
-      : credentials_map_(credentials_map) {}
+          credentials_map);
+  AdvertisementDecoderImpl(AdvertisementDecoderImpl&&) = default;
+  AdvertisementDecoderImpl& operator=(AdvertisementDecoderImpl&&) = default;
 
   absl::StatusOr<Advertisement> DecodeAdvertisement(
       absl::string_view advertisement) override;
 
  private:
-  absl::flat_hash_map<internal::IdentityType,
-                      std::vector<internal::SharedCredential>>*
-      credentials_map_ = nullptr;
+  bool has_credentials_ = false;
+  absl::flat_hash_map<internal::IdentityType, std::vector<LdtCredential>>
+      ldt_credentials_;
+  // Only created when an identity type has enough credentials to split them
+  // between threads.
+  std::unique_ptr<MultiThreadExecutor> decrypt_executor_;
 };
 
 }  // namespace presence
@@ -162,6 +162,74 @@ TEST(AdvertisementDecoderImpl, DecodeBaseNpPrivateAdvertisement) {
                                       absl::HexStringToBytes("08"))));
 }
 
+TEST(AdvertisementDecoderImpl, DecodePrivateAdvertisementAmongManyCreds) {
+  absl::flat_hash_map<IdentityType, std::vector<internal::SharedCredential>>
+      credentials;
+  for (int i = 0; i < 20; ++i) {
+    SharedCredential credential = GetPublicCredential();
+    credential.set_id(i);
+    credential.set_metadata_encryption_key_tag_v0(std::string(32, i));
+    credentials[IdentityType::IDENTITY_TYPE_PRIVATE_GROUP].push_back(
+        credential);
+  }
+  SharedCredential matching_credential = GetPublicCredential();
+  matching_credential.set_id(100);
+  credentials[IdentityType::IDENTITY_TYPE_PRIVATE_GROUP].push_back(
+      matching_credential);
+  AdvertisementDecoderImpl decoder(&credentials);
+  const std::string advertisement =
+      absl::HexStringToBytes("00514142b8412efb0bc657ba514baf4d1b50ddc842cd1c");
+
+  // The keys are derived once, repeated sightings reuse them.
+  for (int i = 0; i < 3; ++i) {
+    absl::StatusOr<Advertisement> result =
+        decoder.DecodeAdvertisement(advertisement);
+    ASSERT_OK(result);
+    ASSERT_OK(result->public_credential);
+    EXPECT_EQ(result->public_credential->id(), 100);
+  }
+}
+
+TEST(AdvertisementDecoderImpl, DecodePrivateAdvertisementOnManyThreads) {
+  absl::flat_hash_map<IdentityType, std::vector<internal::SharedCredential>>
+      credentials;
+  for (int i = 0; i < 300; ++i) {
+    SharedCredential credential = GetPublicCredential();
+    credential.set_id(i);
+    if (i != 200) {
+      credential.set_metadata_encryption_key_tag_v0(std::string(32, i));
+    }
+    credentials[IdentityType::IDENTITY_TYPE_PRIVATE_GROUP].push_back(
+        credential);
+  }
+  AdvertisementDecoderImpl decoder(&credentials);
+
+  for (int i = 0; i < 3; ++i) {
+    absl::StatusOr<Advertisement> result = decoder.DecodeAdvertisement(
+        absl::HexStringToBytes(
+            "00514142b8412efb0bc657ba514baf4d1b50ddc842cd1c"));
+    ASSERT_OK(result);
+    ASSERT_OK(result->public_credential);
+    EXPECT_EQ(result->public_credential->id(), 200);
+  }
+  EXPECT_THAT(decoder.DecodeAdvertisement(absl::HexStringToBytes(
+                  "00514142b8412efb0bc657ba514baf4d1b50ddc842cd1d")),
+              StatusIs(absl::StatusCode::kUnavailable));
+}
+
+TEST(AdvertisementDecoderImpl, DecoderKeepsCredentialsItWasCreatedWith) {
+  absl::flat_hash_map<IdentityType, std::vector<internal::SharedCredential>>
+      credentials;
+  credentials[IdentityType::IDENTITY_TYPE_PRIVATE_GROUP].push_back(
+      GetPublicCredential());
+  AdvertisementDecoderImpl decoder(&credentials);
+
+  credentials.clear();
+
+  EXPECT_OK(decoder.DecodeAdvertisement(absl::HexStringToBytes(
+      "00514142b8412efb0bc657ba514baf4d1b50ddc842cd1c")));
+}
+
 TEST(AdvertisementDecoderImpl, InvalidEncryptedContent) {
   std::string salt = "AB";
   ByteArray metadata_key(
@@ -0,0 +1,53 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "presence/implementation/decoded_advertisement_cache.h"
+
+#include <cstdint>
+#include <string>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "presence/implementation/advertisement_decoder.h"
+
+namespace nearby {
+namespace presence {
+
+const absl::StatusOr<Advertisement>& DecodedAdvertisementCache::GetOrDecode(
+    absl::string_view advertisement, uint64_t credentials_generation,
+    absl::FunctionRef<absl::StatusOr<Advertisement>()> decode) {
+  auto it = index_.find(Key(advertisement, credentials_generation));
+  if (it != index_.end()) {
+    ++hit_count_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->result;
+  }
+
+  ++miss_count_;
+  entries_.push_front(Entry{.advertisement = std::string(advertisement),
+                            .credentials_generation = credentials_generation,
+                            .result = decode()});
+  index_.emplace(Key(entries_.front().advertisement, credentials_generation),
+                 entries_.begin());
+  if (entries_.size() > capacity_) {
+    const Entry& oldest = entries_.back();
+    index_.erase(Key(oldest.advertisement, oldest.credentials_generation));
+    entries_.pop_back();
+  }
+  return entries_.front().result;
+}
+
+}  // namespace presence
+}  // namespace nearby
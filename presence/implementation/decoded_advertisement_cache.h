@@ -0,0 +1,79 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_NEARBY_PRESENCE_IMPLEMENTATION_DECODED_ADVERTISEMENT_CACHE_H_
+#define THIRD_PARTY_NEARBY_PRESENCE_IMPLEMENTATION_DECODED_ADVERTISEMENT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "presence/implementation/advertisement_decoder.h"
+
+namespace nearby {
+namespace presence {
+
+// A least recently used cache of decoding results, keyed by the raw
+// advertisement bytes and the generation of the credentials they were decoded
+// with. Failed decodes are cached too, so an advertisement that none of the
+// credentials decrypt is not trial decrypted again every time it is seen.
+//
+// Not thread safe.
+class DecodedAdvertisementCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 64;
+
+  // `capacity` must be at least 1.
+  explicit DecodedAdvertisementCache(size_t capacity = kDefaultCapacity)
+      : capacity_(capacity) {}
+
+  // Returns the cached result for `advertisement` decoded with credentials of
+  // `credentials_generation`, calling `decode` to fill the cache on a miss.
+  // The returned reference is valid until the next call.
+  const absl::StatusOr<Advertisement>& GetOrDecode(
+      absl::string_view advertisement, uint64_t credentials_generation,
+      absl::FunctionRef<absl::StatusOr<Advertisement>()> decode);
+
+  size_t size() const { return entries_.size(); }
+  int64_t hit_count() const { return hit_count_; }
+  int64_t miss_count() const { return miss_count_; }
+
+ private:
+  struct Entry {
+    std::string advertisement;
+    uint64_t credentials_generation;
+    absl::StatusOr<Advertisement> result;
+  };
+  // Points into `Entry::advertisement`, which does not move while the entry
+  // is in `entries_`.
+  using Key = std::pair<absl::string_view, uint64_t>;
+
+  size_t capacity_;
+  // Most recently used first.
+  std::list<Entry> entries_;
+  absl::flat_hash_map<Key, std::list<Entry>::iterator> index_;
+  int64_t hit_count_ = 0;
+  int64_t miss_count_ = 0;
+};
+
+}  // namespace presence
+}  // namespace nearby
+
+#endif  // THIRD_PARTY_NEARBY_PRESENCE_IMPLEMENTATION_DECODED_ADVERTISEMENT_CACHE_H_
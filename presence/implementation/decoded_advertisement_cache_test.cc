@@ -0,0 +1,120 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "presence/implementation/decoded_advertisement_cache.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "presence/implementation/advertisement_decoder.h"
+
+namespace nearby {
+namespace presence {
+namespace {
+
+// Decodes every advertisement as a version equal to its first byte, counting
+// the calls.
+class CountingDecoder {
+ public:
+  absl::StatusOr<Advertisement> Decode(const std::string& advertisement) {
+    ++decode_count_;
+    if (advertisement.empty()) {
+      return absl::OutOfRangeError("Empty advertisement");
+    }
+    return Advertisement{.version = static_cast<uint8_t>(advertisement[0])};
+  }
+
+  int decode_count() const { return decode_count_; }
+
+ private:
+  int decode_count_ = 0;
+};
+
+TEST(DecodedAdvertisementCacheTest, DecodesRepeatedAdvertisementOnce) {
+  DecodedAdvertisementCache cache;
+  CountingDecoder decoder;
+  std::string advertisement = "\x01\x02";
+
+  for (int i = 0; i < 3; ++i) {
+    const absl::StatusOr<Advertisement>& result = cache.GetOrDecode(
+        advertisement, /*credentials_generation=*/0,
+        [&]() { return decoder.Decode(advertisement); });
+    ASSERT_TRUE(result.ok());
+    EXPECT_EQ(result->version, 1);
+  }
+
+  EXPECT_EQ(decoder.decode_count(), 1);
+  EXPECT_EQ(cache.hit_count(), 2);
+  EXPECT_EQ(cache.miss_count(), 1);
+}
+
+TEST(DecodedAdvertisementCacheTest, CachesFailedDecodes) {
+  DecodedAdvertisementCache cache;
+  CountingDecoder decoder;
+
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(cache.GetOrDecode("", /*credentials_generation=*/0,
+                                [&]() { return decoder.Decode(""); })
+                  .status()
+                  .code(),
+              absl::StatusCode::kOutOfRange);
+  }
+
+  EXPECT_EQ(decoder.decode_count(), 1);
+}
+
+TEST(DecodedAdvertisementCacheTest, NewCredentialsGenerationDecodesAgain) {
+  DecodedAdvertisementCache cache;
+  CountingDecoder decoder;
+  std::string advertisement = "\x01\x02";
+
+  cache.GetOrDecode(advertisement, /*credentials_generation=*/1,
+                    [&]() { return decoder.Decode(advertisement); });
+  cache.GetOrDecode(advertisement, /*credentials_generation=*/2,
+                    [&]() { return decoder.Decode(advertisement); });
+
+  EXPECT_EQ(decoder.decode_count(), 2);
+  EXPECT_EQ(cache.hit_count(), 0);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST(DecodedAdvertisementCacheTest, EvictsLeastRecentlyUsed) {
+  DecodedAdvertisementCache cache(/*capacity=*/2);
+  CountingDecoder decoder;
+  auto get = [&](const std::string& advertisement) {
+    return cache
+        .GetOrDecode(advertisement, /*credentials_generation=*/0,
+                     [&]() { return decoder.Decode(advertisement); })
+        ->version;
+  };
+
+  EXPECT_EQ(get("\x01"), 1);
+  EXPECT_EQ(get("\x02"), 2);
+  // Makes "\x02" the least recently used.
+  EXPECT_EQ(get("\x01"), 1);
+  EXPECT_EQ(get("\x03"), 3);
+  EXPECT_EQ(decoder.decode_count(), 3);
+
+  EXPECT_EQ(get("\x01"), 1);
+  EXPECT_EQ(decoder.decode_count(), 3);
+  EXPECT_EQ(get("\x02"), 2);
+  EXPECT_EQ(decoder.decode_count(), 4);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+}  // namespace
+}  // namespace presence
+}  // namespace nearby
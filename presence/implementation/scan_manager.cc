@@ -16,6 +16,7 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -23,7 +24,9 @@
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "internal/platform/future.h"
@@ -36,6 +39,7 @@
 #include "presence/data_types.h"
 #include "presence/device_motion.h"
 #include "presence/implementation/advertisement_decoder.h"
+#include "presence/implementation/decoded_advertisement_cache.h"
 #include "presence/implementation/mediums/ble.h"
 #include "presence/presence_action.h"
 #include "presence/presence_device.h"
@@ -49,6 +53,32 @@ using BleAdvertisementData = ::nearby::api::ble_v2::BleAdvertisementData;
 using BlePeripheral = ::nearby::api::ble_v2::BlePeripheral;
 using ScanningSession = ::nearby::api::ble_v2::BleMedium::ScanningSession;
 using ScanningCallback = ::nearby::api::ble_v2::BleMedium::ScanningCallback;
+
+// Serializes the credentials into a key that is equal for two sessions if and
+// only if they hold the same credentials. Identity types without credentials
+// are skipped, so sessions without credentials get an empty key.
+std::string GetCredentialsKey(
+    const absl::flat_hash_map<internal::IdentityType,
+                              std::vector<internal::SharedCredential>>&
+        credentials) {
+  std::vector<internal::IdentityType> identity_types;
+  for (const auto& [identity_type, shared_credentials] : credentials) {
+    if (!shared_credentials.empty()) identity_types.push_back(identity_type);
+  }
+  // The map has no stable iteration order.
+  std::sort(identity_types.begin(), identity_types.end());
+  std::string key;
+  for (internal::IdentityType identity_type : identity_types) {
+    const std::vector<internal::SharedCredential>& shared_credentials =
+        credentials.at(identity_type);
+    absl::StrAppend(&key, static_cast<int>(identity_type), ",", shared_credentials.size(), ";");
+    for (const internal::SharedCredential& credential : shared_credentials) {
+      std::string serialized = credential.SerializeAsString();
+      absl::StrAppend(&key, serialized.size(), ":", serialized);
+    }
+  }
+  return key;
+}
 }  // namespace
 
 ScanSessionId ScanManager::StartScan(ScanRequest scan_request,
@@ -108,6 +138,7 @@ void ScanManager::StopScan(ScanSessionId id) {
             NEARBY_LOGS(WARNING) << "StopScan error: " << status;
           }
         }
+        ReleaseCredentialsGeneration(it->second.credentials_generation);
         scan_sessions_.erase(it);
       });
 }
@@ -122,7 +153,11 @@ void ScanManager::NotifyFoundBle(ScanSessionId id, BleAdvertisementData data,
   auto advertisement_data =
       data.service_data[kPresenceServiceUuid].AsStringView();
 
-  auto advert = it->second.decoder.DecodeAdvertisement(advertisement_data);
+  const absl::StatusOr<Advertisement>& advert =
+      decoded_advertisements_.GetOrDecode(
+          advertisement_data, it->second.credentials_generation, [&]() {
+            return it->second.decoder.DecodeAdvertisement(advertisement_data);
+          });
   if (!advert.ok()) {
     // This advertisement is not relevant to the current element, skip.
     return;
@@ -266,9 +301,37 @@ void ScanManager::UpdateCredentials(ScanSessionId id,
 
   ScanSessionState& session = it->second;
   session.credentials[identity_type] = std::move(credentials);
+  ReleaseCredentialsGeneration(session.credentials_generation);
+  session.credentials_generation =
+      AcquireCredentialsGeneration(session.credentials);
   session.decoder = AdvertisementDecoderImpl(&session.credentials);
 }
 
+uint64_t ScanManager::AcquireCredentialsGeneration(
+    const absl::flat_hash_map<IdentityType, std::vector<SharedCredential>>&
+        credentials) {
+  std::string key = GetCredentialsKey(credentials);
+  if (key.empty()) return 0;
+  auto [it, inserted] = interned_credentials_.try_emplace(std::move(key));
+  if (inserted) {
+    it->second.generation = next_credentials_generation_++;
+  }
+  it->second.sessions++;
+  return it->second.generation;
+}
+
+void ScanManager::ReleaseCredentialsGeneration(uint64_t generation) {
+  if (generation == 0) return;
+  for (auto it = interned_credentials_.begin();
+       it != interned_credentials_.end(); ++it) {
+    if (it->second.generation != generation) continue;
+    if (--it->second.sessions == 0) {
+      interned_credentials_.erase(it);
+    }
+    return;
+  }
+}
+
 int ScanManager::ScanningCallbacksLengthForTest() {
   ::nearby::Future<int> count;
   RunOnServiceControllerThread("callbacks-size",
@@ -278,5 +341,14 @@ int ScanManager::ScanningCallbacksLengthForTest() {
   return count.Get().GetResult();
 }
 
+int64_t ScanManager::DecodedAdvertisementCacheHitCountForTest() {
+  ::nearby::Future<int64_t> count;
+  RunOnServiceControllerThread("cache-hit-count",
+                               [&]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(*executor_) {
+                                 count.Set(decoded_advertisements_.hit_count());
+                               });
+  return count.Get().GetResult();
+}
+
 }  // namespace presence
 }  // namespace nearby
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_NEARBY_PRESENCE_IMPLEMENTATION_SCAN_MANAGER_H_
 #define THIRD_PARTY_NEARBY_PRESENCE_IMPLEMENTATION_SCAN_MANAGER_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -32,6 +33,7 @@
 #include "presence/data_types.h"
 #include "presence/implementation/advertisement_filter.h"
 #include "presence/implementation/credential_manager.h"
+#include "presence/implementation/decoded_advertisement_cache.h"
 #include "presence/implementation/mediums/mediums.h"
 #include "presence/scan_request.h"
 
@@ -70,6 +72,7 @@ class ScanManager {
   // Below functions are test only.
   // Reference: go/totw/135#augmenting-the-public-api-for-tests
   int ScanningCallbacksLengthForTest();
+  int64_t DecodedAdvertisementCacheHitCountForTest();
 
  private:
   struct ScanSessionState {
@@ -77,10 +80,19 @@ class ScanManager {
     ScanCallback callback;
     absl::flat_hash_map<IdentityType, std::vector<SharedCredential>>
         credentials;
+    // Identifies `credentials` in `decoded_advertisements_`. Sessions holding
+    // the same credentials share a generation. Sessions without credentials
+    // decode alike and share generation 0.
+    uint64_t credentials_generation = 0;
     AdvertisementDecoderImpl decoder;
     AdvertisementFilter advertisement_filter;
     std::unique_ptr<ScanningSession> scanning_session;
   };
+  struct InternedCredentials {
+    uint64_t generation = 0;
+    // Number of sessions holding the credentials.
+    int sessions = 0;
+  };
   void NotifyFoundBle(
       ScanSessionId id, BleAdvertisementData data,
       nearby::api::ble_v2::BlePeripheral::UniqueId peripheral_id)
@@ -93,6 +105,14 @@ class ScanManager {
   void UpdateCredentials(ScanSessionId id, IdentityType identity_type,
                          std::vector<SharedCredential> credentials)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(*executor_);
+  // Returns the generation of `credentials`, taking a reference on it until
+  // ReleaseCredentialsGeneration() is called. A generation is never reused
+  // for different credentials.
+  uint64_t AcquireCredentialsGeneration(
+      const absl::flat_hash_map<IdentityType, std::vector<SharedCredential>>&
+          credentials) ABSL_EXCLUSIVE_LOCKS_REQUIRED(*executor_);
+  void ReleaseCredentialsGeneration(uint64_t generation)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(*executor_);
   void RunOnServiceControllerThread(absl::string_view name, Runnable runnable) {
     executor_->Execute(std::string(name), std::move(runnable));
   }
@@ -100,6 +120,13 @@ class ScanManager {
   CredentialManager* credential_manager_;
   absl::flat_hash_map<ScanSessionId, ScanSessionState> scan_sessions_
       ABSL_GUARDED_BY(*executor_);
+  // Shared by all sessions, BLE devices keep repeating the same advertisement.
+  DecodedAdvertisementCache decoded_advertisements_
+      ABSL_GUARDED_BY(*executor_);
+  // The credentials held by the sessions, keyed by their serialized content.
+  absl::flat_hash_map<std::string, InternedCredentials> interned_credentials_
+      ABSL_GUARDED_BY(*executor_);
+  uint64_t next_credentials_generation_ ABSL_GUARDED_BY(*executor_) = 1;
   absl::flat_hash_map<nearby::api::ble_v2::BlePeripheral::UniqueId, std::string>
       device_unique_id_to_endpoint_id_map_
       ABSL_GUARDED_BY(*executor_);
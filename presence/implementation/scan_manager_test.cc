@@ -15,6 +15,7 @@
 #include "presence/implementation/scan_manager.h"
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -258,6 +259,26 @@ TEST_F(ScanManagerTest, PresenceMetadataIsRetained) {
   EXPECT_EQ(manager.ScanningCallbacksLengthForTest(), 0);
 }
 
+TEST_F(ScanManagerTest, RepeatedAdvertisementIsDecodedOnce) {
+  Mediums mediums;
+  ScanManager manager(mediums, credential_manager_, executor_);
+  nearby::BluetoothAdapter server_adapter;
+  Ble ble2(server_adapter);
+  std::unique_ptr<AdvertisingSession> advertising_session =
+      StartAdvertisingOn(ble2);
+
+  ScanSessionId scan_session =
+      manager.StartScan(MakeDefaultScanRequest(), MakeDefaultScanCallback());
+  EXPECT_TRUE(start_latch_.Await().Ok());
+  EXPECT_TRUE(found_latch_.Await().Ok());
+  // Advertise the same bytes again to trigger `on_updated_cb`.
+  advertising_session = StartAdvertisingOn(ble2);
+  EXPECT_TRUE(updated_latch_.Await().Ok());
+
+  EXPECT_GE(manager.DecodedAdvertisementCacheHitCountForTest(), 1);
+  manager.StopScan(scan_session);
+}
+
 TEST_F(ScanManagerTest, DiscoverThenLoseAdvertisement) {
   Mediums mediums;
   ScanManager manager(mediums, credential_manager_, executor_);
@@ -451,6 +472,75 @@ TEST_F(ScanManagerTest, ScanningE2EWithEncryptedAdvertisementAndCredentials) {
   EXPECT_EQ(manager.ScanningCallbacksLengthForTest(), 0);
 }
 
+// A private identity advertisement, which decrypts with
+// BuildSharedCredentials().
+AdvertisementData MakeEncryptedAdvertisement() {
+  std::string V0AdvEncryptedBytes = "042222D82212EF16DBF872F2A3A7C0FA5248EC";
+  return AdvertisementData{
+      .is_extended_advertisement = false,
+      .content = absl::HexStringToBytes(V0AdvEncryptedBytes),
+  };
+}
+
+ScanRequest MakePrivateGroupScanRequest() {
+  std::vector<
+      absl::variant<PresenceScanFilter, LegacyPresenceScanFilter>>  // NOLINT
+      filters = {PresenceScanFilter{
+          .scan_type = ScanType::kPresenceScan,
+          .extended_properties = {DataElement(DataElement::kTxPowerFieldType,
+                                              3)},
+      }};
+
+  return {
+      .account_name = "Test account",
+      .identity_types =
+          {nearby::internal::IdentityType::IDENTITY_TYPE_PRIVATE_GROUP},
+      .scan_filters = filters,
+      .use_ble = true,
+      .scan_type = ScanType::kPresenceScan,
+      .power_mode = PowerMode::kBalanced,
+      .scan_only_when_screen_on = true,
+  };
+}
+
+TEST_F(ScanManagerTest,
+       SessionsWithSameCredentialsShareDecodedAdvertisements) {
+  Mediums mediums;
+  auto mock_credential_manager = MockCredentialManager();
+  EXPECT_CALL(mock_credential_manager, GetPublicCredentials)
+      .Times(2)
+      .WillRepeatedly([&](const CredentialSelector& credential_selector,
+                          PublicCredentialType public_credential_type,
+                          GetPublicCredentialsResultCallback callback) {
+        callback.credentials_fetched_cb(BuildSharedCredentials());
+      });
+  ScanManager manager(mediums, mock_credential_manager, executor_);
+  nearby::BluetoothAdapter server_adapter;
+  Ble ble2(server_adapter);
+  std::unique_ptr<AdvertisingSession> session = ble2.StartAdvertising(
+      MakeEncryptedAdvertisement(), PowerMode::kLowPower,
+      AdvertisingCallback{.start_advertising_result = [](absl::Status) {}});
+  env_.Sync();
+
+  ScanSessionId first_session = manager.StartScan(
+      MakePrivateGroupScanRequest(), MakeDefaultScanCallback());
+  EXPECT_TRUE(found_latch_.Await().Ok());
+  int64_t hit_count = manager.DecodedAdvertisementCacheHitCountForTest();
+  CountDownLatch second_found_latch(1);
+  ScanSessionId second_session = manager.StartScan(
+      MakePrivateGroupScanRequest(),
+      {.start_scan_cb = [](absl::Status) {},
+       .on_discovered_cb =
+           [&](PresenceDevice pd) { second_found_latch.CountDown(); }});
+  EXPECT_TRUE(second_found_latch.Await().Ok());
+
+  // The second session fetched its own copy of the same credentials, and
+  // found the advertisement the first session decoded.
+  EXPECT_GT(manager.DecodedAdvertisementCacheHitCountForTest(), hit_count);
+  manager.StopScan(first_session);
+  manager.StopScan(second_session);
+}
+
 }  // namespace
 }  // namespace presence
 }  // namespace nearby